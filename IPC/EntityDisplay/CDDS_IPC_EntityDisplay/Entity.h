@@ -0,0 +1,10 @@
+#pragma once
+
+// ZORA: The Entity struct is shared byte-for-byte between the Editor and the Display through named shared memory, so both applications must agree on its layout exactly
+struct Entity {
+	float x = 0, y = 0;
+	float rotation = 0;
+	float speed = 0;
+	unsigned char r = 0, g = 0, b = 0;
+	float size = 1;
+};
@@ -0,0 +1,82 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "SharedMemory.h"
+#include "SharedMemPool.h"
+
+// ZORA: Written at the front of the arena so that the Display can tell it has found one, and one laid out the way it expects
+const uint32_t ENTITY_ARENA_MAGIC = 0x4E524145;	// 'EARN'
+const uint32_t ENTITY_ARENA_VERSION = 1;
+
+// ZORA: The bytes of shared memory each Editor keeps for variable-length entity data. Payload offsets are packed into 32 bits, so it must stay under 4GB.
+const size_t ENTITY_ARENA_SIZE = 16 * 1024 * 1024;
+
+// ZORA: The number of Editor frames a replaced payload is kept for before its memory is handed back to the pool. A Display reading it in place has this long to finish, about half a second at 60fps, which is far longer than drawing a frame takes.
+const uint64_t ENTITY_ARENA_RETIRE_FRAMES = 30;
+
+// ZORA: The header at the front of the arena. The pool follows it.
+struct EntityArenaHeader {
+	std::atomic<uint32_t> magic;		// ZORA: Written last by the creator, so the Display never validates a half-initialised header
+	uint32_t version;
+	uint64_t poolOffset;				// ZORA: The byte offset from the front of the arena to the pool
+	uint64_t poolSize;
+	std::atomic<uint64_t> directory;	// ZORA: The pool offset of the directory, or 0 before the first payload
+};
+
+// ZORA: Variable-length data for an Editor's entities (names now, trails and tags later) in named shared memory, which the Display reads in place rather than having it serialised.
+// The memory is a SharedMemPool, so every link in it is an offset and it reads the same wherever the Display maps it. Each Editor has an arena of its own, named after its partition, because the pool has exactly one writer and the segment is both shared between Editors and recreated when it is resized.
+// The directory is an array in the pool with one entry per entity handle slot, so a payload stays with its entity however the Editor rearranges its entities. Each entry holds the pool offset of its payload in the top 32 bits and its length in the bottom 32, or 0 for none. A new payload is written in full before its entry is swapped in with a release store, so the Display sees the old payload or the new one and never half of each. The old payload is only freed ENTITY_ARENA_RETIRE_FRAMES frames later, so a Display still reading it isn't reading memory that has been given to something else.
+class EntityArena {
+public:
+	EntityArena();
+	~EntityArena();
+
+	// ZORA: The Editor creates the arena. Returns false if the shared memory could not be created.
+	bool Create(const char* name);
+
+	// ZORA: The Display opens the arena to read from. Returns false if it doesn't exist or its layout doesn't match.
+	bool Open(const char* name);
+
+	void Close();
+	bool IsOpen() const;
+
+	// ZORA: Editor side. Give the entity in handle slot 'index' a copy of 'bytes' bytes of 'data', or no payload if 'bytes' is 0. Returns false, leaving the old payload in place, if the pool has no room.
+	bool SetPayload(uint32_t index, const void* data, uint32_t bytes);
+
+	// ZORA: Editor side. Call once a frame, after publishing. Frees the payloads that were replaced long enough ago that no Display can still be reading them.
+	void EndFrame();
+
+	// ZORA: Either side. The payload of the entity in handle slot 'index', read in place, with its length in 'bytes'. A nullptr, with 'bytes' 0, if it has none.
+	const void* GetPayload(uint32_t index, uint32_t& bytes) const;
+
+	int GetErrorCode() const;
+
+private:
+	EntityArena(const EntityArena&) = delete;
+	EntityArena& operator=(const EntityArena&) = delete;
+
+	// ZORA: The directory's entry for 'index', or a nullptr if the directory doesn't reach that far
+	std::atomic<uint64_t>* GetEntry(uint32_t index) const;
+
+	// ZORA: Hand a block back to the pool ENTITY_ARENA_RETIRE_FRAMES frames from now
+	void Retire(uint64_t offset);
+
+	struct RetiredBlock {
+		uint64_t offset;
+		uint64_t frame;
+	};
+
+	SharedMemory m_memory;
+	EntityArenaHeader* m_header;
+	SharedMemPool m_pool;
+	bool m_writer;
+
+	// ZORA: Editor side. The frames ended so far, and the blocks waiting to be freed, oldest first.
+	uint64_t m_frame;
+	std::vector<RetiredBlock> m_retired;
+};
+
+// ZORA: The name of the arena belonging to the Editor publishing into 'partition' of the segment called 'segmentName'
+void MakeArenaName(char* out, size_t outSize, const char* segmentName, uint32_t partition);
@@ -0,0 +1,391 @@
+#include "EntityCodec.h"
+#include "raylib.h"
+#include <algorithm>
+#include <cstring>
+
+// ZORA: How each column is delta encoded. 0 is a float, XORed with the reference. Anything else is a fixed point or colour field of that many bits, subtracted from the reference.
+static const uint32_t PACKED_FIELD_BITS[ENTITY_CODEC_FIELDS] = { 16, 16, 16, 8, 8, 8, 8, 8 };
+static const uint32_t RAW_FIELD_BITS[ENTITY_CODEC_FIELDS] = { 0, 0, 0, 0, 0, 8, 8, 8 };
+
+// ZORA: The most bytes one field's varint can take, a whole 32 bit float's worth. A run of unchanged fields never takes more than this per field either.
+static const size_t MAX_VARINT_BYTES = 5;
+
+static uint32_t FloatBits(float value) {
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+static float BitsFloat(uint32_t bits) {
+	float value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+// ZORA: Lay a frame out a column per field: x, y, rotation, speed, size, r, g, b
+static void FillColumns(EntityCodecFrame& frame, const Entity* entities, const PackedEntity* packed, uint32_t count) {
+	frame.count = count;
+	frame.columns.resize((size_t)count * ENTITY_CODEC_FIELDS);
+	uint32_t* columns[ENTITY_CODEC_FIELDS];
+	for (size_t field = 0; field < ENTITY_CODEC_FIELDS; field++)
+		columns[field] = frame.columns.data() + field * count;
+
+	for (uint32_t i = 0; i < count; i++) {
+		if (packed != nullptr) {
+			columns[0][i] = packed[i].x;
+			columns[1][i] = packed[i].y;
+			columns[2][i] = packed[i].rotation;
+			columns[3][i] = packed[i].speed;
+			columns[4][i] = packed[i].size;
+			columns[5][i] = packed[i].r;
+			columns[6][i] = packed[i].g;
+			columns[7][i] = packed[i].b;
+		}
+		else {
+			columns[0][i] = FloatBits(entities[i].x);
+			columns[1][i] = FloatBits(entities[i].y);
+			columns[2][i] = FloatBits(entities[i].rotation);
+			columns[3][i] = FloatBits(entities[i].speed);
+			columns[4][i] = FloatBits(entities[i].size);
+			columns[5][i] = entities[i].r;
+			columns[6][i] = entities[i].g;
+			columns[7][i] = entities[i].b;
+		}
+	}
+}
+
+// ZORA: The inverse of FillColumns. Exactly one of 'entities' and 'packed' is filled.
+static void EmptyColumns(const EntityCodecFrame& frame, Entity* entities, PackedEntity* packed) {
+	const uint32_t* columns[ENTITY_CODEC_FIELDS];
+	for (size_t field = 0; field < ENTITY_CODEC_FIELDS; field++)
+		columns[field] = frame.columns.data() + field * frame.count;
+
+	for (uint32_t i = 0; i < frame.count; i++) {
+		if (packed != nullptr) {
+			packed[i].x = (uint16_t)columns[0][i];
+			packed[i].y = (uint16_t)columns[1][i];
+			packed[i].rotation = (uint16_t)columns[2][i];
+			packed[i].speed = (uint8_t)columns[3][i];
+			packed[i].size = (uint8_t)columns[4][i];
+			packed[i].r = (uint8_t)columns[5][i];
+			packed[i].g = (uint8_t)columns[6][i];
+			packed[i].b = (uint8_t)columns[7][i];
+		}
+		else {
+			entities[i].x = BitsFloat(columns[0][i]);
+			entities[i].y = BitsFloat(columns[1][i]);
+			entities[i].rotation = BitsFloat(columns[2][i]);
+			entities[i].speed = BitsFloat(columns[3][i]);
+			entities[i].size = BitsFloat(columns[4][i]);
+			entities[i].r = (uint8_t)columns[5][i];
+			entities[i].g = (uint8_t)columns[6][i];
+			entities[i].b = (uint8_t)columns[7][i];
+		}
+	}
+}
+
+static uint8_t* WriteVarint(uint8_t* out, uint32_t value) {
+	while (value >= 0x80) {
+		*out++ = (uint8_t)(value | 0x80);
+		value >>= 7;
+	}
+	*out++ = (uint8_t)value;
+	return out;
+}
+
+// ZORA: Returns nullptr if the varints run out or are malformed
+static const uint8_t* ReadVarint(const uint8_t* in, const uint8_t* end, uint32_t& value) {
+	value = 0;
+	for (uint32_t shift = 0;; shift += 7) {
+		if (in == end || shift > 28)
+			return nullptr;
+		uint8_t byte = *in++;
+		value |= (uint32_t)(byte & 0x7F) << shift;
+		if (byte < 0x80)
+			return in;
+	}
+}
+
+// ZORA: Write one column's deltas against the reference column as varints. Entities past the end of the reference are encoded against zero.
+// A field that didn't change has a delta of 0, and a run of them is written as a 0 followed by the length of the run less one, so a column that didn't change at all costs a few bytes rather than one per entity.
+static uint8_t* EncodeColumn(uint8_t* out, const uint32_t* column, uint32_t count, const uint32_t* reference, uint32_t referenceCount, uint32_t bits) {
+	uint32_t shift = 32 - bits;
+	uint32_t zeros = 0;
+	for (uint32_t i = 0; i < count; i++) {
+		uint32_t previous = i < referenceCount ? reference[i] : 0;
+		uint32_t delta;
+		if (bits == 0) {
+			delta = column[i] ^ previous;
+		}
+		else {
+			// ZORA: Sign extend the difference from the field's width, then zigzag it so -1 is 1, 1 is 2, and so on
+			int32_t difference = (int32_t)((column[i] - previous) << shift) >> shift;
+			delta = ((uint32_t)difference << 1) ^ (uint32_t)(difference >> 31);
+		}
+
+		if (delta == 0) {
+			zeros++;
+			continue;
+		}
+		if (zeros > 0) {
+			*out++ = 0;
+			out = WriteVarint(out, zeros - 1);
+			zeros = 0;
+		}
+		out = WriteVarint(out, delta);
+	}
+	if (zeros > 0) {
+		*out++ = 0;
+		out = WriteVarint(out, zeros - 1);
+	}
+	return out;
+}
+
+// ZORA: The inverse of EncodeColumn. Returns nullptr if the varints run out or are malformed.
+static const uint8_t* DecodeColumn(const uint8_t* in, const uint8_t* end, uint32_t* column, uint32_t count, const uint32_t* reference, uint32_t referenceCount, uint32_t bits) {
+	uint32_t mask = bits == 0 ? 0xFFFFFFFF : (1u << bits) - 1;
+	uint32_t zeros = 0;
+	for (uint32_t i = 0; i < count; i++) {
+		uint32_t previous = i < referenceCount ? reference[i] : 0;
+		if (zeros > 0) {
+			column[i] = previous;
+			zeros--;
+			continue;
+		}
+
+		uint32_t delta = 0;
+		in = ReadVarint(in, end, delta);
+		if (in == nullptr)
+			return nullptr;
+
+		// ZORA: A run of unchanged fields, this one included
+		if (delta == 0) {
+			in = ReadVarint(in, end, zeros);
+			if (in == nullptr || zeros > count - i - 1)
+				return nullptr;
+			column[i] = previous;
+			continue;
+		}
+
+		if (bits == 0)
+			column[i] = delta ^ previous;
+		else
+			column[i] = (previous + ((delta >> 1) ^ (0u - (delta & 1)))) & mask;
+	}
+	return in;
+}
+
+EntityEncoder::EntityEncoder() : m_packed(false), m_bounds{ 0, 0 }, m_deflate(false), m_keyframeInterval(0), m_framesSinceKeyframe(0), m_keyframeDue(false), m_keyframeGeneration(0), m_newest(0) {
+	for (auto& frame : m_history) {
+		frame.generation = 0;
+		frame.count = 0;
+	}
+}
+
+void EntityEncoder::SetPacking(bool packed, const EntityPackBounds& bounds) {
+	// ZORA: Frames kept in the other format can't be encoded against any more
+	if (packed != m_packed || bounds.width != m_bounds.width || bounds.height != m_bounds.height) {
+		for (auto& frame : m_history)
+			frame.generation = 0;
+		m_keyframeGeneration = 0;
+	}
+	m_packed = packed;
+	m_bounds = bounds;
+}
+
+void EntityEncoder::SetDeflate(bool deflate) {
+	m_deflate = deflate;
+}
+
+void EntityEncoder::SetKeyframeInterval(uint32_t frames) {
+	m_keyframeInterval = frames;
+}
+
+void EntityEncoder::AddFrame(const Entity* entities, uint32_t count, uint64_t generation) {
+	count = std::min(count, ENTITY_CODEC_MAX_COUNT);
+
+	// ZORA: Overwrite the oldest kept frame, unless that is the newest keyframe
+	m_newest = (m_newest + 1) % ENTITY_CODEC_HISTORY;
+	if (m_keyframeGeneration != 0 && m_history[m_newest].generation == m_keyframeGeneration)
+		m_newest = (m_newest + 1) % ENTITY_CODEC_HISTORY;
+	EntityCodecFrame& frame = m_history[m_newest];
+	frame.generation = generation;
+
+	if (m_packed) {
+		m_packedEntities.resize(count);
+		PackEntities(entities, m_packedEntities.data(), count, m_bounds);
+		FillColumns(frame, nullptr, m_packedEntities.data(), count);
+	}
+	else {
+		FillColumns(frame, entities, nullptr, count);
+	}
+
+	m_framesSinceKeyframe++;
+	m_keyframeDue = m_keyframeInterval > 0 && m_framesSinceKeyframe >= m_keyframeInterval;
+}
+
+bool EntityEncoder::EncodeFrame(uint64_t referenceGeneration, std::vector<uint8_t>& out) {
+	const EntityCodecFrame& frame = m_history[m_newest];
+	const EntityCodecFrame* reference = nullptr;
+	if (!m_keyframeDue && referenceGeneration != 0 && referenceGeneration < frame.generation)
+		reference = FindFrame(referenceGeneration);
+
+	EntityCodecHeader header;
+	header.magic = ENTITY_CODEC_MAGIC;
+	header.flags = (reference == nullptr ? (uint32_t)ENTITY_CODEC_KEYFRAME : 0) | (m_packed ? (uint32_t)ENTITY_CODEC_PACKED : 0);
+	header.generation = frame.generation;
+	header.referenceGeneration = reference != nullptr ? reference->generation : 0;
+	header.count = frame.count;
+	header.bounds = m_packed ? m_bounds : EntityPackBounds{ 0, 0 };
+	header.reserved = 0;
+
+	const uint32_t* fieldBits = m_packed ? PACKED_FIELD_BITS : RAW_FIELD_BITS;
+	m_varints.resize((size_t)frame.count * ENTITY_CODEC_FIELDS * MAX_VARINT_BYTES);
+	uint8_t* end = m_varints.data();
+	for (size_t field = 0; field < ENTITY_CODEC_FIELDS; field++) {
+		const uint32_t* column = frame.columns.data() + field * frame.count;
+		const uint32_t* referenceColumn = reference != nullptr ? reference->columns.data() + field * reference->count : nullptr;
+		end = EncodeColumn(end, column, frame.count, referenceColumn, reference != nullptr ? reference->count : 0, fieldBits[field]);
+	}
+	m_varints.resize(end - m_varints.data());
+	header.rawBytes = (uint32_t)m_varints.size();
+
+	// ZORA: DEFLATE is only kept when it actually made the frame smaller
+	unsigned char* compressed = nullptr;
+	int compressedBytes = 0;
+	if (m_deflate && !m_varints.empty())
+		compressed = CompressData(m_varints.data(), (int)m_varints.size(), &compressedBytes);
+	if (compressed != nullptr && compressedBytes > 0 && (size_t)compressedBytes < m_varints.size()) {
+		header.flags |= ENTITY_CODEC_DEFLATE;
+		header.payloadBytes = (uint32_t)compressedBytes;
+	}
+	else {
+		header.payloadBytes = header.rawBytes;
+	}
+
+	out.resize(sizeof(header) + header.payloadBytes);
+	memcpy(out.data(), &header, sizeof(header));
+	if (header.flags & ENTITY_CODEC_DEFLATE)
+		memcpy(out.data() + sizeof(header), compressed, header.payloadBytes);
+	else if (header.payloadBytes > 0)
+		memcpy(out.data() + sizeof(header), m_varints.data(), header.payloadBytes);
+
+	if (compressed != nullptr)
+		RL_FREE(compressed);
+
+	if (reference == nullptr) {
+		m_framesSinceKeyframe = 0;
+		m_keyframeGeneration = frame.generation;
+	}
+	return reference == nullptr;
+}
+
+uint64_t EntityEncoder::GetKeyframeGeneration() const {
+	return m_keyframeGeneration;
+}
+
+size_t EntityEncoder::GetRawBytes() const {
+	return m_varints.size();
+}
+
+const EntityCodecFrame* EntityEncoder::FindFrame(uint64_t generation) const {
+	for (const auto& frame : m_history) {
+		if (frame.generation == generation)
+			return &frame;
+	}
+	return nullptr;
+}
+
+EntityDecoder::EntityDecoder() : m_newest(0) {
+	Reset();
+}
+
+void EntityDecoder::Reset() {
+	for (auto& frame : m_history) {
+		frame.generation = 0;
+		frame.count = 0;
+	}
+}
+
+uint64_t EntityDecoder::GetGeneration() const {
+	return m_history[m_newest].generation;
+}
+
+const EntityCodecFrame* EntityDecoder::FindFrame(uint64_t generation) const {
+	for (const auto& frame : m_history) {
+		if (frame.generation == generation)
+			return &frame;
+	}
+	return nullptr;
+}
+
+bool EntityDecoder::Decode(const uint8_t* data, size_t size, std::vector<Entity>& entities) {
+	EntityCodecHeader header;
+	if (size < sizeof(header))
+		return false;
+	memcpy(&header, data, sizeof(header));
+
+	if (header.magic != ENTITY_CODEC_MAGIC || header.count > ENTITY_CODEC_MAX_COUNT || header.generation == 0 || size - sizeof(header) != header.payloadBytes ||
+		header.rawBytes > (size_t)header.count * ENTITY_CODEC_FIELDS * MAX_VARINT_BYTES)
+		return false;
+
+	const EntityCodecFrame* reference = nullptr;
+	if (!(header.flags & ENTITY_CODEC_KEYFRAME)) {
+		reference = FindFrame(header.referenceGeneration);
+		if (reference == nullptr)
+			return false;
+	}
+
+	// ZORA: Undo DEFLATE first, if it was used, and check it gives back exactly as many bytes as were encoded
+	const uint8_t* varints = data + sizeof(header);
+	if (header.flags & ENTITY_CODEC_DEFLATE) {
+		int decompressedBytes = 0;
+		unsigned char* decompressed = DecompressData((unsigned char*)varints, (int)header.payloadBytes, &decompressedBytes);
+		bool valid = decompressed != nullptr && decompressedBytes == (int)header.rawBytes;
+		if (valid)
+			m_varints.assign(decompressed, decompressed + decompressedBytes);
+		if (decompressed != nullptr)
+			RL_FREE(decompressed);
+		if (!valid)
+			return false;
+		varints = m_varints.data();
+	}
+	else if (header.payloadBytes != header.rawBytes) {
+		return false;
+	}
+
+	// ZORA: Decode into the oldest kept frame, unless that is the reference, so a corrupt frame never damages a frame that later ones depend on
+	size_t slot = (m_newest + 1) % ENTITY_CODEC_HISTORY;
+	if (&m_history[slot] == reference)
+		slot = (slot + 1) % ENTITY_CODEC_HISTORY;
+	EntityCodecFrame& frame = m_history[slot];
+	frame.generation = 0;
+	frame.count = header.count;
+	frame.columns.resize((size_t)header.count * ENTITY_CODEC_FIELDS);
+
+	bool packed = (header.flags & ENTITY_CODEC_PACKED) != 0;
+	const uint32_t* fieldBits = packed ? PACKED_FIELD_BITS : RAW_FIELD_BITS;
+	const uint8_t* in = varints;
+	const uint8_t* end = varints + header.rawBytes;
+	for (size_t field = 0; field < ENTITY_CODEC_FIELDS && in != nullptr; field++) {
+		uint32_t* column = frame.columns.data() + field * header.count;
+		const uint32_t* referenceColumn = reference != nullptr ? reference->columns.data() + field * reference->count : nullptr;
+		in = DecodeColumn(in, end, column, header.count, referenceColumn, reference != nullptr ? reference->count : 0, fieldBits[field]);
+	}
+	if (in != end)
+		return false;
+
+	frame.generation = header.generation;
+	m_newest = slot;
+
+	entities.resize(header.count);
+	if (packed) {
+		m_packedEntities.resize(header.count);
+		EmptyColumns(frame, nullptr, m_packedEntities.data());
+		UnpackEntities(m_packedEntities.data(), entities.data(), header.count, header.bounds);
+	}
+	else {
+		EmptyColumns(frame, entities.data(), nullptr);
+	}
+	return true;
+}
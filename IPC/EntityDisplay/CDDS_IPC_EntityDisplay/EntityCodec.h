@@ -0,0 +1,110 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Entity.h"
+#include "EntityPacking.h"
+
+// ZORA: Written at the front of every encoded frame
+const uint32_t ENTITY_CODEC_MAGIC = 0x43444345;	// 'ECDC'
+
+// ZORA: The number of recent frames each end keeps to encode against and decode against. A reference older than this is gone, and the frame is sent as a keyframe instead.
+const uint32_t ENTITY_CODEC_HISTORY = 4;
+
+// ZORA: The most entities in one encoded frame. Anything claiming more is treated as corrupt rather than allocated.
+const uint32_t ENTITY_CODEC_MAX_COUNT = 16 * 1024 * 1024;
+
+enum EntityCodecFlags : uint32_t {
+	ENTITY_CODEC_KEYFRAME = 1,		// ZORA: Encoded against nothing, so it decodes on its own
+	ENTITY_CODEC_PACKED = 2,		// ZORA: The fields are PackedEntity's fixed point rather than Entity's floats
+	ENTITY_CODEC_DEFLATE = 4		// ZORA: The varints were compressed with DEFLATE after encoding
+};
+
+// ZORA: The front of every encoded frame, followed by payloadBytes of varints, DEFLATEd if the flag says so
+struct EntityCodecHeader {
+	uint32_t magic;
+	uint32_t flags;
+	uint64_t generation;			// ZORA: The frame this is
+	uint64_t referenceGeneration;	// ZORA: The frame it was encoded against, 0 for a keyframe
+	uint32_t count;					// ZORA: The number of entities in the frame
+	uint32_t rawBytes;				// ZORA: The size of the varints before DEFLATE
+	uint32_t payloadBytes;			// ZORA: The number of bytes following the header
+	EntityPackBounds bounds;		// ZORA: The screen a packed frame is fixed point across. Unused when not packed.
+	uint32_t reserved;
+};
+
+// ZORA: The fields of an entity, each of which is delta encoded on its own
+enum { ENTITY_CODEC_FIELDS = 8 };
+
+// ZORA: One frame as the codec sees it: every field of every entity as an integer, a column per field, so each field's deltas sit next to each other for DEFLATE to find
+struct EntityCodecFrame {
+	uint64_t generation;
+	uint32_t count;
+	std::vector<uint32_t> columns;
+};
+
+// ZORA: Encodes entity frames for streams that go over a network or onto disk. Each frame is delta encoded against an earlier one the other end is known to have, a field at a time, so fields that didn't change cost next to nothing.
+// Float fields are XORed with the reference, which leaves zeros wherever the bits match. Fixed point and colour fields are subtracted and zigzagged, so small moves either way are small numbers. Every field is then written as a varint, and the lot can optionally be DEFLATEd with raylib's CompressData.
+// Every keyframe interval frames, or whenever the reference is missing, the frame is encoded against nothing instead, so a reader can start there. The newest keyframe is always kept, however long ago it was, so frames can be encoded against it.
+class EntityEncoder {
+public:
+	EntityEncoder();
+
+	// ZORA: Encode PackedEntity fields fixed point across 'bounds' rather than Entity's floats. Smaller again, at PackedEntity's precision.
+	void SetPacking(bool packed, const EntityPackBounds& bounds);
+	void SetDeflate(bool deflate);
+
+	// ZORA: Encode a keyframe at least every 'frames' frames. 0 only encodes keyframes when there is no reference.
+	void SetKeyframeInterval(uint32_t frames);
+
+	// ZORA: Take 'count' entities as frame 'generation' and keep it to encode against later. Generations must go up.
+	void AddFrame(const Entity* entities, uint32_t count, uint64_t generation);
+
+	// ZORA: Encode the frame most recently added into 'out', against 'referenceGeneration' if that is still kept and a keyframe isn't due. Pass 0 to ask for a keyframe. Returns true if it encoded a keyframe.
+	bool EncodeFrame(uint64_t referenceGeneration, std::vector<uint8_t>& out);
+
+	// ZORA: The generation of the newest keyframe encoded, 0 if none
+	uint64_t GetKeyframeGeneration() const;
+
+	// ZORA: The bytes the last frame took before DEFLATE, for working out how much DEFLATE is saving
+	size_t GetRawBytes() const;
+
+private:
+	const EntityCodecFrame* FindFrame(uint64_t generation) const;
+
+	bool m_packed;
+	EntityPackBounds m_bounds;
+	bool m_deflate;
+	uint32_t m_keyframeInterval;
+	uint32_t m_framesSinceKeyframe;
+	bool m_keyframeDue;
+	uint64_t m_keyframeGeneration;
+
+	EntityCodecFrame m_history[ENTITY_CODEC_HISTORY];
+	size_t m_newest;
+	std::vector<PackedEntity> m_packedEntities;
+	std::vector<uint8_t> m_varints;
+};
+
+// ZORA: Decodes what an EntityEncoder encoded. Keeps the frames it decoded most recently, so the next frame can be decoded against whichever of them the encoder used.
+class EntityDecoder {
+public:
+	EntityDecoder();
+
+	// ZORA: Decode one encoded frame into 'entities' and keep it to decode later frames against. Returns false, leaving 'entities' untouched, if the frame is corrupt or was encoded against a frame this decoder doesn't have.
+	bool Decode(const uint8_t* data, size_t size, std::vector<Entity>& entities);
+
+	// ZORA: The generation of the frame most recently decoded, 0 if none
+	uint64_t GetGeneration() const;
+
+	// ZORA: Forget every frame, so only a keyframe will decode next
+	void Reset();
+
+private:
+	const EntityCodecFrame* FindFrame(uint64_t generation) const;
+
+	EntityCodecFrame m_history[ENTITY_CODEC_HISTORY];
+	size_t m_newest;
+	std::vector<PackedEntity> m_packedEntities;
+	std::vector<uint8_t> m_varints;
+};
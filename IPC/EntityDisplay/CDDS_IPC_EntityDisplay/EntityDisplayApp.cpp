@@ -1,6 +1,8 @@
 #include "EntityDisplayApp.h"
+#include <cstdlib>
 
-EntityDisplayApp::EntityDisplayApp(int screenWidth, int screenHeight) : m_screenWidth(screenWidth), m_screenHeight(screenHeight) {
+EntityDisplayApp::EntityDisplayApp(int screenWidth, int screenHeight) : m_screenWidth(screenWidth), m_screenHeight(screenHeight), m_entities(nullptr), m_entityCount(0), m_selection(-1), m_dragPosition{ 0, 0 }, m_selectionName(nullptr), m_selectionNameBytes(0),
+	m_timelineFrame(0), m_timelineFrames(0), m_timelineDragging(false), m_seekFrame(-1), m_seekExact(false), m_status(nullptr), m_latency(nullptr), m_dumpLatency(false) {
 
 }
 
@@ -21,8 +23,78 @@ void EntityDisplayApp::Shutdown() {
 	CloseWindow();        // Close window and OpenGL context
 }
 
+// ZORA: The entity under 'point', checking from the last drawn to the first so the one on top wins, or -1 if there isn't one. Rotation is ignored, so this is only approximate for rotated entities.
+static int FindEntityAt(const Entity* entities, size_t count, Vector2 point) {
+	for (size_t i = count; i-- > 0;) {
+		const Entity& entity = entities[i];
+		float half = entity.size / 2;
+		if (point.x >= entity.x - half && point.x <= entity.x + half && point.y >= entity.y - half && point.y <= entity.y + half)
+			return (int)i;
+	}
+	return -1;
+}
+
+// ZORA: Where the replay's timeline is drawn, along the bottom of the window
+static Rectangle GetTimelineBounds(int screenWidth, int screenHeight) {
+	return Rectangle{ 10, (float)screenHeight - 24, (float)screenWidth - 20, 14 };
+}
+
+// ZORA: The frame under 'x' on the timeline
+static uint64_t GetTimelineFrame(Rectangle bounds, float x, uint64_t frameCount) {
+	float along = (x - bounds.x) / bounds.width;
+	along = along < 0 ? 0 : along > 1 ? 1 : along;
+	return (uint64_t)(along * (float)(frameCount - 1) + 0.5f);
+}
+
 void EntityDisplayApp::Update(float deltaTime) {
+	Vector2 mouse = GetMousePosition();
+
+	if (IsKeyPressed(KEY_L))
+		m_dumpLatency = true;
+
+	// ZORA: The timeline takes the mouse from the entities while it is being dragged
+	Rectangle timeline = GetTimelineBounds(m_screenWidth, m_screenHeight);
+	if (m_timelineFrames > 0 && IsMouseButtonPressed(MOUSE_LEFT_BUTTON) && CheckCollisionPointRec(mouse, timeline))
+		m_timelineDragging = true;
+
+	if (m_timelineDragging) {
+		uint64_t frame = GetTimelineFrame(timeline, mouse.x, m_timelineFrames);
+		if (IsMouseButtonReleased(MOUSE_LEFT_BUTTON) || !IsMouseButtonDown(MOUSE_LEFT_BUTTON)) {
+			m_timelineDragging = false;
+			m_seekFrame = (int64_t)frame;
+			m_seekExact = true;
+		}
+
+		// ZORA: Only seek again once the mouse has moved to another frame
+		else if (frame != m_timelineFrame) {
+			m_seekFrame = (int64_t)frame;
+			m_seekExact = false;
+			m_timelineFrame = frame;
+		}
+	}
+
+	else if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON)) {
+		m_selection = FindEntityAt(m_entities, m_entityCount, mouse);
+		m_dragPosition = mouse;
+		if (m_selection >= 0)
+			m_commands.push_back(EntityCommand{ ENTITY_COMMAND_SELECT, (uint32_t)m_selection, 0, 0, 0, 0, 0, 0 });
+	}
+
+	// ZORA: At most one move per frame while dragging, and none while the mouse is still, however fast the mouse moves
+	else if (IsMouseButtonDown(MOUSE_LEFT_BUTTON) && m_selection >= 0 && (mouse.x != m_dragPosition.x || mouse.y != m_dragPosition.y)) {
+		m_dragPosition = mouse;
+		m_commands.push_back(EntityCommand{ ENTITY_COMMAND_MOVE, (uint32_t)m_selection, 0, mouse.x, mouse.y, 0, 0, 0 });
+	}
+
+	if (IsMouseButtonPressed(MOUSE_RIGHT_BUTTON)) {
+		int target = FindEntityAt(m_entities, m_entityCount, mouse);
+		if (target >= 0)
+			m_commands.push_back(EntityCommand{ ENTITY_COMMAND_RECOLOUR, (uint32_t)target, 0, 0, 0, (unsigned char)(rand() % 255), (unsigned char)(rand() % 255), (unsigned char)(rand() % 255) });
+	}
 
+	// ZORA: The view may have shrunk since the entity was clicked
+	if (m_selection >= (int)m_entityCount)
+		m_selection = -1;
 }
 
 void EntityDisplayApp::Draw() {
@@ -31,7 +103,8 @@ void EntityDisplayApp::Draw() {
 	ClearBackground(RAYWHITE);
 
 	// draw entities
-	for (auto& entity : m_entities) {
+	for (size_t i = 0; i < m_entityCount; i++) {
+		const Entity& entity = m_entities[i];
 		DrawRectanglePro(
 			Rectangle{ entity.x, entity.y, entity.size, entity.size }, // rectangle
 			Vector2{ entity.size / 2, entity.size / 2 }, // origin
@@ -39,12 +112,72 @@ void EntityDisplayApp::Draw() {
 			Color{ entity.r, entity.g, entity.b, 255 });
 	}
 
+	// ZORA: Outline the entity being edited from here
+	if (m_selection >= 0 && m_selection < (int)m_entityCount) {
+		const Entity& entity = m_entities[m_selection];
+		DrawRectangleLines((int)(entity.x - entity.size / 2) - 2, (int)(entity.y - entity.size / 2) - 2, (int)entity.size + 4, (int)entity.size + 4, DARKGRAY);
+		if (m_selectionName != nullptr)
+			DrawText(TextFormat("%.*s", (int)m_selectionNameBytes, m_selectionName), (int)(entity.x - entity.size / 2), (int)(entity.y - entity.size / 2) - 16, 12, DARKGRAY);
+	}
+
+	// ZORA: The replay's timeline, filled up to the frame on screen
+	if (m_timelineFrames > 0) {
+		Rectangle timeline = GetTimelineBounds(m_screenWidth, m_screenHeight);
+		float along = m_timelineFrames > 1 ? (float)m_timelineFrame / (float)(m_timelineFrames - 1) : 1;
+		DrawRectangleRec(timeline, Fade(LIGHTGRAY, 0.8f));
+		DrawRectangleRec(Rectangle{ timeline.x, timeline.y, timeline.width * along, timeline.height }, Fade(DARKGRAY, 0.8f));
+		DrawText(TextFormat("Frame %llu / %llu", (unsigned long long)m_timelineFrame, (unsigned long long)m_timelineFrames), (int)timeline.x, (int)timeline.y - 16, 12, DARKGRAY);
+	}
+
+	// ZORA: How old the entities were when they reached the screen, below the banner so both can be seen at once
+	if (m_latency != nullptr && m_latency->GetCount() > 0) {
+		DrawText(TextFormat("Latency p50 %.2f ms  p99 %.2f ms  p99.9 %.2f ms  (%llu frames, L to dump)",
+			m_latency->GetPercentile(50) / 1000.0, m_latency->GetPercentile(99) / 1000.0, m_latency->GetPercentile(99.9) / 1000.0, (unsigned long long)m_latency->GetCount()),
+			10, 30, 12, DARKGRAY);
+	}
+
+	// ZORA: A banner over the entities, so stale entities can't be mistaken for live ones
+	if (m_status != nullptr) {
+		DrawRectangle(0, 0, m_screenWidth, 24, Fade(MAROON, 0.85f));
+		DrawText(m_status, 10, 6, 12, RAYWHITE);
+	}
+
 	// output some text, uses the last used colour
 	DrawText("Press ESC to quit", 630, 15, 12, LIGHTGRAY);
 
 	EndDrawing();
 }
 
-std::vector<Entity> EntityDisplayApp::GetArray() {
+void EntityDisplayApp::SetEntities(const Entity* entities, size_t count) {
+	m_entities = entities;
+	m_entityCount = count;
+}
+
+const Entity* EntityDisplayApp::GetEntities() const {
 	return m_entities;
+}
+
+size_t EntityDisplayApp::GetEntityCount() const {
+	return m_entityCount;
+}
+
+void EntityDisplayApp::SetTimeline(uint64_t frame, uint64_t frameCount) {
+	m_timelineFrames = frameCount;
+
+	// ZORA: While dragging, the timeline shows where the mouse is rather than the frame last landed on
+	if (!m_timelineDragging)
+		m_timelineFrame = frame;
+}
+
+void EntityDisplayApp::SetStatus(const char* status) {
+	m_status = status;
+}
+
+void EntityDisplayApp::SetLatency(const LatencyHistogram* latency) {
+	m_latency = latency;
+}
+
+void EntityDisplayApp::SetSelectionName(const char* name, uint32_t bytes) {
+	m_selectionName = name;
+	m_selectionNameBytes = bytes;
 }
\ No newline at end of file
@@ -1,15 +1,11 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
 #include <vector>
 #include "raylib.h"
-#include "WinInc.h"
-
-struct Entity {
-	float x = 0, y = 0;
-	float rotation = 0;
-	float speed = 0;
-	unsigned char r = 0, g = 0, b = 0;
-	float size = 1;
-};
+#include "Entity.h"
+#include "EntityCommandRing.h"
+#include "LatencyHistogram.h"
 
 class EntityDisplayApp  {
 public:
@@ -22,12 +18,51 @@ public:
 	void Update(float deltaTime);
 	void Draw();
 
-	std::vector<Entity> GetArray();
+	// ZORA: Point the app at the entities to draw. Nothing is copied; the entities must stay where they are until the next call.
+	void SetEntities(const Entity* entities, size_t count);
+
+	const Entity* GetEntities() const;
+	size_t GetEntityCount() const;
+
+	// ZORA: Show a timeline along the bottom of the window for a replay of 'frameCount' frames, currently at 'frame'. 0 frames hides it.
+	void SetTimeline(uint64_t frame, uint64_t frameCount);
+
+	// ZORA: Show 'status' across the top of the window, to warn that the entities on screen aren't being updated. A nullptr hides it.
+	void SetStatus(const char* status);
+
+	// ZORA: Show the percentiles of 'latency' in the corner of the window. A nullptr, or a histogram with nothing in it, hides them.
+	void SetLatency(const LatencyHistogram* latency);
+
+	// ZORA: Label the selected entity with the 'bytes' bytes of 'name', which needn't end in a 0. Nothing is copied, so the name must stay where it is until Draw returns. A nullptr leaves it unlabelled.
+	void SetSelectionName(const char* name, uint32_t bytes);
 
 //protected:
 	int m_screenWidth;
 	int m_screenHeight;
 
-	// an array of an unknown number of entities
-	std::vector<Entity> m_entities;
+	// ZORA: A read-only view of an unknown number of entities. The app doesn't own them; they live in the snapshot that main.cpp keeps patched.
+	const Entity* m_entities;
+	size_t m_entityCount;
+
+	// ZORA: The entity last clicked, or -1. Left click selects and drags an entity, right click gives it a random colour.
+	int m_selection;
+	Vector2 m_dragPosition;
+	const char* m_selectionName;
+	uint32_t m_selectionNameBytes;
+
+	// ZORA: Edits made by Update for main.cpp to send on to the Editor. 'index' is the entity's place in the view, which main.cpp translates into the entity's handle in its Editor.
+	std::vector<EntityCommand> m_commands;
+
+	// ZORA: The replay's timeline. Dragging it sets m_seekFrame for main.cpp to seek to, or it is -1. While dragging the seek only needs to land near the frame, so scrubbing stays quick. Letting go asks for the frame exactly.
+	uint64_t m_timelineFrame;
+	uint64_t m_timelineFrames;
+	bool m_timelineDragging;
+	int64_t m_seekFrame;
+	bool m_seekExact;
+
+	const char* m_status;
+
+	// ZORA: Set by Update when L is pressed, for main.cpp to write the latency histogram out and clear
+	const LatencyHistogram* m_latency;
+	bool m_dumpLatency;
 };
\ No newline at end of file
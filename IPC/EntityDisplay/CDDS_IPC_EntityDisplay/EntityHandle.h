@@ -0,0 +1,74 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ZORA: Stands in for "no entity" wherever an index is expected, and ends the free list
+const uint32_t ENTITY_HANDLE_NONE = 0xFFFFFFFF;
+
+// ZORA: A long-lived reference to one entity. 'index' picks a slot in the handle table and 'generation' must match the slot's, so a handle to an entity that has been despawned stops resolving rather than quietly picking up whatever took its slot.
+// Live generations are always odd, so the zeroed handle is never valid and can be used as "nothing".
+struct EntityHandle {
+	uint32_t index;
+	uint32_t generation;
+};
+
+inline bool operator==(const EntityHandle& a, const EntityHandle& b) {
+	return a.index == b.index && a.generation == b.generation;
+}
+
+inline bool operator!=(const EntityHandle& a, const EntityHandle& b) {
+	return !(a == b);
+}
+
+// ZORA: A slot as it is shared with other processes: the generation in the top 32 bits and the index of the entity it refers to in the bottom 32. A free slot has an even generation, so no handle matches it.
+inline uint64_t PackEntityHandleSlot(uint32_t generation, uint32_t entityIndex) {
+	return ((uint64_t)generation << 32) | entityIndex;
+}
+
+// ZORA: The Editor's table of handles, mapping each handle to the entity's place in the dense array and back again.
+// Spawning pops a slot off a free list and despawning pushes it back, so both are O(1) however many entities come and go. The free list is threaded through the free slots themselves, as an index where a live slot keeps its entity's, so the table costs nothing on top of its two arrays.
+// Every slot that changed since ClearChanges is remembered, so the segment only has to copy those across to the Display.
+class EntityHandleTable {
+public:
+	EntityHandleTable();
+
+	// ZORA: A new handle for the entity at 'entityIndex'. Reuses the most recently freed slot, with its generation moved on.
+	EntityHandle Spawn(uint32_t entityIndex);
+
+	// ZORA: Free 'handle''s slot. Returns false, changing nothing, if it has already gone.
+	bool Despawn(EntityHandle handle);
+
+	// ZORA: Record that 'handle''s entity now lives at 'entityIndex', after the dense array was rearranged
+	void Move(EntityHandle handle, uint32_t entityIndex);
+
+	// ZORA: Where 'handle''s entity lives in the dense array. Returns false if the handle has gone or never existed.
+	bool Resolve(EntityHandle handle, uint32_t& entityIndex) const;
+
+	// ZORA: The handle of the entity at 'entityIndex', or the zeroed handle if there is none
+	EntityHandle GetHandle(uint32_t entityIndex) const;
+
+	// ZORA: The handle slot of the entity at 'entityIndex', or ENTITY_HANDLE_NONE
+	uint32_t GetEntitySlot(uint32_t entityIndex) const;
+
+	// ZORA: The number of slots ever used, live and free. Handles only ever index below this.
+	uint32_t GetSlotCount() const;
+
+	// ZORA: Slot 'index' packed by PackEntityHandleSlot
+	uint64_t GetPackedSlot(uint32_t index) const;
+
+	// ZORA: The slots spawned, despawned or moved since the last ClearChanges, possibly more than once each
+	const std::vector<uint32_t>& GetChanges() const;
+	void ClearChanges();
+
+private:
+	struct Slot {
+		uint32_t generation;
+		uint32_t entityIndex;	// ZORA: The entity's place in the dense array while the slot is live, the next free slot while it is free
+	};
+
+	std::vector<Slot> m_slots;
+	std::vector<uint32_t> m_slotsByEntity;	// ZORA: The slot of the entity at each place in the dense array
+	uint32_t m_freeHead;
+	std::vector<uint32_t> m_changes;
+};
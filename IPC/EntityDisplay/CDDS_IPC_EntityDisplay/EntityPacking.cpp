@@ -0,0 +1,162 @@
+#include "EntityPacking.h"
+#include <cmath>
+
+// ZORA: SSE2 is always there on x64, and on 32 bit x86 when the compiler has been told to use it
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ENTITY_PACKING_SSE2
+#include <emmintrin.h>
+#endif
+
+// ZORA: One turn of rotation in fixed point. The 16 bits wrap around the circle, so 360 degrees is 65536 rather than 65535.
+static const float ROTATION_STEPS = 65536.0f;
+
+// ZORA: The rotation is clamped to this many steps either side of zero before it is wrapped, which is still tens of thousands of turns, so that huge or NaN rotations wrap to a defined value
+static const float ROTATION_LIMIT = 1073741824.0f;
+
+// ZORA: The scales from Entity values to fixed point and back. Every kernel uses the same ones, so SSE2 and scalar give identical results.
+struct PackScales {
+	float x, y, rotation, speed, size;
+};
+
+static PackScales GetPackScales(const EntityPackBounds& bounds) {
+	PackScales scales;
+	scales.x = bounds.width > 0 ? 65535.0f / bounds.width : 0;
+	scales.y = bounds.height > 0 ? 65535.0f / bounds.height : 0;
+	scales.rotation = ROTATION_STEPS / 360.0f;
+	scales.speed = 255.0f / ENTITY_PACK_MAX_SPEED;
+	scales.size = 255.0f / ENTITY_PACK_MAX_SIZE;
+	return scales;
+}
+
+static PackScales GetUnpackScales(const EntityPackBounds& bounds) {
+	PackScales scales;
+	scales.x = bounds.width / 65535.0f;
+	scales.y = bounds.height / 65535.0f;
+	scales.rotation = 360.0f / ROTATION_STEPS;
+	scales.speed = ENTITY_PACK_MAX_SPEED / 255.0f;
+	scales.size = ENTITY_PACK_MAX_SIZE / 255.0f;
+	return scales;
+}
+
+// ZORA: Clamp then round to nearest, written to behave exactly like _mm_max_ps, _mm_min_ps and _mm_cvtps_epi32, NaN included
+static int32_t Quantize(float value, float low, float high) {
+	value = value > low ? value : low;
+	value = value < high ? value : high;
+	return (int32_t)std::lrint(value);
+}
+
+static void PackEntity(const Entity& entity, PackedEntity& packed, const PackScales& scales) {
+	packed.x = (uint16_t)Quantize(entity.x * scales.x, 0, 65535.0f);
+	packed.y = (uint16_t)Quantize(entity.y * scales.y, 0, 65535.0f);
+	packed.rotation = (uint16_t)(Quantize(entity.rotation * scales.rotation, -ROTATION_LIMIT, ROTATION_LIMIT) & 0xFFFF);
+	packed.speed = (uint8_t)Quantize(entity.speed * scales.speed, 0, 255.0f);
+	packed.size = (uint8_t)Quantize(entity.size * scales.size, 0, 255.0f);
+	packed.r = entity.r;
+	packed.g = entity.g;
+	packed.b = entity.b;
+}
+
+static void UnpackEntity(const PackedEntity& packed, Entity& entity, const PackScales& scales) {
+	entity.x = (float)packed.x * scales.x;
+	entity.y = (float)packed.y * scales.y;
+	entity.rotation = (float)packed.rotation * scales.rotation;
+	entity.speed = (float)packed.speed * scales.speed;
+	entity.size = (float)packed.size * scales.size;
+	entity.r = packed.r;
+	entity.g = packed.g;
+	entity.b = packed.b;
+}
+
+void PackEntities(const Entity* entities, PackedEntity* packed, size_t count, const EntityPackBounds& bounds) {
+	PackScales scales = GetPackScales(bounds);
+	size_t i = 0;
+
+#ifdef ENTITY_PACKING_SSE2
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 maxShort = _mm_set1_ps(65535.0f);
+	const __m128 maxByte = _mm_set1_ps(255.0f);
+	const __m128 rotationLow = _mm_set1_ps(-ROTATION_LIMIT);
+	const __m128 rotationHigh = _mm_set1_ps(ROTATION_LIMIT);
+	const __m128 scaleX = _mm_set1_ps(scales.x);
+	const __m128 scaleY = _mm_set1_ps(scales.y);
+	const __m128 scaleRotation = _mm_set1_ps(scales.rotation);
+	const __m128 scaleSpeed = _mm_set1_ps(scales.speed);
+	const __m128 scaleSize = _mm_set1_ps(scales.size);
+
+	for (; i + 4 <= count; i += 4) {
+		const Entity* e = entities + i;
+
+		// ZORA: x, y, rotation and speed sit next to each other at the front of every Entity, so load four entities' worth and transpose them into one register per field
+		__m128 x = _mm_loadu_ps(&e[0].x);
+		__m128 y = _mm_loadu_ps(&e[1].x);
+		__m128 rotation = _mm_loadu_ps(&e[2].x);
+		__m128 speed = _mm_loadu_ps(&e[3].x);
+		_MM_TRANSPOSE4_PS(x, y, rotation, speed);
+		__m128 size = _mm_setr_ps(e[0].size, e[1].size, e[2].size, e[3].size);
+
+		alignas(16) int32_t qx[4], qy[4], qRotation[4], qSpeed[4], qSize[4];
+		_mm_store_si128((__m128i*)qx, _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(x, scaleX), zero), maxShort)));
+		_mm_store_si128((__m128i*)qy, _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(y, scaleY), zero), maxShort)));
+		_mm_store_si128((__m128i*)qRotation, _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(rotation, scaleRotation), rotationLow), rotationHigh)));
+		_mm_store_si128((__m128i*)qSpeed, _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(speed, scaleSpeed), zero), maxByte)));
+		_mm_store_si128((__m128i*)qSize, _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(size, scaleSize), zero), maxByte)));
+
+		for (int k = 0; k < 4; k++) {
+			PackedEntity& p = packed[i + k];
+			p.x = (uint16_t)qx[k];
+			p.y = (uint16_t)qy[k];
+			p.rotation = (uint16_t)(qRotation[k] & 0xFFFF);
+			p.speed = (uint8_t)qSpeed[k];
+			p.size = (uint8_t)qSize[k];
+			p.r = e[k].r;
+			p.g = e[k].g;
+			p.b = e[k].b;
+		}
+	}
+#endif
+
+	for (; i < count; i++)
+		PackEntity(entities[i], packed[i], scales);
+}
+
+void UnpackEntities(const PackedEntity* packed, Entity* entities, size_t count, const EntityPackBounds& bounds) {
+	PackScales scales = GetUnpackScales(bounds);
+	size_t i = 0;
+
+#ifdef ENTITY_PACKING_SSE2
+	const __m128 scaleX = _mm_set1_ps(scales.x);
+	const __m128 scaleY = _mm_set1_ps(scales.y);
+	const __m128 scaleRotation = _mm_set1_ps(scales.rotation);
+	const __m128 scaleSpeed = _mm_set1_ps(scales.speed);
+	const __m128 scaleSize = _mm_set1_ps(scales.size);
+
+	for (; i + 4 <= count; i += 4) {
+		const PackedEntity* p = packed + i;
+		Entity* e = entities + i;
+
+		__m128 x = _mm_mul_ps(_mm_cvtepi32_ps(_mm_setr_epi32(p[0].x, p[1].x, p[2].x, p[3].x)), scaleX);
+		__m128 y = _mm_mul_ps(_mm_cvtepi32_ps(_mm_setr_epi32(p[0].y, p[1].y, p[2].y, p[3].y)), scaleY);
+		__m128 rotation = _mm_mul_ps(_mm_cvtepi32_ps(_mm_setr_epi32(p[0].rotation, p[1].rotation, p[2].rotation, p[3].rotation)), scaleRotation);
+		__m128 speed = _mm_mul_ps(_mm_cvtepi32_ps(_mm_setr_epi32(p[0].speed, p[1].speed, p[2].speed, p[3].speed)), scaleSpeed);
+		alignas(16) float size[4];
+		_mm_store_ps(size, _mm_mul_ps(_mm_cvtepi32_ps(_mm_setr_epi32(p[0].size, p[1].size, p[2].size, p[3].size)), scaleSize));
+
+		// ZORA: Transpose back to one register per entity and store each straight over the front of its Entity
+		_MM_TRANSPOSE4_PS(x, y, rotation, speed);
+		_mm_storeu_ps(&e[0].x, x);
+		_mm_storeu_ps(&e[1].x, y);
+		_mm_storeu_ps(&e[2].x, rotation);
+		_mm_storeu_ps(&e[3].x, speed);
+
+		for (int k = 0; k < 4; k++) {
+			e[k].size = size[k];
+			e[k].r = p[k].r;
+			e[k].g = p[k].g;
+			e[k].b = p[k].b;
+		}
+	}
+#endif
+
+	for (; i < count; i++)
+		UnpackEntity(packed[i], entities[i], scales);
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "Entity.h"
+#include "EntityColumns.h"
+#include "EntityHandle.h"
+
+// ZORA: The Editor's side of a transport. The Editor marks the entities that changed, then publishes the whole array once a frame, and the transport decides how much of it actually has to travel.
+class EntityPublisher {
+public:
+	virtual ~EntityPublisher() {}
+
+	// ZORA: Record that the entity at 'index' has changed since the last Publish
+	virtual void MarkDirty(uint32_t index) = 0;
+	virtual void MarkAllDirty() = 0;
+
+	// ZORA: Send 'count' entities as the newest frame
+	virtual void Publish(const Entity* entities, uint32_t count) = 0;
+
+	// ZORA: Whether the transport can be given the Editor's columns directly through PublishColumns. A transport that sends whole Entity structs leaves this false, and the Editor gathers them for it.
+	virtual bool AcceptsColumns() const { return false; }
+
+	// ZORA: Send 'count' entities held column by column as the newest frame. Only called when AcceptsColumns is true.
+	virtual void PublishColumns(const EntityColumns&, uint32_t) {}
+
+	// ZORA: Share the handle table, so a Display can keep hold of an entity while others come and go. Called just before Publish, so every entity in a published frame already has its handle shared. A transport with nowhere to put handles ignores them.
+	virtual void PublishHandles(const EntityHandleTable&) {}
+
+	// ZORA: The most entities Publish will send, and a way to ask for more room. A transport without a fixed size reports its upper limit and never resizes.
+	virtual uint32_t GetRangeCapacity() const = 0;
+	virtual bool Resize(uint32_t capacity) = 0;
+};
+
+// ZORA: The Display's side of a transport
+class EntitySubscriber {
+public:
+	virtual ~EntitySubscriber() {}
+
+	// ZORA: Bring 'entities' up to date with the newest complete frame. Pass the same vector every time so only what changed is copied. Returns false, leaving 'entities' untouched, if no consistent frame could be read.
+	virtual bool ReadSnapshot(std::vector<Entity>& entities) = 0;
+
+	// ZORA: Sleep until a frame newer than 'generation' arrives, or until 'timeoutMs' milliseconds pass. Returns true if there is a newer frame.
+	virtual bool WaitForFrame(uint64_t generation, int timeoutMs) = 0;
+
+	// ZORA: The generation of the frame most recently returned by ReadSnapshot
+	virtual uint64_t GetSnapshotGeneration() const = 0;
+
+	// ZORA: When the Editor published the frame most recently returned by ReadSnapshot, in GetMonotonicMicroseconds, or 0 if the transport can't tell. Only a transport between processes on the same machine shares that clock with the Editor.
+	virtual uint64_t GetSnapshotPublishedUs() const { return 0; }
+
+	// ZORA: The most entities a snapshot can currently hold, for reserving room up front
+	virtual uint32_t GetCapacity() const = 0;
+};
@@ -0,0 +1,124 @@
+#include "FrameSignal.h"
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <thread>
+
+#ifdef _WIN32
+#include "WinInc.h"
+#elif defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+FrameSignal::FrameSignal() : m_semaphore(nullptr) {
+
+}
+
+FrameSignal::~FrameSignal() {
+	Close();
+}
+
+// ZORA: The semaphore gets its own name alongside the shared memory's
+static void MakeSemaphoreName(char* out, size_t outSize, const char* name) {
+	snprintf(out, outSize, "%s.FrameReady", name);
+}
+
+bool FrameSignal::Create(const char* name) {
+	Close();
+
+	char semaphoreName[256];
+	MakeSemaphoreName(semaphoreName, sizeof(semaphoreName), name);
+	m_semaphore = CreateSemaphoreA(nullptr, 0, LONG_MAX, semaphoreName);
+	return m_semaphore != nullptr;
+}
+
+bool FrameSignal::Open(const char* name) {
+	Close();
+
+	char semaphoreName[256];
+	MakeSemaphoreName(semaphoreName, sizeof(semaphoreName), name);
+	m_semaphore = OpenSemaphoreA(SEMAPHORE_ALL_ACCESS, FALSE, semaphoreName);
+	return m_semaphore != nullptr;
+}
+
+void FrameSignal::Close() {
+	if (m_semaphore != nullptr) {
+		CloseHandle(m_semaphore);
+		m_semaphore = nullptr;
+	}
+}
+
+void FrameSignal::Wake(std::atomic<uint32_t>* word, uint32_t waiters) {
+	// ZORA: A reader that timed out just before this leaves a spare count behind, which only costs some later reader an early return
+	if (m_semaphore != nullptr && waiters > 0)
+		ReleaseSemaphore(m_semaphore, (LONG)waiters, nullptr);
+}
+
+void FrameSignal::Wait(std::atomic<uint32_t>* word, uint32_t expected, int timeoutMs) {
+	if (m_semaphore == nullptr) {
+		Sleep(1);
+		return;
+	}
+
+	if (word->load(std::memory_order_acquire) == expected)
+		WaitForSingleObject(m_semaphore, (DWORD)timeoutMs);
+}
+
+#else
+
+FrameSignal::FrameSignal() {
+
+}
+
+FrameSignal::~FrameSignal() {
+	Close();
+}
+
+// ZORA: A futex needs nothing but the word in shared memory, so there is nothing to create or open
+bool FrameSignal::Create(const char*) {
+	return true;
+}
+
+bool FrameSignal::Open(const char*) {
+	return true;
+}
+
+void FrameSignal::Close() {
+
+}
+
+#ifdef __linux__
+
+void FrameSignal::Wake(std::atomic<uint32_t>* word, uint32_t waiters) {
+	// ZORA: Not FUTEX_PRIVATE_FLAG, since the sleepers are in other processes
+	if (waiters > 0)
+		syscall(SYS_futex, (uint32_t*)word, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+void FrameSignal::Wait(std::atomic<uint32_t>* word, uint32_t expected, int timeoutMs) {
+	// ZORA: The kernel checks the word still holds 'expected' before sleeping, so a wake between our check and the sleep is never lost
+	struct timespec timeout;
+	timeout.tv_sec = timeoutMs / 1000;
+	timeout.tv_nsec = (long)(timeoutMs % 1000) * 1000000;
+	syscall(SYS_futex, (uint32_t*)word, FUTEX_WAIT, expected, &timeout, nullptr, 0);
+}
+
+#else
+
+void FrameSignal::Wake(std::atomic<uint32_t>* word, uint32_t waiters) {
+
+}
+
+void FrameSignal::Wait(std::atomic<uint32_t>* word, uint32_t expected, int timeoutMs) {
+	// ZORA: No futex here, so check back every millisecond instead
+	std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMs < 1 ? timeoutMs : 1));
+}
+
+#endif
+
+#endif
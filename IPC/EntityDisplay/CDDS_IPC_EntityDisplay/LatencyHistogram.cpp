@@ -0,0 +1,111 @@
+#include "LatencyHistogram.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+LatencyHistogram::LatencyHistogram() {
+	Reset();
+}
+
+void LatencyHistogram::Record(uint64_t valueUs) {
+	if (valueUs > LATENCY_HISTOGRAM_MAX_VALUE)
+		valueUs = LATENCY_HISTOGRAM_MAX_VALUE;
+
+	m_counts[GetBucket(valueUs)]++;
+	m_count++;
+	if (valueUs > m_max)
+		m_max = valueUs;
+}
+
+void LatencyHistogram::Reset() {
+	memset(m_counts, 0, sizeof(m_counts));
+	m_count = 0;
+	m_max = 0;
+}
+
+uint64_t LatencyHistogram::GetCount() const {
+	return m_count;
+}
+
+uint64_t LatencyHistogram::GetMax() const {
+	return m_max;
+}
+
+uint64_t LatencyHistogram::GetPercentile(double percentile) const {
+	if (m_count == 0)
+		return 0;
+
+	// ZORA: The rank of the value asked for, counting from 1, so the 100th percentile is the largest value and the 0th the smallest
+	uint64_t rank = (uint64_t)std::ceil(percentile / 100.0 * (double)m_count);
+	if (rank < 1)
+		rank = 1;
+
+	uint64_t seen = 0;
+	for (size_t bucket = 0; bucket < BUCKET_COUNT; bucket++) {
+		seen += m_counts[bucket];
+		if (seen >= rank) {
+			uint64_t top = GetBucketTop(bucket);
+			return top < m_max ? top : m_max;
+		}
+	}
+	return m_max;
+}
+
+bool LatencyHistogram::Dump(const char* path) const {
+	FILE* file = fopen(path, "w");
+	if (file == nullptr)
+		return false;
+
+	// ZORA: One row per bucket that has anything in it, which is all the plotter needs to draw the curve
+	fprintf(file, "%12s %14s %10s %14s\n\n", "Value", "Percentile", "TotalCount", "1/(1-Percentile)");
+
+	uint64_t seen = 0;
+	double sum = 0;
+	for (size_t bucket = 0; bucket < BUCKET_COUNT; bucket++) {
+		if (m_counts[bucket] == 0)
+			continue;
+
+		seen += m_counts[bucket];
+		uint64_t top = GetBucketTop(bucket);
+		if (top > m_max)
+			top = m_max;
+		sum += (double)top * (double)m_counts[bucket];
+
+		double fraction = (double)seen / (double)m_count;
+		if (fraction < 1.0)
+			fprintf(file, "%12.3f %2.12f %10llu %14.2f\n", top / 1000.0, fraction, (unsigned long long)seen, 1.0 / (1.0 - fraction));
+		else
+			fprintf(file, "%12.3f %2.12f %10llu\n", top / 1000.0, fraction, (unsigned long long)seen);
+	}
+
+	double mean = m_count > 0 ? sum / (double)m_count : 0;
+	fprintf(file, "#[Mean    = %12.3f, Max            = %12.3f]\n", mean / 1000.0, m_max / 1000.0);
+	fprintf(file, "#[p50     = %12.3f, p99            = %12.3f]\n", GetPercentile(50) / 1000.0, GetPercentile(99) / 1000.0);
+	fprintf(file, "#[p99.9   = %12.3f, Total count    = %12llu]\n", GetPercentile(99.9) / 1000.0, (unsigned long long)m_count);
+
+	bool written = ferror(file) == 0;
+	return fclose(file) == 0 && written;
+}
+
+// ZORA: Shift the value down until it fits in the top half of a sub-bucket range. The number of shifts says which power of two it is in, and what is left says where in it.
+size_t LatencyHistogram::GetBucket(uint64_t value) {
+	if (value < 2 * LATENCY_HISTOGRAM_SUB_BUCKETS)
+		return (size_t)value;
+
+	uint32_t shift = 0;
+	while ((value >> shift) >= 2 * LATENCY_HISTOGRAM_SUB_BUCKETS)
+		shift++;
+
+	return 2 * LATENCY_HISTOGRAM_SUB_BUCKETS + (size_t)(shift - 1) * LATENCY_HISTOGRAM_SUB_BUCKETS + (size_t)((value >> shift) - LATENCY_HISTOGRAM_SUB_BUCKETS);
+}
+
+// ZORA: The largest value that lands in 'bucket'
+uint64_t LatencyHistogram::GetBucketTop(size_t bucket) {
+	if (bucket < 2 * LATENCY_HISTOGRAM_SUB_BUCKETS)
+		return bucket;
+
+	size_t above = bucket - 2 * LATENCY_HISTOGRAM_SUB_BUCKETS;
+	uint32_t shift = (uint32_t)(above / LATENCY_HISTOGRAM_SUB_BUCKETS) + 1;
+	uint64_t sub = above % LATENCY_HISTOGRAM_SUB_BUCKETS + LATENCY_HISTOGRAM_SUB_BUCKETS;
+	return ((sub + 1) << shift) - 1;
+}
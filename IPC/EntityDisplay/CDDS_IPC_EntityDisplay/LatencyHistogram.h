@@ -0,0 +1,38 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// ZORA: Every power of two is split into this many buckets, so a recorded value is never more than 1 part in LATENCY_HISTOGRAM_SUB_BUCKETS out, whether it is 3 microseconds or 3 seconds
+const uint32_t LATENCY_HISTOGRAM_SUB_BUCKETS = 64;
+
+// ZORA: The largest value the histogram tells apart, about 19 hours in microseconds. Anything larger is counted as this.
+const uint64_t LATENCY_HISTOGRAM_MAX_VALUE = 1ull << 36;
+
+// ZORA: A histogram of latencies in microseconds, laid out the way HdrHistogram lays them out: values below 2 * LATENCY_HISTOGRAM_SUB_BUCKETS get a bucket each, and every power of two above that is split into LATENCY_HISTOGRAM_SUB_BUCKETS equal buckets.
+// Recording is an index calculation and an increment, with no allocation, so it can be done every frame for as long as the Display runs. Percentiles are read by walking the buckets, which is a couple of thousand additions.
+class LatencyHistogram {
+public:
+	LatencyHistogram();
+
+	void Record(uint64_t valueUs);
+	void Reset();
+
+	uint64_t GetCount() const;
+	uint64_t GetMax() const;
+
+	// ZORA: The value 'percentile' percent of the recorded values are at or below, to the precision of its bucket. Reports the top of the bucket, so it never understates a latency. 0 if nothing has been recorded.
+	uint64_t GetPercentile(double percentile) const;
+
+	// ZORA: Write the percentile distribution to 'path' as text, in the same columns as HdrHistogram's outputPercentileDistribution, so it can be loaded into HdrHistogram's plotter. Values are in milliseconds. Returns false if the file could not be written.
+	bool Dump(const char* path) const;
+
+private:
+	static const size_t BUCKET_COUNT = 2 * LATENCY_HISTOGRAM_SUB_BUCKETS + 30 * LATENCY_HISTOGRAM_SUB_BUCKETS;
+
+	static size_t GetBucket(uint64_t value);
+	static uint64_t GetBucketTop(size_t bucket);
+
+	uint64_t m_counts[BUCKET_COUNT];
+	uint64_t m_count;
+	uint64_t m_max;
+};
@@ -0,0 +1,219 @@
+#include "SharedMemPool.h"
+#include <cstring>
+
+// ZORA: Every block is a multiple of 8 bytes and starts on an 8 byte boundary, as rmem.h aligns to sizeof(intptr_t), so a 64-bit process and a 32-bit one lay out the same pool
+static uint64_t AlignSize(uint64_t size) {
+	return (size + 7) & ~(uint64_t)7;
+}
+
+SharedMemPool::SharedMemPool() :
+	m_header(nullptr),
+	m_size(0)
+{}
+
+bool SharedMemPool::Create(void* buffer, size_t bytes) {
+	m_header = nullptr;
+	bytes &= ~(size_t)7;
+	if (buffer == nullptr || bytes < sizeof(SharedMemPoolHeader) + sizeof(SharedMemNode) + 8)
+		return false;
+
+	m_header = (SharedMemPoolHeader*)buffer;
+	m_size = bytes;
+	m_header->magic = SHARED_MEMPOOL_MAGIC;
+	m_header->version = SHARED_POOL_VERSION;
+	m_header->size = bytes;
+	Reset();
+	return true;
+}
+
+bool SharedMemPool::Open(void* buffer, size_t bytes) {
+	m_header = nullptr;
+	if (buffer == nullptr || bytes < sizeof(SharedMemPoolHeader))
+		return false;
+
+	SharedMemPoolHeader* header = (SharedMemPoolHeader*)buffer;
+	if (header->magic != SHARED_MEMPOOL_MAGIC || header->version != SHARED_POOL_VERSION || header->size > bytes || header->size < sizeof(SharedMemPoolHeader))
+		return false;
+
+	m_header = header;
+	m_size = header->size;
+	return true;
+}
+
+bool SharedMemPool::IsOpen() const {
+	return m_header != nullptr;
+}
+
+uint64_t SharedMemPool::Alloc(size_t bytes) {
+	if (m_header == nullptr || bytes == 0 || bytes > m_size)
+		return 0;
+
+	const uint64_t ALLOC_SIZE = AlignSize(bytes + sizeof(SharedMemNode));
+	const uint64_t BUCKET_SLOT = (ALLOC_SIZE >> SHARED_MEMPOOL_BUCKET_BITS) - 1;
+
+	uint64_t block = 0;
+
+	// ZORA: A small block comes out of the bucket for its size, where every block is exactly that size
+	if (BUCKET_SLOT < SHARED_MEMPOOL_BUCKET_SIZE) {
+		block = m_header->buckets[BUCKET_SLOT];
+		if (block != 0)
+			m_header->buckets[BUCKET_SLOT] = GetNode(block)->next;
+	}
+	else {
+		// ZORA: A large one comes from the first block on the free list it fits in. If that has room to spare, the allocation is cut off its top end and the rest stays on the list.
+		for (uint64_t offset = m_header->freeHead; offset != 0; offset = GetNode(offset)->next) {
+			SharedMemNode* node = GetNode(offset);
+			if (node->size < ALLOC_SIZE)
+				continue;
+
+			if (node->size - ALLOC_SIZE > SHARED_MEMPOOL_SPLIT_THRESHOLD) {
+				node->size -= ALLOC_SIZE;
+				block = offset + node->size;
+				GetNode(block)->size = ALLOC_SIZE;
+			}
+			else {
+				if (node->prev != 0)
+					GetNode(node->prev)->next = node->next;
+				else
+					m_header->freeHead = node->next;
+				if (node->next != 0)
+					GetNode(node->next)->prev = node->prev;
+				else
+					m_header->freeTail = node->prev;
+				m_header->freeCount--;
+				block = offset;
+			}
+			break;
+		}
+	}
+
+	// ZORA: Nothing free fits, so carve a new block off the stack
+	if (block == 0) {
+		if (ALLOC_SIZE > m_header->base - sizeof(SharedMemPoolHeader))
+			return 0;
+
+		m_header->base -= ALLOC_SIZE;
+		block = m_header->base;
+		GetNode(block)->size = ALLOC_SIZE;
+	}
+
+	SharedMemNode* node = GetNode(block);
+	node->next = 0;
+	node->prev = 0;
+	memset((uint8_t*)node + sizeof(SharedMemNode), 0, (size_t)(node->size - sizeof(SharedMemNode)));
+	return block + sizeof(SharedMemNode);
+}
+
+void SharedMemPool::Free(uint64_t offset) {
+	if (m_header == nullptr || offset < m_header->base + sizeof(SharedMemNode) || offset > m_size || (offset & 7) != 0)
+		return;
+
+	// ZORA: Behind the allocation is the node that says how big it is
+	uint64_t block = offset - sizeof(SharedMemNode);
+	SharedMemNode* node = GetNode(block);
+	if (node->size < sizeof(SharedMemNode) + 8 || node->size > m_size - block || (node->size & 7) != 0)
+		return;
+
+	// ZORA: The block at the bottom of the stack goes straight back onto it, as do any free blocks that are then at the bottom
+	if (block == m_header->base) {
+		m_header->base += node->size;
+		while (m_header->freeHead != 0 && m_header->freeHead == m_header->base) {
+			SharedMemNode* head = GetNode(m_header->freeHead);
+			m_header->base += head->size;
+			m_header->freeHead = head->next;
+			if (m_header->freeHead != 0)
+				GetNode(m_header->freeHead)->prev = 0;
+			else
+				m_header->freeTail = 0;
+			m_header->freeCount--;
+		}
+		return;
+	}
+
+	const uint64_t BUCKET_SLOT = (node->size >> SHARED_MEMPOOL_BUCKET_BITS) - 1;
+	if (BUCKET_SLOT < SHARED_MEMPOOL_BUCKET_SIZE) {
+		node->prev = 0;
+		node->next = m_header->buckets[BUCKET_SLOT];
+		m_header->buckets[BUCKET_SLOT] = block;
+		return;
+	}
+
+	InsertFree(block);
+}
+
+// ZORA: The free list is kept in address order, so a freed block can be merged with the free blocks either side of it, as rmem.h's __InsertMemNode does, and the list doesn't fragment into pieces that were once one block
+void SharedMemPool::InsertFree(uint64_t block) {
+	SharedMemNode* node = GetNode(block);
+
+	uint64_t next = m_header->freeHead;
+	while (next != 0 && next < block)
+		next = GetNode(next)->next;
+
+	// ZORA: Freed twice. Leave the list as it is.
+	if (next == block)
+		return;
+
+	uint64_t prev = next != 0 ? GetNode(next)->prev : m_header->freeTail;
+
+	if (prev != 0 && prev + GetNode(prev)->size == block) {
+		// ZORA: Merge into the block before
+		SharedMemNode* before = GetNode(prev);
+		before->size += node->size;
+		if (next != 0 && prev + before->size == next) {
+			SharedMemNode* after = GetNode(next);
+			before->size += after->size;
+			before->next = after->next;
+			if (after->next != 0)
+				GetNode(after->next)->prev = prev;
+			else
+				m_header->freeTail = prev;
+			m_header->freeCount--;
+		}
+		return;
+	}
+
+	if (next != 0 && block + node->size == next) {
+		// ZORA: Merge the block after into this one, which takes its place in the list
+		SharedMemNode* after = GetNode(next);
+		node->size += after->size;
+		node->prev = after->prev;
+		node->next = after->next;
+	}
+	else {
+		node->prev = prev;
+		node->next = next;
+		m_header->freeCount++;
+	}
+
+	if (node->prev != 0)
+		GetNode(node->prev)->next = block;
+	else
+		m_header->freeHead = block;
+	if (node->next != 0)
+		GetNode(node->next)->prev = block;
+	else
+		m_header->freeTail = block;
+}
+
+void SharedMemPool::Reset() {
+	if (m_header == nullptr)
+		return;
+
+	m_header->base = m_size;
+	m_header->freeHead = 0;
+	m_header->freeTail = 0;
+	m_header->freeCount = 0;
+	for (uint32_t i = 0; i < SHARED_MEMPOOL_BUCKET_SIZE; i++)
+		m_header->buckets[i] = 0;
+}
+
+void* SharedMemPool::Resolve(uint64_t offset, size_t bytes) const {
+	if (m_header == nullptr || offset < sizeof(SharedMemPoolHeader) || offset > m_size || bytes > m_size - offset)
+		return nullptr;
+
+	return (uint8_t*)m_header + offset;
+}
+
+SharedMemNode* SharedMemPool::GetNode(uint64_t offset) const {
+	return (SharedMemNode*)((uint8_t*)m_header + offset);
+}
@@ -0,0 +1,228 @@
+#include "SharedMemory.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#include "WinInc.h"
+#else
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+SharedMemory::SharedMemory() : m_handle(nullptr), m_view(nullptr), m_size(0), m_errorCode(0) {
+
+}
+
+SharedMemory::~SharedMemory() {
+	Close();
+}
+
+bool SharedMemory::Create(const char* name, size_t size) {
+	Close();
+
+	// ZORA: The size of the memory block is split across two DWORDs, the high and low halves of a 64 bit size
+	m_handle = CreateFileMappingA(
+		INVALID_HANDLE_VALUE,				// a handle to an existing virtual file, or invalid
+		nullptr,							// optional security attributes
+		PAGE_READWRITE,						// read/write access control
+		(DWORD)((unsigned long long)size >> 32), (DWORD)(size & 0xFFFFFFFF),
+		name);								// ZORA: The string name that the 2nd application will use to access the virtual file
+
+	if (m_handle == nullptr) {
+		m_errorCode = (int)GetLastError();
+		return false;
+	}
+
+	return MapView(size);
+}
+
+bool SharedMemory::Open(const char* name) {
+	Close();
+
+	m_handle = OpenFileMappingA(
+		FILE_MAP_ALL_ACCESS,	// ZORA: The access level we want this application to have
+		FALSE,					// ZORA: Processes created by this one do not inherit the handle
+		name);					// ZORA: This must match the name from the creating application exactly
+
+	if (m_handle == nullptr) {
+		m_errorCode = (int)GetLastError();
+		return false;
+	}
+
+	// ZORA: A size of 0 maps the whole of the named shared memory, whatever size the creator gave it
+	return MapView(0);
+}
+
+bool SharedMemory::MapView(size_t size) {
+	m_view = MapViewOfFile(
+		m_handle,				// ZORA: Target HANDLE
+		FILE_MAP_ALL_ACCESS,	// ZORA: Type of access, per CreateFileMapping
+		0, 0,					// ZORA: Offset within the named shared memory
+		size);					// ZORA: The size of the named shared memory to map
+
+	if (m_view == nullptr) {
+		m_errorCode = (int)GetLastError();
+		Close();
+		return false;
+	}
+
+	// ZORA: The opener doesn't know the size in advance, so ask Windows how much was mapped
+	MEMORY_BASIC_INFORMATION info;
+	if (size == 0 && VirtualQuery(m_view, &info, sizeof(info)) != 0)
+		size = info.RegionSize;
+	m_size = size;
+
+	return true;
+}
+
+void SharedMemory::Close() {
+	if (m_view != nullptr) {
+		UnmapViewOfFile(m_view);
+		m_view = nullptr;
+		m_size = 0;
+	}
+
+	// ZORA: Windows releases the named shared memory itself once the last handle to it is closed
+	if (m_handle != nullptr) {
+		CloseHandle(m_handle);
+		m_handle = nullptr;
+	}
+}
+
+bool SharedMemory::IsOpen() const {
+	return m_handle != nullptr;
+}
+
+#else
+
+SharedMemory::SharedMemory() : m_fd(-1), m_owner(false), m_view(nullptr), m_size(0), m_errorCode(0) {
+	m_name[0] = '\0';
+}
+
+SharedMemory::~SharedMemory() {
+	Close();
+}
+
+// ZORA: POSIX shared memory names must begin with a single slash and contain no others
+static void MakePosixName(char* out, size_t outSize, const char* name) {
+	snprintf(out, outSize, "/%s", name);
+}
+
+bool SharedMemory::Create(const char* name, size_t size) {
+	Close();
+	MakePosixName(m_name, sizeof(m_name), name);
+
+	// ZORA: Unlike Windows, a POSIX block outlives every process that used it until it is unlinked, so clear out anything a crashed Editor left behind before creating a fresh one
+	shm_unlink(m_name);
+
+	m_fd = shm_open(m_name, O_CREAT | O_EXCL | O_RDWR, 0600);
+	if (m_fd < 0) {
+		m_errorCode = errno;
+		return false;
+	}
+	m_owner = true;
+
+	// ZORA: A new block is empty, so grow it to the requested size. The new pages read as zero, the same as CreateFileMapping.
+	if (ftruncate(m_fd, (off_t)size) != 0) {
+		m_errorCode = errno;
+		Close();
+		return false;
+	}
+
+	return MapView(size);
+}
+
+bool SharedMemory::Open(const char* name) {
+	Close();
+	MakePosixName(m_name, sizeof(m_name), name);
+
+	m_fd = shm_open(m_name, O_RDWR, 0600);
+	if (m_fd < 0) {
+		m_errorCode = errno;
+		return false;
+	}
+	m_owner = false;
+
+	// ZORA: The opener doesn't know the size in advance, so ask for the size the creator gave it
+	struct stat info;
+	if (fstat(m_fd, &info) != 0) {
+		m_errorCode = errno;
+		Close();
+		return false;
+	}
+
+	return MapView((size_t)info.st_size);
+}
+
+bool SharedMemory::MapView(size_t size) {
+	void* view = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+	if (view == MAP_FAILED) {
+		m_errorCode = errno;
+		Close();
+		return false;
+	}
+
+	m_view = view;
+	m_size = size;
+	return true;
+}
+
+void SharedMemory::Close() {
+	if (m_view != nullptr) {
+		munmap(m_view, m_size);
+		m_view = nullptr;
+		m_size = 0;
+	}
+
+	if (m_fd >= 0) {
+		close(m_fd);
+		m_fd = -1;
+	}
+
+	// ZORA: Only the creator removes the name, so that applications which still have it mapped keep working until they close it too
+	if (m_owner) {
+		shm_unlink(m_name);
+		m_owner = false;
+	}
+}
+
+bool SharedMemory::IsOpen() const {
+	return m_fd >= 0;
+}
+
+#endif
+
+void SharedMemory::Swap(SharedMemory& other) {
+#ifdef _WIN32
+	std::swap(m_handle, other.m_handle);
+#else
+	std::swap(m_fd, other.m_fd);
+	std::swap(m_owner, other.m_owner);
+	char name[sizeof(m_name)];
+	memcpy(name, m_name, sizeof(m_name));
+	memcpy(m_name, other.m_name, sizeof(m_name));
+	memcpy(other.m_name, name, sizeof(m_name));
+#endif
+	std::swap(m_view, other.m_view);
+	std::swap(m_size, other.m_size);
+	std::swap(m_errorCode, other.m_errorCode);
+}
+
+void* SharedMemory::GetView() const {
+	return m_view;
+}
+
+size_t SharedMemory::GetSize() const {
+	return m_size;
+}
+
+int SharedMemory::GetErrorCode() const {
+	return m_errorCode;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <cstddef>
+
+// ZORA: A thin wrapper around a block of named shared memory. The creating application calls Create() and the opening application calls Open(), after which both hold a view of the whole block until Close().
+// The view is mapped once and kept for the life of the object, so the main loops never pay for a map/unmap per frame.
+// On Windows this is backed by CreateFileMapping/OpenFileMapping/MapViewOfFile, everywhere else by shm_open/ftruncate/mmap, so the Editor and the Display run unchanged on both.
+class SharedMemory {
+public:
+	SharedMemory();
+	~SharedMemory();
+
+	// ZORA: Create a new block of named shared memory of the given size in bytes and map a view of it. Returns false if the block could not be created or mapped.
+	bool Create(const char* name, size_t size);
+
+	// ZORA: Open and map a block of named shared memory that another application has already created. Returns false if no block of that name exists or it could not be mapped.
+	bool Open(const char* name);
+
+	// ZORA: Unmap the view and close the handle to the named shared memory. Unmapping doesn't delete the named shared memory; the memory itself is released once every application has closed it.
+	void Close();
+
+	bool IsOpen() const;
+
+	// ZORA: Trade blocks with 'other', handles, views and all. Lets the owner of a block hand it to another object without closing and reopening it.
+	void Swap(SharedMemory& other);
+
+	// ZORA: The long-lived view of the shared memory, or a nullptr if nothing is open. The pointer stays valid until Close().
+	void* GetView() const;
+
+	// ZORA: The size of the view in bytes. For an opened block this is the whole block, rounded up to a page on Windows.
+	size_t GetSize() const;
+
+	// ZORA: The platform error code (GetLastError or errno) from the most recent failed call, for debug printouts
+	int GetErrorCode() const;
+
+private:
+	// ZORA: Copying would leave two objects closing the same handle
+	SharedMemory(const SharedMemory&) = delete;
+	SharedMemory& operator=(const SharedMemory&) = delete;
+
+	bool MapView(size_t size);
+
+#ifdef _WIN32
+	void* m_handle;
+#else
+	int m_fd;
+	bool m_owner;
+	char m_name[256];
+#endif
+	void* m_view;
+	size_t m_size;
+	int m_errorCode;
+};
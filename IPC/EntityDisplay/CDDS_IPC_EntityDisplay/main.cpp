@@ -21,7 +21,19 @@
 
 #include "raylib.h"
 #include "EntityDisplayApp.h"
+#include "EntityArena.h"
+#include "EntityCommandRing.h"
+#include "EntityRecording.h"
+#include "EntitySegment.h"
+#include "EntitySocket.h"
+#include "EntityUdp.h"
+#include "LatencyHistogram.h"
+#include "Platform.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <vector>
 
 /*
 TUTORIAL:
@@ -46,6 +58,34 @@ ZORA:
 3: 
 */
 
+// ZORA: How long the Display waits for a new frame before redrawing the old one anyway
+static const int IDLE_REDRAW_MS = 250;
+
+// ZORA: What to tell the user about the Editors, or a nullptr while they are all running normally. While any Editor is still publishing the Display carries on with it, so the others are only counted, written into 'buffer'.
+static const char* GetProducerStatus(const EntitySegment& segment, char* buffer, size_t bufferSize) {
+    EntityProducerState state = segment.GetProducerState();
+    if (state == ENTITY_PRODUCER_LIVE) {
+        uint32_t stalled = segment.GetProducerCount(ENTITY_PRODUCER_STALLED);
+        uint32_t dead = segment.GetProducerCount(ENTITY_PRODUCER_DEAD);
+        if (stalled == 0 && dead == 0)
+            return nullptr;
+
+        snprintf(buffer, bufferSize, "Editors not responding: %u. Editors closed unexpectedly, their entities hidden: %u", stalled, dead);
+        return buffer;
+    }
+
+    switch (state) {
+    case ENTITY_PRODUCER_STALLED:
+        return "The Editor has stopped responding";
+    case ENTITY_PRODUCER_DEAD:
+        return "The Editor has closed unexpectedly. Waiting for it to be restarted...";
+    case ENTITY_PRODUCER_ABSENT:
+        return "Waiting for the Editor to start...";
+    default:
+        return nullptr;
+    }
+}
+
 int main(int argc, char* argv[])
 {
     float deltaTime = 0;
@@ -59,56 +99,131 @@ int main(int argc, char* argv[])
     // NAMED SHARED MEMORY SETUP START vvvvv
     // +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
     /*
-    ZORA: OpenFileMapping is the corresponding function to CreateFileMapping (from the creating application, and a part of the windows.h library). This function also returns a HANDLE, or a nullptr in the event of an error.
+    ZORA: EntitySegment::Open is the corresponding function to EntitySegment::Create (from the creating application). It opens the named shared memory through SharedMemory, which wraps OpenFileMapping on Windows and shm_open on Linux, and returns false in the event of an error.
 
-    The OpenFileMapping function DOES NOT know in advance the size of the shared memory which it is going to be accessing.
+    The Open function DOES NOT know in advance the size of the shared memory which it is going to be accessing. Instead it checks the header at the front of the segment (magic number, layout version, sizeof(Entity) and capacity) before trusting any of the entities in it.
     */
-    HANDLE fileHandle_01 = OpenFileMapping(
-        FILE_MAP_ALL_ACCESS,            // ZORA: The access level we want this application to have, which could be full access, read only, write only, etc.
-        FALSE,                          // ZORA: Determines whether or not processes created within this one will also be permitted to access the named shared memory. I'm not sure if this analogy is precise, but this seems to equate approximately to a protected/private access level.
-        L"IntSharedMemory");         // ZORA: The name of the shared memory we wish to access. This must match the name from the creating application exactly.
+    EntitySegment segment;
+
+    // ZORA: A Display that can't share memory with the Editor is given the Editor's --socket path instead, and streams the same entities over it. A Display on another machine is given the Editor's --udp host:port.
+    // ZORA: --udp-loss and --udp-reorder make the Display drop and reorder that percentage of its acknowledgements, for trying out a bad network over loopback
+    // ZORA: Pressing L writes the publish to render latency histogram to EntityLatency.hgrm. --latency-dump path writes it there instead, and also when the Display closes.
+    // ZORA: --replay path plays back a recording made with the Editor's --record instead of watching a live Editor. --replay-speed max plays it as fast as the Display can draw, and --replay-loop 1 starts it again at the end.
+    const char* socketPath = nullptr;
+    const char* udpAddress = nullptr;
+    int udpLoss = 0;
+    int udpReorder = 0;
+    const char* replayPath = nullptr;
+    bool replayRealTime = true;
+    bool replayLoop = false;
+    const char* latencyPath = "EntityLatency.hgrm";
+    bool latencyOnExit = false;
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--socket") == 0)
+            socketPath = argv[i + 1];
+        else if (strcmp(argv[i], "--udp") == 0)
+            udpAddress = argv[i + 1];
+        else if (strcmp(argv[i], "--udp-loss") == 0)
+            udpLoss = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--udp-reorder") == 0)
+            udpReorder = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--replay") == 0)
+            replayPath = argv[i + 1];
+        else if (strcmp(argv[i], "--replay-speed") == 0)
+            replayRealTime = strcmp(argv[i + 1], "max") != 0;
+        else if (strcmp(argv[i], "--replay-loop") == 0)
+            replayLoop = atoi(argv[i + 1]) != 0;
+        else if (strcmp(argv[i], "--latency-dump") == 0) {
+            latencyPath = argv[i + 1];
+            latencyOnExit = true;
+        }
+    }
+
+    EntitySocket socket;
+    EntityUdp udp;
+    EntityReplay replay;
+    EntitySubscriber* subscriber = &segment;
 
-    // ZORA: Where the creation of the file map fails, perform a debug printout
-    if (fileHandle_01 == nullptr) {
+    if (replayPath != nullptr) {
+        if (!replay.Open(replayPath)) {
 #ifndef NDEBUG
-        std::cout << "Could not create file mapping object (application 2): " << GetLastError() << std::endl;
+            std::cout << "Could not open recording " << replayPath << " (application 2): " << replay.GetErrorCode() << std::endl;
 #endif
-        return 1;
+            return 1;
+        }
+        replay.SetRealTime(replayRealTime);
+        replay.SetLoop(replayLoop);
+        subscriber = &replay;
+
+        // ZORA: Lift the frame cap too, so full speed really is as fast as the Display can draw
+        if (!replayRealTime)
+            SetTargetFPS(0);
     }
 
-    /* ZORA: The memory allocated by CreateFileMapping is hidden from all applications within a virtual file system. Each application requires a temporary pointer to that virtual file in order to access it.The MapViewOfFile function creates a void pointer so that we can refer to any object type, but we want the same type as the object at the shared memory location.
-    */
-    // ZORA: 1) Determine the number of items in the array according to data shared by the first file.
-    DWORD arraySize = 0;
+    else if (socketPath != nullptr) {
+        if (!socket.Connect(socketPath)) {
+#ifndef NDEBUG
+            std::cout << "Could not connect to entity socket " << socketPath << " (application 2): " << socket.GetErrorCode() << std::endl;
+#endif
+            return 1;
+        }
+        subscriber = &socket;
+    }
 
-    unsigned int* size = (unsigned int*)MapViewOfFile(
-        fileHandle_01,          // ZORA: Target HANDLE
-        FILE_MAP_ALL_ACCESS,    // ZORA: Type of access, per CreateFileMapping
-        0,                      // ZORA: Offset within the memory allocation of the named shared memory for dynamic or selective access to a specific area in the target memory.
-        0,                      // ZORA: Offset within the memory allocation of the named shared memory for dynamic or selective access to a specific area in the target memory.
-        sizeof(unsigned int));  // ZORA: The size of the named shared memory to map
+    else if (udpAddress != nullptr) {
+        // ZORA: Split host:port at the last colon
+        char udpHost[256];
+        const char* colon = strrchr(udpAddress, ':');
+        size_t hostLength = colon != nullptr ? (size_t)(colon - udpAddress) : 0;
+        if (colon == nullptr || hostLength >= sizeof(udpHost)) {
+#ifndef NDEBUG
+            std::cout << "Entity UDP address must be host:port, not " << udpAddress << " (application 2)" << std::endl;
+#endif
+            return 1;
+        }
+        memcpy(udpHost, udpAddress, hostLength);
+        udpHost[hostLength] = '\0';
 
-    // Assign the memory 
-    arraySize = *size;
+        if (!udp.Connect(udpHost, (uint16_t)atoi(colon + 1))) {
+#ifndef NDEBUG
+            std::cout << "Could not resolve entity UDP host " << udpAddress << " (application 2): " << udp.GetErrorCode() << std::endl;
+#endif
+            return 1;
+        }
+        udp.SetSimulatedLoss(udpLoss, udpReorder);
+        subscriber = &udp;
+    }
 
-    // ZORA: Where the creation of the pointer to view the file map fails, perform a debug printout
-    if (size == nullptr) {
+    // ZORA: Where the opening of the file map fails, perform a debug printout. The Editor may simply not have started yet, so the Display carries on and the segment is picked up as soon as an Editor creates it.
+    else if (!segment.Open(
+        "EntitySharedMemory")) {        // ZORA: The name of the shared memory we wish to access. This must match the name from the creating application exactly.
 #ifndef NDEBUG
-        std::cout << "Could not map view of file (for the size): " << GetLastError() << std::endl;
+        std::cout << "Could not create file mapping object (application 2), waiting for the Editor: " << segment.GetErrorCode() << std::endl;
 #endif
-        // ZORA: This is for identical, but even more important, reasons as file I/O closures
-        CloseHandle(fileHandle_01);
-        return 1;
     }
 
-    UnmapViewOfFile(size);
-    
+    // ZORA: The Display's copy of the entities. ReadSnapshot patches it in place and it is reserved to the segment's capacity, so it only reallocates when the Editor resizes the segment and the app can draw straight out of it.
+    std::vector<Entity> snapshot;
+
+    // ZORA: The return channels to the Editors, one per partition, opened the first time an entity in that partition is edited. They live in shared memory too, so a Display on the socket, UDP or a replay can look but not edit.
+    EntityCommandRing commandRings[ENTITY_MAX_PARTITIONS];
+    char commandRingName[300];
+    uint32_t reattachCount = segment.GetReattachCount();
+    char producerStatus[128];
+
+    // ZORA: The Editors' arenas, one per partition, where the selected entity's name is read from in place. Each is opened when an entity in its partition is selected, and only tried again when the selection changes, so an Editor without one doesn't cost a failed open every frame.
+    EntityArena arenas[ENTITY_MAX_PARTITIONS];
+    char arenaName[300];
+    int arenaSelection = -1;
 
+    // ZORA: The selected entity, held by handle so it stays selected while its Editor adds and removes entities around it. 'selectionIndex' is where it was in the snapshot last drawn, so a new click can be told apart from the same selection.
+    EntitySegmentHandle selectionHandle = {};
+    bool selectionHeld = false;
+    int selectionIndex = -1;
 
-    HANDLE fileHandle_02 = OpenFileMapping(
-        FILE_MAP_ALL_ACCESS,            // ZORA: The access level we want this application to have, which could be full access, read only, write only, etc.
-        FALSE,                          // ZORA: Determines whether or not processes created within this one will also be permitted to access the named shared memory. I'm not sure if this analogy is precise, but this seems to equate approximately to a protected/private access level.
-        L"ArraySharedMemory");         // ZORA: The name of the shared memory we wish to access. This must match the name from the creating application exactly.
+    // ZORA: How old each frame was when it reached the screen, from the Editor publishing it to the Display finishing drawing it. Only the shared memory segment and the socket share a clock with the Editor, so the other transports leave it empty.
+    LatencyHistogram latency;
+    app.SetLatency(&latency);
     
 
     // +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ 
@@ -121,67 +236,139 @@ int main(int argc, char* argv[])
     {
         deltaTime = GetFrameTime();
 
+        // ZORA: A replay gets a timeline to scrub through it with
+        if (subscriber == &replay)
+            app.SetTimeline(replay.GetFrame(), replay.GetFrameCount());
+
+        // ZORA: Warn while the Editor is stalled, gone or not started yet, or while some of the Editors are. The segment moves over to a new Editor by itself, and that Editor's command rings are new too, so the old ones are closed and reopened on the next edit.
+        if (subscriber == &segment) {
+            app.SetStatus(GetProducerStatus(segment, producerStatus, sizeof(producerStatus)));
+            if (segment.GetReattachCount() != reattachCount) {
+                reattachCount = segment.GetReattachCount();
+                for (auto& ring : commandRings)
+                    ring.Close();
+                for (auto& arena : arenas)
+                    arena.Close();
+                arenaSelection = -1;
+                selectionHeld = false;
+            }
+        }
+
         // Update
         //----------------------------------------------------------------------------------
-        //app.Update(deltaTime);
+        app.Update(deltaTime);
         //----------------------------------------------------------------------------------
 
+        // ZORA: The seek is decoded by the ReadSnapshot below, so the frame sought to is drawn this frame
+        if (app.m_seekFrame >= 0) {
+            replay.Seek((uint64_t)app.m_seekFrame, app.m_seekExact);
+            app.m_seekFrame = -1;
+        }
 
-        Entity* data = (Entity*)MapViewOfFile(
-            fileHandle_02,                  // ZORA: Our target HANDLE
-            FILE_MAP_ALL_ACCESS,            // ZORA: The type of access, per CreateFileMapping and OpenFileMapping.
-            0,                              // ZORA: Offset within the memory allocation of the named shared memory 
-            0,                              // ZORA: Offset within the memory allocation of the named shared memory 
-            sizeof(Entity) * arraySize);    // ZORA: The size of the named shared memory 
+        // ZORA: Send this frame's edits to whichever Editor owns each entity, by handle. This happens before the next snapshot is read, so the indices still match the entities that were clicked.
+        for (const auto& command : app.m_commands) {
+            if (subscriber != &segment)
+                break;
+
+            EntitySegmentHandle handle;
+            if (!segment.FindSnapshotHandle(command.index, handle))
+                continue;
+
+            EntityCommandRing& ring = commandRings[handle.partition];
+            if (!ring.IsOpen()) {
+                MakeCommandRingName(commandRingName, sizeof(commandRingName), "EntitySharedMemory", handle.partition);
+                if (!ring.Open(commandRingName))
+                    continue;
+            }
+
+            // ZORA: A full ring means the Editor is behind; the edit is dropped rather than holding up the Display
+            EntityCommand routed = command;
+            routed.index = handle.handle.index;
+            routed.generation = handle.handle.generation;
+            ring.TryPush(routed);
+        }
+        app.m_commands.clear();
 
-        // ZORA: Where the creation of the pointer to view the file map fails, perform a debug printout
-        if (data == nullptr) {
-#ifndef NDEBUG
-            std::cout << "Could not map view of file (for the array): " << GetLastError() << std::endl;
-#endif
-            // ZORA: This is for identical, but even more important, reasons as file I/O closures
-            CloseHandle(fileHandle_02);
-            return 1;
+        // ZORA: A new click is turned into a handle while the snapshot it was made in is still the one held
+        if (subscriber == &segment && app.m_selection != selectionIndex)
+            selectionHeld = app.m_selection >= 0 && segment.FindSnapshotHandle((size_t)app.m_selection, selectionHandle);
+
+
+        // ZORA: Sleep until the Editor publishes a new frame rather than copying the same one again. While the Editor is paused this only wakes a few times a second to keep the window responsive.
+        bool transferred = false;
+        if (subscriber->WaitForFrame(subscriber->GetSnapshotGeneration(), IDLE_REDRAW_MS)) {
+            // ZORA: Copy a consistent snapshot of the shared array into this application. The number of items is read from the header every frame, so changes to the count are picked up straight away.
+            // If the Editor kept the array busy for every retry, the previous frame's entities are simply drawn again.
+            if (snapshot.capacity() < subscriber->GetCapacity())
+                snapshot.reserve(subscriber->GetCapacity());
+            transferred = subscriber->ReadSnapshot(snapshot);
         }
 
-        // Populate the array in this application with each of the elements inside the array of the shared memory.
-        for (int i = 0; i < arraySize; i++) {
-            app.m_entities.push_back(data[i]);
+        // ZORA: The app only holds a view of the snapshot, so handing it over copies nothing
+        app.SetEntities(snapshot.data(), snapshot.size());
+        const Entity* data = app.GetEntities();
+
+        // ZORA: Find the selected entity in the new snapshot, wherever its Editor has moved it. Once it has been despawned nothing is selected.
+        if (subscriber == &segment) {
+            size_t snapshotIndex = 0;
+            if (selectionHeld && segment.FindHandleSnapshotIndex(selectionHandle, snapshotIndex)) {
+                app.m_selection = (int)snapshotIndex;
+            }
+            else if (selectionHeld || app.m_selection >= (int)snapshot.size()) {
+                app.m_selection = -1;
+                selectionHeld = false;
+            }
+            selectionIndex = app.m_selection;
         }
 
+        // ZORA: The name is drawn straight out of the arena. The Editor keeps a replaced name for ENTITY_ARENA_RETIRE_FRAMES of its frames, far longer than the Draw below takes.
+        const char* selectionName = nullptr;
+        uint32_t selectionNameBytes = 0;
+        if (subscriber == &segment && selectionHeld) {
+            EntityArena& arena = arenas[selectionHandle.partition];
+            if (!arena.IsOpen() && app.m_selection != arenaSelection) {
+                MakeArenaName(arenaName, sizeof(arenaName), "EntitySharedMemory", selectionHandle.partition);
+                arena.Open(arenaName);
+            }
+            selectionName = (const char*)arena.GetPayload(selectionHandle.handle.index, selectionNameBytes);
+        }
+        arenaSelection = app.m_selection;
+        app.SetSelectionName(selectionName, selectionNameBytes);
 
-#ifndef NDEBUG
-        std::cout << "Array transferred successfully." << std::endl;
-        std::cout << "data 0 x: " << data[0].x << std::endl;
-        std::cout << "data 0 y: " << data[0].y << std::endl;
-        std::cout << "data 0 r: " << data[0].r << std::endl;
-        std::cout << "data 0 g: " << data[0].g << std::endl;
-        std::cout << "data 0 b: " << data[0].b << std::endl;
-        std::cout << "data 0 rotation: " << data[0].rotation << std::endl;
-        std::cout << "data 0 speed: " << data[0].speed << std::endl;
-        std::cout << "data 0 size: " << data[0].size << std::endl;
-
-
-
-        /*std::cout << app.m_entities[0].x << std::endl;
-        std::cout << app.m_entities[0].y << std::endl;
-        std::cout << app.m_entities[0].r << std::endl;
-        std::cout << app.m_entities[0].g << std::endl;
-        std::cout << app.m_entities[0].b << std::endl;
-        std::cout << app.m_entities[0].rotation << std::endl;
-        std::cout << app.m_entities[0].speed << std::endl;
-        std::cout << app.m_entities[0].size << std::endl;*/
-
-        /*std::cout << "data 1 rotation: " << data[1].rotation << std::endl;
-        std::cout << "data 2 rotation: " << data[2].rotation << std::endl;
-        std::cout << "data 3 rotation: " << data[3].rotation << std::endl;
-        std::cout << "data 4 rotation: " << data[4].rotation << std::endl;
-        std::cout << "data 5 rotation: " << data[5].rotation << std::endl;
-        std::cout << "data 6 rotation: " << data[6].rotation << std::endl;
-        std::cout << "data 7 rotation: " << data[7].rotation << std::endl;
-        std::cout << "data 8 rotation: " << data[8].rotation << std::endl;
-        std::cout << "data 9 rotation: " << data[9].rotation << std::endl;*/
 
+#ifndef NDEBUG
+        if (transferred && app.GetEntityCount() > 0) {
+            std::cout << "Array transferred successfully." << std::endl;
+            std::cout << "data 0 x: " << data[0].x << std::endl;
+            std::cout << "data 0 y: " << data[0].y << std::endl;
+            std::cout << "data 0 r: " << data[0].r << std::endl;
+            std::cout << "data 0 g: " << data[0].g << std::endl;
+            std::cout << "data 0 b: " << data[0].b << std::endl;
+            std::cout << "data 0 rotation: " << data[0].rotation << std::endl;
+            std::cout << "data 0 speed: " << data[0].speed << std::endl;
+            std::cout << "data 0 size: " << data[0].size << std::endl;
+
+
+
+            /*std::cout << app.m_entities[0].x << std::endl;
+            std::cout << app.m_entities[0].y << std::endl;
+            std::cout << app.m_entities[0].r << std::endl;
+            std::cout << app.m_entities[0].g << std::endl;
+            std::cout << app.m_entities[0].b << std::endl;
+            std::cout << app.m_entities[0].rotation << std::endl;
+            std::cout << app.m_entities[0].speed << std::endl;
+            std::cout << app.m_entities[0].size << std::endl;*/
+
+            /*std::cout << "data 1 rotation: " << data[1].rotation << std::endl;
+            std::cout << "data 2 rotation: " << data[2].rotation << std::endl;
+            std::cout << "data 3 rotation: " << data[3].rotation << std::endl;
+            std::cout << "data 4 rotation: " << data[4].rotation << std::endl;
+            std::cout << "data 5 rotation: " << data[5].rotation << std::endl;
+            std::cout << "data 6 rotation: " << data[6].rotation << std::endl;
+            std::cout << "data 7 rotation: " << data[7].rotation << std::endl;
+            std::cout << "data 8 rotation: " << data[8].rotation << std::endl;
+            std::cout << "data 9 rotation: " << data[9].rotation << std::endl;*/
+        }
 #endif        
 
         // Draw
@@ -189,9 +376,23 @@ int main(int argc, char* argv[])
         app.Draw();
         //----------------------------------------------------------------------------------
 
-        app.m_entities.clear();
+        // ZORA: Drawing has finished once Draw returns, so this is the whole of the frame's trip. Redraws of a frame already counted aren't counted again.
+        uint64_t publishedUs = subscriber->GetSnapshotPublishedUs();
+        if (transferred && publishedUs != 0) {
+            uint64_t nowUs = GetMonotonicMicroseconds();
+            latency.Record(nowUs > publishedUs ? nowUs - publishedUs : 0);
+        }
 
-        UnmapViewOfFile(data);
+        // ZORA: Each dump covers the frames since the last one, so a dump taken after changing something shows only its effect
+        if (app.m_dumpLatency) {
+            app.m_dumpLatency = false;
+            if (latency.Dump(latencyPath)) {
+#ifndef NDEBUG
+                std::cout << "Latency histogram written to " << latencyPath << std::endl;
+#endif
+                latency.Reset();
+            }
+        }
     }
 
     // De-Initialization
@@ -210,8 +411,21 @@ int main(int argc, char* argv[])
 
     // +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 
-    CloseHandle(fileHandle_01);
-    CloseHandle(fileHandle_02);
+    if (latencyOnExit && latency.GetCount() > 0 && !latency.Dump(latencyPath)) {
+#ifndef NDEBUG
+        std::cout << "Could not write latency histogram to " << latencyPath << std::endl;
+#endif
+    }
+
+    // ZORA: Closing also unmaps the long-lived view
+    for (auto& ring : commandRings)
+        ring.Close();
+    for (auto& arena : arenas)
+        arena.Close();
+    replay.Close();
+    udp.Close();
+    socket.Close();
+    segment.Close();
 
     return 0;
 }
\ No newline at end of file
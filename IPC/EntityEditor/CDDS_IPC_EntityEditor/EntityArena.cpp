@@ -0,0 +1,183 @@
+#include "EntityArena.h"
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <new>
+
+// ZORA: The directory's layout in the pool: the number of entries, then the entries
+static const uint64_t DIRECTORY_ENTRIES_OFFSET = sizeof(uint64_t);
+
+EntityArena::EntityArena() : m_header(nullptr), m_writer(false), m_frame(0) {
+
+}
+
+EntityArena::~EntityArena() {
+	Close();
+}
+
+bool EntityArena::Create(const char* name) {
+	Close();
+
+	uint64_t poolOffset = (sizeof(EntityArenaHeader) + 63) / 64 * 64;
+	if (!m_memory.Create(name, ENTITY_ARENA_SIZE))
+		return false;
+
+	// ZORA: New shared memory reads as zero, so no Display accepts the arena until the magic number is written below
+	m_header = new (m_memory.GetView()) EntityArenaHeader();
+	m_header->version = ENTITY_ARENA_VERSION;
+	m_header->poolOffset = poolOffset;
+	m_header->poolSize = ENTITY_ARENA_SIZE - poolOffset;
+	m_header->directory.store(0, std::memory_order_relaxed);
+	m_pool.Create((char*)m_memory.GetView() + poolOffset, (size_t)m_header->poolSize);
+	m_header->magic.store(ENTITY_ARENA_MAGIC, std::memory_order_release);
+
+	m_writer = true;
+	m_frame = 0;
+	m_retired.clear();
+	return true;
+}
+
+bool EntityArena::Open(const char* name) {
+	Close();
+
+	if (!m_memory.Open(name))
+		return false;
+
+	EntityArenaHeader* header = (EntityArenaHeader*)m_memory.GetView();
+	const char* problem = nullptr;
+
+	if (m_memory.GetSize() < sizeof(EntityArenaHeader))
+		problem = "arena is smaller than its header";
+	else if (header->magic.load(std::memory_order_acquire) != ENTITY_ARENA_MAGIC)
+		problem = "arena has no header";
+	else if (header->version != ENTITY_ARENA_VERSION)
+		problem = "arena layout version doesn't match";
+	else if (header->poolOffset < sizeof(EntityArenaHeader) || header->poolOffset > m_memory.GetSize() || header->poolSize > m_memory.GetSize() - header->poolOffset)
+		problem = "arena is smaller than its pool";
+	else if (!m_pool.Open((char*)m_memory.GetView() + header->poolOffset, (size_t)header->poolSize))
+		problem = "arena has no pool";
+
+	if (problem != nullptr) {
+#ifndef NDEBUG
+		std::cout << "Could not open arena " << name << ": " << problem << std::endl;
+#endif
+		m_memory.Close();
+		return false;
+	}
+
+	m_header = header;
+	m_writer = false;
+	return true;
+}
+
+void EntityArena::Close() {
+	m_header = nullptr;
+	m_pool = SharedMemPool();
+	m_writer = false;
+	m_retired.clear();
+	m_memory.Close();
+}
+
+bool EntityArena::IsOpen() const {
+	return m_header != nullptr;
+}
+
+bool EntityArena::SetPayload(uint32_t index, const void* data, uint32_t bytes) {
+	if (m_header == nullptr || !m_writer)
+		return false;
+
+	// ZORA: Grow the directory to reach 'index', doubling so that naming entities one after another only moves it a handful of times. The old directory is retired rather than freed, as a Display may be looking an entry up in it.
+	if (GetEntry(index) == nullptr) {
+		if (bytes == 0)
+			return true;
+
+		uint64_t oldDirectory = m_header->directory.load(std::memory_order_relaxed);
+		uint64_t oldCount = oldDirectory != 0 ? *(uint64_t*)m_pool.Resolve(oldDirectory, sizeof(uint64_t)) : 0;
+		uint64_t newCount = oldCount > 0 ? oldCount : 64;
+		while (newCount <= index)
+			newCount *= 2;
+
+		uint64_t newDirectory = m_pool.Alloc((size_t)(DIRECTORY_ENTRIES_OFFSET + newCount * sizeof(uint64_t)));
+		if (newDirectory == 0)
+			return false;
+
+		// ZORA: The pool hands out zeroed memory, so every entry past the old ones already reads as no payload
+		uint8_t* directory = (uint8_t*)m_pool.Resolve(newDirectory, (size_t)(DIRECTORY_ENTRIES_OFFSET + newCount * sizeof(uint64_t)));
+		*(uint64_t*)directory = newCount;
+		if (oldCount > 0)
+			memcpy(directory + DIRECTORY_ENTRIES_OFFSET, (uint8_t*)m_pool.Resolve(oldDirectory, sizeof(uint64_t)) + DIRECTORY_ENTRIES_OFFSET, (size_t)(oldCount * sizeof(uint64_t)));
+
+		m_header->directory.store(newDirectory, std::memory_order_release);
+		if (oldDirectory != 0)
+			Retire(oldDirectory);
+	}
+
+	uint64_t payload = 0;
+	if (bytes > 0) {
+		payload = m_pool.Alloc(bytes);
+		if (payload == 0)
+			return false;
+		memcpy(m_pool.Resolve(payload, bytes), data, bytes);
+	}
+
+	// ZORA: The release store publishes the payload's bytes along with the entry that points at them
+	uint64_t entry = bytes > 0 ? (payload << 32) | bytes : 0;
+	uint64_t old = GetEntry(index)->exchange(entry, std::memory_order_acq_rel);
+	if (old != 0)
+		Retire(old >> 32);
+	return true;
+}
+
+void EntityArena::EndFrame() {
+	if (m_header == nullptr || !m_writer)
+		return;
+
+	m_frame++;
+
+	// ZORA: Blocks are retired in frame order, so the ones old enough to free are all at the front
+	size_t freed = 0;
+	while (freed < m_retired.size() && m_frame - m_retired[freed].frame >= ENTITY_ARENA_RETIRE_FRAMES)
+		m_pool.Free(m_retired[freed++].offset);
+	m_retired.erase(m_retired.begin(), m_retired.begin() + freed);
+}
+
+const void* EntityArena::GetPayload(uint32_t index, uint32_t& bytes) const {
+	bytes = 0;
+	std::atomic<uint64_t>* entry = GetEntry(index);
+	if (entry == nullptr)
+		return nullptr;
+
+	// ZORA: Resolve checks the entry against the pool, so even an entry the Display caught mid-way through being replaced can't send it outside the arena
+	uint64_t value = entry->load(std::memory_order_acquire);
+	const void* payload = value != 0 ? m_pool.Resolve(value >> 32, (size_t)(value & 0xFFFFFFFF)) : nullptr;
+	if (payload != nullptr)
+		bytes = (uint32_t)(value & 0xFFFFFFFF);
+	return payload;
+}
+
+int EntityArena::GetErrorCode() const {
+	return m_memory.GetErrorCode();
+}
+
+std::atomic<uint64_t>* EntityArena::GetEntry(uint32_t index) const {
+	if (m_header == nullptr)
+		return nullptr;
+
+	uint64_t directory = m_header->directory.load(std::memory_order_acquire);
+	uint64_t* count = directory != 0 ? (uint64_t*)m_pool.Resolve(directory, sizeof(uint64_t)) : nullptr;
+	if (count == nullptr || index >= *count)
+		return nullptr;
+
+	uint8_t* entries = (uint8_t*)m_pool.Resolve(directory + DIRECTORY_ENTRIES_OFFSET, (size_t)(*count * sizeof(uint64_t)));
+	if (entries == nullptr)
+		return nullptr;
+	return (std::atomic<uint64_t>*)entries + index;
+}
+
+void EntityArena::Retire(uint64_t offset) {
+	m_retired.push_back(RetiredBlock{ offset, m_frame });
+}
+
+void MakeArenaName(char* out, size_t outSize, const char* segmentName, uint32_t partition) {
+	snprintf(out, outSize, "%s.Arena.%u", segmentName, partition);
+}
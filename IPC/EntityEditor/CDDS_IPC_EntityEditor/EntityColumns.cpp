@@ -0,0 +1,69 @@
+#include "EntityColumns.h"
+#include <cstring>
+
+// ZORA: Each column starts on its own cache line, so copying a block of one never touches another
+static const size_t COLUMN_ALIGNMENT = 64;
+
+static size_t AlignColumn(size_t bytes) {
+	return (bytes + COLUMN_ALIGNMENT - 1) / COLUMN_ALIGNMENT * COLUMN_ALIGNMENT;
+}
+
+size_t GetEntityColumnsSize(uint32_t capacity) {
+	return AlignColumn(sizeof(float) * (size_t)capacity) * 5 + AlignColumn(capacity) * 3;
+}
+
+EntityColumns MakeEntityColumns(void* memory, uint32_t capacity) {
+	size_t floats = AlignColumn(sizeof(float) * (size_t)capacity);
+	size_t bytes = AlignColumn(capacity);
+	char* column = (char*)memory;
+
+	EntityColumns columns;
+	columns.x = (float*)column;
+	columns.y = (float*)(column += floats);
+	columns.rotation = (float*)(column += floats);
+	columns.speed = (float*)(column += floats);
+	columns.size = (float*)(column += floats);
+	columns.r = (unsigned char*)(column += floats);
+	columns.g = (unsigned char*)(column += bytes);
+	columns.b = (unsigned char*)(column += bytes);
+	return columns;
+}
+
+void GatherEntities(const EntityColumns& columns, uint32_t first, uint32_t count, Entity* entities) {
+	for (uint32_t i = 0; i < count; i++) {
+		Entity& entity = entities[i];
+		entity.x = columns.x[first + i];
+		entity.y = columns.y[first + i];
+		entity.rotation = columns.rotation[first + i];
+		entity.speed = columns.speed[first + i];
+		entity.size = columns.size[first + i];
+		entity.r = columns.r[first + i];
+		entity.g = columns.g[first + i];
+		entity.b = columns.b[first + i];
+	}
+}
+
+void ScatterEntities(const Entity* entities, uint32_t count, const EntityColumns& columns, uint32_t first) {
+	for (uint32_t i = 0; i < count; i++) {
+		const Entity& entity = entities[i];
+		columns.x[first + i] = entity.x;
+		columns.y[first + i] = entity.y;
+		columns.rotation[first + i] = entity.rotation;
+		columns.speed[first + i] = entity.speed;
+		columns.size[first + i] = entity.size;
+		columns.r[first + i] = entity.r;
+		columns.g[first + i] = entity.g;
+		columns.b[first + i] = entity.b;
+	}
+}
+
+void CopyEntityColumns(const EntityColumns& from, uint32_t fromFirst, const EntityColumns& to, uint32_t toFirst, uint32_t count) {
+	memcpy(to.x + toFirst, from.x + fromFirst, sizeof(float) * count);
+	memcpy(to.y + toFirst, from.y + fromFirst, sizeof(float) * count);
+	memcpy(to.rotation + toFirst, from.rotation + fromFirst, sizeof(float) * count);
+	memcpy(to.speed + toFirst, from.speed + fromFirst, sizeof(float) * count);
+	memcpy(to.size + toFirst, from.size + fromFirst, sizeof(float) * count);
+	memcpy(to.r + toFirst, from.r + fromFirst, count);
+	memcpy(to.g + toFirst, from.g + fromFirst, count);
+	memcpy(to.b + toFirst, from.b + fromFirst, count);
+}
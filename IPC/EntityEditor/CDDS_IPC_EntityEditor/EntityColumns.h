@@ -0,0 +1,32 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "Entity.h"
+
+// ZORA: The fields of a run of entities, each in an array of its own, so a loop that only needs some of the fields only pulls those through the cache.
+// The pointers belong to whoever made the view: an EntityStore in the Editor, or a slot of the segment laid out by MakeEntityColumns.
+struct EntityColumns {
+	float* x;
+	float* y;
+	float* rotation;
+	float* speed;
+	float* size;
+	unsigned char* r;
+	unsigned char* g;
+	unsigned char* b;
+};
+
+// ZORA: The bytes MakeEntityColumns needs for 'capacity' entities. Every column starts on its own cache line.
+size_t GetEntityColumnsSize(uint32_t capacity);
+
+// ZORA: Lay out columns for 'capacity' entities in the GetEntityColumnsSize bytes at 'memory'
+EntityColumns MakeEntityColumns(void* memory, uint32_t capacity);
+
+// ZORA: Copy 'count' entities starting at 'first' out of 'columns' into whole Entity structs
+void GatherEntities(const EntityColumns& columns, uint32_t first, uint32_t count, Entity* entities);
+
+// ZORA: Copy 'count' whole Entity structs into 'columns' starting at 'first'
+void ScatterEntities(const Entity* entities, uint32_t count, const EntityColumns& columns, uint32_t first);
+
+// ZORA: Copy 'count' entities from 'from' starting at 'fromFirst' to 'to' starting at 'toFirst', one column at a time
+void CopyEntityColumns(const EntityColumns& from, uint32_t fromFirst, const EntityColumns& to, uint32_t toFirst, uint32_t count);
@@ -0,0 +1,160 @@
+#include "EntityCommandRing.h"
+#include "Platform.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <new>
+
+EntityCommandRing::EntityCommandRing() : m_header(nullptr), m_producer(false), m_cachedHead(0), m_cachedTail(0) {
+
+}
+
+EntityCommandRing::~EntityCommandRing() {
+	Close();
+}
+
+bool EntityCommandRing::Create(const char* name) {
+	Close();
+
+	uint32_t commandsOffset = (sizeof(EntityCommandRingHeader) + 63) / 64 * 64;
+	if (!m_memory.Create(name, commandsOffset + sizeof(EntityCommand) * (size_t)ENTITY_COMMAND_RING_CAPACITY))
+		return false;
+
+	// ZORA: New shared memory reads as zero, so the ring starts out empty and no Display accepts it until the magic number is written below
+	m_header = new (m_memory.GetView()) EntityCommandRingHeader();
+	m_header->version = ENTITY_COMMAND_RING_VERSION;
+	m_header->capacity = ENTITY_COMMAND_RING_CAPACITY;
+	m_header->commandSize = sizeof(EntityCommand);
+	m_header->commandsOffset = commandsOffset;
+	m_header->producerId.store(0, std::memory_order_relaxed);
+	m_header->head.store(0, std::memory_order_relaxed);
+	m_header->tail.store(0, std::memory_order_relaxed);
+	m_header->magic.store(ENTITY_COMMAND_RING_MAGIC, std::memory_order_release);
+
+	m_producer = false;
+	m_cachedHead = 0;
+	m_cachedTail = 0;
+	return true;
+}
+
+bool EntityCommandRing::Open(const char* name) {
+	Close();
+
+	if (!m_memory.Open(name))
+		return false;
+
+	EntityCommandRingHeader* header = (EntityCommandRingHeader*)m_memory.GetView();
+	const char* problem = nullptr;
+
+	if (m_memory.GetSize() < sizeof(EntityCommandRingHeader))
+		problem = "ring is smaller than its header";
+	else if (header->magic.load(std::memory_order_acquire) != ENTITY_COMMAND_RING_MAGIC)
+		problem = "ring has no command header";
+	else if (header->version != ENTITY_COMMAND_RING_VERSION)
+		problem = "ring layout version doesn't match";
+	else if (header->commandSize != sizeof(EntityCommand))
+		problem = "sizeof(EntityCommand) doesn't match";
+	else if (header->capacity == 0 || (header->capacity & (header->capacity - 1)) != 0)
+		problem = "ring capacity isn't a power of two";
+	else if (header->commandsOffset < sizeof(EntityCommandRingHeader) || header->commandsOffset + sizeof(EntityCommand) * (size_t)header->capacity > m_memory.GetSize())
+		problem = "ring is smaller than its capacity";
+
+	// ZORA: Only one compare-exchange can win, so two Displays can never both push. A Display that crashed never let go of the ring, so if its process has gone its claim is taken over, the same way ClaimRange takes back a crashed Editor's partition.
+	uint32_t producerId = 0;
+	if (problem == nullptr) {
+		uint32_t processId = GetCurrentProcessIdentifier();
+		bool claimed = header->producerId.compare_exchange_strong(producerId, processId);
+		while (!claimed && (producerId == 0 || !IsProcessRunning(producerId)))
+			claimed = header->producerId.compare_exchange_strong(producerId, processId);
+		if (!claimed)
+			problem = "another Display is already pushing into the ring";
+	}
+
+	if (problem != nullptr) {
+#ifndef NDEBUG
+		std::cout << "Could not open command ring " << name << ": " << problem << std::endl;
+#endif
+		m_memory.Close();
+		return false;
+	}
+
+	m_header = header;
+	m_producer = true;
+	m_cachedHead = header->head.load(std::memory_order_relaxed);
+	m_cachedTail = header->tail.load(std::memory_order_acquire);
+	return true;
+}
+
+void EntityCommandRing::Close() {
+	if (m_header != nullptr && m_producer)
+		m_header->producerId.store(0, std::memory_order_release);
+
+	m_header = nullptr;
+	m_producer = false;
+	m_memory.Close();
+}
+
+bool EntityCommandRing::IsOpen() const {
+	return m_header != nullptr;
+}
+
+bool EntityCommandRing::TryPush(const EntityCommand& command) {
+	if (m_header == nullptr || !m_producer)
+		return false;
+
+	uint64_t head = m_header->head.load(std::memory_order_relaxed);
+
+	// ZORA: Only look at the Editor's position when the ring looks full, so most pushes never touch its cache line
+	if (head - m_cachedTail >= m_header->capacity) {
+		m_cachedTail = m_header->tail.load(std::memory_order_acquire);
+		if (head - m_cachedTail >= m_header->capacity)
+			return false;
+	}
+
+	GetCommands()[head & (m_header->capacity - 1)] = command;
+
+	// ZORA: The release store makes the command visible before the new head
+	m_header->head.store(head + 1, std::memory_order_release);
+	return true;
+}
+
+uint32_t EntityCommandRing::Drain(EntityCommand* commands, uint32_t maxCommands) {
+	if (m_header == nullptr)
+		return 0;
+
+	uint64_t tail = m_header->tail.load(std::memory_order_relaxed);
+
+	// ZORA: Only look at the Display's position when everything already seen has been drained
+	if (m_cachedHead == tail)
+		m_cachedHead = m_header->head.load(std::memory_order_acquire);
+
+	// ZORA: Never trust a head that claims more than a full ring, whatever the Display wrote
+	uint64_t available = std::min<uint64_t>(m_cachedHead - tail, m_header->capacity);
+	uint32_t count = (uint32_t)std::min<uint64_t>(available, maxCommands);
+	if (count == 0)
+		return 0;
+
+	// ZORA: The batch may run off the end of the ring and wrap back round to the front
+	uint32_t mask = m_header->capacity - 1;
+	uint32_t first = (uint32_t)(tail & mask);
+	uint32_t firstLength = std::min(count, m_header->capacity - first);
+	memcpy(commands, GetCommands() + first, sizeof(EntityCommand) * firstLength);
+	memcpy(commands + firstLength, GetCommands(), sizeof(EntityCommand) * (count - firstLength));
+
+	// ZORA: The release store hands the drained commands' space back to the Display only once they have been copied out
+	m_header->tail.store(tail + count, std::memory_order_release);
+	return count;
+}
+
+int EntityCommandRing::GetErrorCode() const {
+	return m_memory.GetErrorCode();
+}
+
+EntityCommand* EntityCommandRing::GetCommands() const {
+	return (EntityCommand*)((char*)m_memory.GetView() + m_header->commandsOffset);
+}
+
+void MakeCommandRingName(char* out, size_t outSize, const char* segmentName, uint32_t partition) {
+	snprintf(out, outSize, "%s.Commands.%u", segmentName, partition);
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "SharedMemory.h"
+
+// ZORA: Written at the front of the ring so that the Display can tell it has found a command ring, and one laid out the way it expects
+const uint32_t ENTITY_COMMAND_RING_MAGIC = 0x444D4345;	// 'ECMD'
+const uint32_t ENTITY_COMMAND_RING_VERSION = 2;
+
+// ZORA: The number of commands the ring holds. A power of two, so positions wrap with a mask rather than a division.
+const uint32_t ENTITY_COMMAND_RING_CAPACITY = 1024;
+
+// ZORA: The edits the Display can ask an Editor to make
+enum EntityCommandType : uint32_t {
+	ENTITY_COMMAND_SELECT = 1,		// ZORA: Make 'index' the entity the Editor's GUI is editing
+	ENTITY_COMMAND_MOVE = 2,		// ZORA: Put 'index' at x, y
+	ENTITY_COMMAND_RECOLOUR = 3		// ZORA: Give 'index' the colour r, g, b
+};
+
+// ZORA: One edit. 'index' and 'generation' are the entity's handle in the Editor's handle table, so an edit to an entity the Editor has despawned in the meantime is dropped rather than landing on whichever entity took its place.
+struct EntityCommand {
+	uint32_t type;
+	uint32_t index;
+	uint32_t generation;
+	float x, y;
+	unsigned char r, g, b;
+};
+
+// ZORA: The header at the front of the ring. The Display's position and the Editor's position each have a cache line of their own, so pushing and draining never fight over the same line.
+struct EntityCommandRingHeader {
+	std::atomic<uint32_t> magic;		// ZORA: Written last by the creator, so the Display never validates a half-initialised header
+	uint32_t version;
+	uint32_t capacity;					// ZORA: The number of commands the ring holds, a power of two
+	uint32_t commandSize;				// ZORA: sizeof(EntityCommand) in the creating application
+	uint32_t commandsOffset;			// ZORA: The byte offset from the front of the ring to the first command
+
+	alignas(64) std::atomic<uint32_t> producerId;	// ZORA: The Display that is pushing into the ring, or 0. Only one may, so a second Display opens the ring but can't push.
+	alignas(64) std::atomic<uint64_t> head;			// ZORA: The number of commands ever pushed. Only the Display writes it.
+	alignas(64) std::atomic<uint64_t> tail;			// ZORA: The number of commands ever drained. Only the Editor writes it.
+};
+
+// ZORA: A fixed-size ring of edit commands in named shared memory, the return channel from a Display to an Editor.
+// There is exactly one producer, the Display, and one consumer, the Editor, so each end only ever writes its own position and no lock is needed. Each end also keeps its own copy of the other's position and only reloads it when the ring looks full or empty.
+// The Editor drains a bounded batch every frame, so a burst of input can't stall its frame; anything left waits for the next one. When the ring is full TryPush fails straight away rather than waiting.
+class EntityCommandRing {
+public:
+	EntityCommandRing();
+	~EntityCommandRing();
+
+	// ZORA: The Editor creates the ring. Returns false if the shared memory could not be created.
+	bool Create(const char* name);
+
+	// ZORA: The Display opens the ring and becomes the one producer allowed to push into it. Returns false if it doesn't exist, its layout doesn't match, or another Display that is still running is already pushing into it.
+	bool Open(const char* name);
+
+	void Close();
+	bool IsOpen() const;
+
+	// ZORA: Producer side. Returns false, dropping the command, if the ring is full.
+	bool TryPush(const EntityCommand& command);
+
+	// ZORA: Consumer side. Copy up to 'maxCommands' of the oldest commands into 'commands' and return how many were copied.
+	uint32_t Drain(EntityCommand* commands, uint32_t maxCommands);
+
+	int GetErrorCode() const;
+
+private:
+	EntityCommandRing(const EntityCommandRing&) = delete;
+	EntityCommandRing& operator=(const EntityCommandRing&) = delete;
+
+	EntityCommand* GetCommands() const;
+
+	SharedMemory m_memory;
+	EntityCommandRingHeader* m_header;
+	bool m_producer;
+
+	// ZORA: This end's last look at the other end's position
+	uint64_t m_cachedHead;
+	uint64_t m_cachedTail;
+};
+
+// ZORA: The name of the ring belonging to the Editor publishing into 'partition' of the segment called 'segmentName'
+void MakeCommandRingName(char* out, size_t outSize, const char* segmentName, uint32_t partition);
@@ -1,5 +1,7 @@
 #include "EntityEditorApp.h"
-#include <random>
+#include "EntityMotion.h"
+#include <algorithm>
+#include <cstring>
 #include <time.h>
 
 #define RAYGUI_IMPLEMENTATION
@@ -7,7 +9,7 @@
 #include "raygui.h"
 
 
-EntityEditorApp::EntityEditorApp(int screenWidth, int screenHeight) : m_screenWidth(screenWidth), m_screenHeight(screenHeight) {
+EntityEditorApp::EntityEditorApp(int screenWidth, int screenHeight) : m_screenWidth(screenWidth), m_screenHeight(screenHeight), m_commandRing(nullptr), m_commandBatch(COMMAND_BATCH_SIZE), m_arena(nullptr) {
 
 }
 
@@ -20,17 +22,9 @@ bool EntityEditorApp::Startup() {
 	InitWindow(m_screenWidth, m_screenHeight, "EntityDisplayApp");
 	SetTargetFPS(60);
 
-	srand(time(nullptr));
-	for (auto& entity : m_entities) {
-		entity.x = rand()%m_screenWidth;
-		entity.y = rand()%m_screenHeight;
-		entity.size = 10;
-		entity.speed = rand() % 100;
-		entity.rotation = rand() % 360;
-		entity.r = rand() % 255;
-		entity.g = rand() % 255;
-		entity.b = rand() % 255;
-	}
+	m_generator = EntityGenerator((uint32_t)time(nullptr));
+	m_generator.SetBounds((float)m_screenWidth, (float)m_screenHeight);
+	SetEntityCount(INITIAL_ENTITY_COUNT);
 	
 	return true;
 }
@@ -50,56 +44,123 @@ void EntityEditorApp::Update(float deltaTime) {
 	static bool rotationEditMode = false;
 	static bool sizeEditMode = false;
 	static bool speedEditMode = false;
+	static bool countEditMode = false;
+	static bool nameEditMode = false;
 	static Color colorPickerValue = WHITE;
 
+	// ZORA: The selected entity is held by handle, so it stays selected however the entities around it come and go
+	static EntityHandle selectionHandle = {};
+
+	// ZORA: The number of entities only changes once editing of the box is finished, not on every keystroke
+	static int count = INITIAL_ENTITY_COUNT;
+	if (GuiValueBox(Rectangle{ 300, 25, 125, 25 }, "Count", &count, 1, MAX_ENTITY_COUNT, countEditMode)) {
+		countEditMode = !countEditMode;
+		if (!countEditMode)
+			SetEntityCount(count);
+	}
+
+	// ZORA: Apply whatever the Display asked for since last frame, before the GUI reads the selected entity
+	uint32_t commandCount = m_commandRing != nullptr ? m_commandRing->Drain(m_commandBatch.data(), COMMAND_BATCH_SIZE) : 0;
+	for (uint32_t i = 0; i < commandCount; i++) {
+		const EntityCommand& command = m_commandBatch[i];
+		EntityHandle handle = EntityHandle{ command.index, command.generation };
+		uint32_t index = 0;
+		if (!m_handles.Resolve(handle, index) || index >= m_store.GetCount())
+			continue;
+
+		EntityColumns columns = m_store.GetColumns();
+		switch (command.type) {
+		case ENTITY_COMMAND_SELECT:
+			selectionHandle = handle;
+			break;
+		case ENTITY_COMMAND_MOVE:
+			columns.x[index] = command.x;
+			columns.y[index] = command.y;
+			m_dirty[index] = true;
+			break;
+		case ENTITY_COMMAND_RECOLOUR:
+			columns.r[index] = command.r;
+			columns.g[index] = command.g;
+			columns.b[index] = command.b;
+			m_dirty[index] = true;
+			break;
+		}
+	}
 
-	if (GuiSpinner(Rectangle{ 90, 25, 125, 25 }, "Entity", &selection, 0, ENTITY_COUNT-1, selectionEditMode)) selectionEditMode = !selectionEditMode;
+	// ZORA: Find the selected entity wherever it is now. If it has been despawned, whatever is in its old place is selected instead.
+	uint32_t selectionIndex = 0;
+	if (m_handles.Resolve(selectionHandle, selectionIndex))
+		selection = (int)selectionIndex;
+
+	if (selection >= (int)m_store.GetCount())
+		selection = (int)m_store.GetCount() - 1;
+
+	if (GuiSpinner(Rectangle{ 90, 25, 125, 25 }, "Entity", &selection, 0, (int)m_store.GetCount()-1, selectionEditMode)) selectionEditMode = !selectionEditMode;
+	selectionHandle = m_handles.GetHandle((uint32_t)selection);
+
+	// ZORA: The GUI edits a whole copy of the selected entity, which is written back to the store once it is done
+	Entity selected = m_store.Get((uint32_t)selection);
 	
-	int intX = (int)m_entities[selection].x;	
-	int intY = (int)m_entities[selection].y;
-	int intRotation = (int)m_entities[selection].rotation;
-	int intSize = (int)m_entities[selection].size;
-	int intSpeed = (int)m_entities[selection].speed;
+	int intX = (int)selected.x;	
+	int intY = (int)selected.y;
+	int intRotation = (int)selected.rotation;
+	int intSize = (int)selected.size;
+	int intSpeed = (int)selected.speed;
 
 
 	// display editable stats within a GUI	
 	GuiGroupBox(Rectangle{ 25, 70, 480, 220 }, "Entity Properties");
 
 	if (GuiValueBox(Rectangle{ 90, 90, 125, 25 }, "x", &intX, 0, m_screenWidth, xEditMode)) xEditMode = !xEditMode;
-	m_entities[selection].x = intX;
+	selected.x = intX;
 
 	if (GuiValueBox(Rectangle{ 90, 120, 125, 25 }, "y", &intY, 0, m_screenHeight, yEditMode)) yEditMode = !yEditMode;
-	m_entities[selection].y = intY;
+	selected.y = intY;
 
-	m_entities[selection].rotation = GuiSlider(Rectangle{ 90, 150, 125, 25 }, "rotation", TextFormat("%2.2f", m_entities[selection].rotation), m_entities[selection].rotation, 0, 360);
-	m_entities[selection].size = GuiSlider(Rectangle{ 90, 180, 125, 25 }, "size", TextFormat("%2.2f", m_entities[selection].size), m_entities[selection].size, 0, 100);
-	m_entities[selection].speed = GuiSlider(Rectangle{ 90, 210, 125, 25 }, "speed", TextFormat("%2.2f", m_entities[selection].speed), m_entities[selection].speed, 0, 100);
+	selected.rotation = GuiSlider(Rectangle{ 90, 150, 125, 25 }, "rotation", TextFormat("%2.2f", selected.rotation), selected.rotation, 0, 360);
+	selected.size = GuiSlider(Rectangle{ 90, 180, 125, 25 }, "size", TextFormat("%2.2f", selected.size), selected.size, 0, 100);
+	selected.speed = GuiSlider(Rectangle{ 90, 210, 125, 25 }, "speed", TextFormat("%2.2f", selected.speed), selected.speed, 0, 100);
 	
-	colorPickerValue = GuiColorPicker(Rectangle{ 260, 90, 156, 162 }, Color{ m_entities[selection].r, m_entities[selection].g, m_entities[selection].b });
-	m_entities[selection].r = colorPickerValue.r;
-	m_entities[selection].g = colorPickerValue.g;
-	m_entities[selection].b = colorPickerValue.b;
+	colorPickerValue = GuiColorPicker(Rectangle{ 260, 90, 156, 162 }, Color{ selected.r, selected.g, selected.b });
+	selected.r = colorPickerValue.r;
+	selected.g = colorPickerValue.g;
+	selected.b = colorPickerValue.b;
+	m_store.Set((uint32_t)selection, selected);
 
+	// ZORA: The name box holds a copy of the selected entity's name from the arena, reloaded whenever the selection changes. The arena is only written once editing of the box is finished, not on every keystroke.
+	// Names are kept under the entity's handle slot rather than its place in the array, so a name stays with its entity when the array is rearranged.
+	if (m_arena != nullptr) {
+		static char name[MAX_NAME_LENGTH + 1] = {};
+		static EntityHandle nameHandle = {};
+		if (nameHandle != selectionHandle) {
+			uint32_t bytes = 0;
+			const void* payload = m_arena->GetPayload(selectionHandle.index, bytes);
+			bytes = std::min<uint32_t>(bytes, MAX_NAME_LENGTH);
+			if (payload != nullptr)
+				memcpy(name, payload, bytes);
+			name[bytes] = 0;
+			nameHandle = selectionHandle;
+			nameEditMode = false;
+		}
 
-	// move entities
+		GuiLabel(Rectangle{ 50, 240, 40, 25 }, "name");
+		if (GuiTextBox(Rectangle{ 90, 240, 125, 25 }, name, MAX_NAME_LENGTH + 1, nameEditMode)) {
+			nameEditMode = !nameEditMode;
+			if (!nameEditMode)
+				m_arena->SetPayload(selectionHandle.index, name, (uint32_t)strlen(name));
+		}
+	}
 
-	for (int i=0; i<ENTITY_COUNT; i++) {
-		if(selection == i)
-			continue;
+	// ZORA: The GUI only ever edits the selected entity
+	m_dirty[selection] = true;
 
-		float s = sinf(m_entities[i].rotation) * m_entities[i].speed;
-		float c = cosf(m_entities[i].rotation) * m_entities[i].speed;
-		m_entities[i].x -= s * deltaTime;
-		m_entities[i].y += c * deltaTime;
-
-		// wrap position around the screen
-		m_entities[i].x = fmod(m_entities[i].x, m_screenWidth);
-		if (m_entities[i].x < 0)
-			m_entities[i].x += m_screenWidth;
-		m_entities[i].y = fmod(m_entities[i].y, m_screenHeight);
-		if (m_entities[i].y < 0)
-			m_entities[i].y += m_screenHeight;
-	}
+
+	// move entities
+	// ZORA: Only the x, y, rotation and speed columns are read or written here, by the widest SIMD kernel the CPU has. The selected entity stays where the GUI put it, so the entities either side of it are moved as two runs.
+	EntityColumns columns = m_store.GetColumns();
+	uint32_t entityCount = m_store.GetCount();
+	MoveEntities(columns, 0, (uint32_t)selection, deltaTime, (float)m_screenWidth, (float)m_screenHeight, m_dirty.data());
+	MoveEntities(columns, (uint32_t)selection + 1, entityCount - (uint32_t)selection - 1, deltaTime, (float)m_screenWidth, (float)m_screenHeight, m_dirty.data());
 }
 
 void EntityEditorApp::Draw() {
@@ -108,12 +169,13 @@ void EntityEditorApp::Draw() {
 	ClearBackground(RAYWHITE);
 
 	// draw entities
-	for (auto& entity : m_entities) {
+	EntityColumns columns = m_store.GetColumns();
+	for (uint32_t i = 0; i < m_store.GetCount(); i++) {
 		DrawRectanglePro(
-			Rectangle{ entity.x, entity.y, entity.size, entity.size }, // rectangle
-			Vector2{ entity.size / 2, entity.size / 2 }, // origin
-			entity.rotation,
-			Color{ entity.r, entity.g, entity.b, 255 });
+			Rectangle{ columns.x[i], columns.y[i], columns.size[i], columns.size[i] }, // rectangle
+			Vector2{ columns.size[i] / 2, columns.size[i] / 2 }, // origin
+			columns.rotation[i],
+			Color{ columns.r[i], columns.g[i], columns.b[i], 255 });
 	}
 
 	// output some text, uses the last used colour
@@ -122,19 +184,134 @@ void EntityEditorApp::Draw() {
 	EndDrawing();
 }
 
-// ZORA: Return the unsigned int size of the array's memory allocation, cast to a DWORD object for defining the memory needs of the NSM HANDLE
-DWORD EntityEditorApp::GetArraySize() {
-	return (DWORD)sizeof(Entity) * ENTITY_COUNT;
-}
+// ZORA: Send the entities that changed since the last call through every transport the Displays are listening on
+void EntityEditorApp::PublishEntities(const std::vector<EntityPublisher*>& publishers) {
+	// ZORA: Ask for more room when the store outgrows a transport's range. Doubling means growing one entity at a time from 10 to 10M only resizes a couple of dozen times.
+	// If the resize can't happen this frame, the entities that fit are still published and it is tried again next frame.
+	unsigned int count = GetEntityCount();
+	for (auto publisher : publishers) {
+		if (count > publisher->GetRangeCapacity())
+			publisher->Resize(std::max(count, publisher->GetRangeCapacity() * 2));
+	}
+
+	// ZORA: Transports that can't take columns are sent m_gathered instead, kept up to date one changed entity at a time
+	bool gather = false;
+	for (auto publisher : publishers)
+		gather = gather || !publisher->AcceptsColumns();
+	if (gather)
+		m_gathered.resize(count);
+	else
+		m_gathered.clear();
 
-// ZORA: Return the memory address of the first object in the array of Entity objects
-void EntityEditorApp::ArrayOfEntities(Entity* entity) {
-	for (int i = 0; i < ENTITY_COUNT; i++) {
-		entity[i] = m_entities[i];
+	EntityColumns columns = m_store.GetColumns();
+	for (unsigned int i = 0; i < count; i++) {
+		if (m_dirty[i]) {
+			for (auto publisher : publishers)
+				publisher->MarkDirty(i);
+			if (gather)
+				GatherEntities(columns, i, 1, &m_gathered[i]);
+			m_dirty[i] = false;
+		}
 	}
-};
+
+	// ZORA: Handles go first, so no Display ever sees an entity it can't get a handle for
+	for (auto publisher : publishers)
+		publisher->PublishHandles(m_handles);
+	m_handles.ClearChanges();
+
+	for (auto publisher : publishers) {
+		if (publisher->AcceptsColumns())
+			publisher->PublishColumns(columns, count);
+		else
+			publisher->Publish(m_gathered.data(), count);
+	}
+
+	if (m_arena != nullptr)
+		m_arena->EndFrame();
+}
 
 // ZORA: Return the volume of entities in the array as an unsigned int
 unsigned int EntityEditorApp::GetEntityCount() {
-	return (unsigned int)ENTITY_COUNT;
+	return m_store.GetCount();
+}
+
+void EntityEditorApp::SetCommandRing(EntityCommandRing* commands) {
+	m_commandRing = commands;
+}
+
+void EntityEditorApp::SetArena(EntityArena* arena) {
+	m_arena = arena;
+}
+
+void EntityEditorApp::SetEntityCount(unsigned int count) {
+	size_t oldCount = m_store.GetCount();
+	if (count > oldCount) {
+		SpawnEntities(count - (unsigned int)oldCount, m_generator);
+		return;
+	}
+
+	// ZORA: Entities are removed from the end, last first, so each one is already the last when it goes and nothing that stays behind moves
+	std::vector<EntityHandle> handles;
+	handles.reserve(oldCount - count);
+	for (size_t i = oldCount; i > count; i--)
+		handles.push_back(m_handles.GetHandle((uint32_t)(i - 1)));
+	DespawnEntities(handles.data(), handles.size());
+}
+
+unsigned int EntityEditorApp::SpawnEntities(unsigned int count, EntityGenerator& generator) {
+	uint32_t first = m_store.GetCount();
+	if (count > MAX_ENTITY_COUNT - first)
+		count = MAX_ENTITY_COUNT - first;
+
+	// ZORA: One resize for the whole block, then the generator writes straight into its columns
+	m_store.Resize(first + count);
+	m_dirty.resize(first + count, 1);
+	generator.Generate(m_store.GetColumns(), first, count);
+
+	for (uint32_t i = first; i < m_store.GetCount(); i++)
+		m_handles.Spawn((uint32_t)i);
+
+	return first;
+}
+
+unsigned int EntityEditorApp::DespawnEntities(const EntityHandle* handles, size_t count) {
+	unsigned int removed = 0;
+	for (size_t i = 0; i < count; i++) {
+		uint32_t index = 0;
+		if (!m_handles.Resolve(handles[i], index) || index >= m_store.GetCount())
+			continue;
+
+		uint32_t last = m_store.GetCount() - 1;
+		EntityHandle lastHandle = m_handles.GetHandle(last);
+
+		// ZORA: The name goes with the entity. The arena only frees it once no Display can still be reading it.
+		if (m_arena != nullptr)
+			m_arena->SetPayload(handles[i].index, nullptr, 0);
+		m_handles.Despawn(handles[i]);
+
+		// ZORA: The last entity fills the gap and is shared again from its new place
+		if (index != last) {
+			m_store.Move(last, index);
+			m_dirty[index] = true;
+			m_handles.Move(lastHandle, index);
+		}
+
+		m_store.PopBack();
+		m_dirty.pop_back();
+		removed++;
+	}
+	return removed;
+}
+
+void EntityEditorApp::ChurnEntities(unsigned int count) {
+	// ZORA: Always leave one entity, as the GUI needs something to select
+	unsigned int despawnCount = GetEntityCount() > 0 ? std::min(count, GetEntityCount() - 1) : 0;
+
+	// ZORA: Picking the same entity twice only despawns it once, so a few less than 'count' may go
+	m_churnHandles.clear();
+	for (unsigned int i = 0; i < despawnCount; i++)
+		m_churnHandles.push_back(m_handles.GetHandle(m_generator.NextIndex(GetEntityCount())));
+
+	DespawnEntities(m_churnHandles.data(), m_churnHandles.size());
+	SpawnEntities(count, m_generator);
 }
\ No newline at end of file
@@ -1,15 +1,15 @@
 #pragma once
 #include <vector>
+#include <cstddef>
+#include <cstdint>
 #include "raylib.h"
-#include "WinInc.h"
-
-struct Entity {
-	float x = 0, y = 0;
-	float rotation = 0;
-	float speed = 0;
-	unsigned char r = 0, g = 0, b = 0;
-	float size = 1;
-};
+#include "Entity.h"
+#include "EntityArena.h"
+#include "EntityCommandRing.h"
+#include "EntityGenerator.h"
+#include "EntityHandle.h"
+#include "EntityStore.h"
+#include "EntityTransport.h"
 
 class EntityEditorApp {
 public:
@@ -22,21 +22,65 @@ public:
 	void Update(float deltaTime);
 	void Draw();
 
-	// ZORA: Return the unsigned int size of the array's memory allocation, cast to a DWORD object for defining the memory needs of the NSM HANDLE
-	DWORD GetArraySize();
-
-	// ZORA: Return the memory address of the first object in the array of Entity objects
-	void ArrayOfEntities(Entity* entity);
+	// ZORA: Send the entities that changed since the last call through every transport the Displays are listening on
+	void PublishEntities(const std::vector<EntityPublisher*>& publishers);
 
 	unsigned int GetEntityCount();
 
+	// ZORA: Take edits from the Display out of 'commands' at the start of every Update. Pass nullptr to stop.
+	void SetCommandRing(EntityCommandRing* commands);
+
+	// ZORA: Keep entity names in 'arena', where the Display reads them in place. Pass nullptr to stop; the name box is then left out of the GUI.
+	void SetArena(EntityArena* arena);
+
+	// ZORA: Grow or shrink the store to 'count' entities. New entities are given random positions, speeds and colours like the ones made at startup.
+	void SetEntityCount(unsigned int count);
+
+	// ZORA: Add 'count' entities to the end of the store in one contiguous block, filled in by 'generator'. Returns the index of the first.
+	unsigned int SpawnEntities(unsigned int count, EntityGenerator& generator);
+
+	// ZORA: Remove the entities behind the 'count' handles in 'handles'. Each gap is filled by moving the last entity into it, so the store stays dense and only one entity moves per removal. Handles that have already gone are skipped. Returns the number removed.
+	unsigned int DespawnEntities(const EntityHandle* handles, size_t count);
+
+	// ZORA: Despawn 'count' entities picked at random and spawn 'count' new ones, for load testing the Displays against entities that come and go
+	void ChurnEntities(unsigned int count);
+
 //protected:
 	int m_screenWidth;
 	int m_screenHeight;
 
+	// ZORA: The number of entities the Editor starts with, and the most it can be given from the GUI
+	enum { INITIAL_ENTITY_COUNT = 10, MAX_ENTITY_COUNT = 10000000 };
+
+	// ZORA: The most commands from the Display applied in one frame. Anything more waits in the ring for the next frame, so a burst of input never holds up a frame.
+	enum { COMMAND_BATCH_SIZE = 256 };
+
+	// ZORA: The longest name the GUI lets an entity be given, in bytes
+	enum { MAX_NAME_LENGTH = 63 };
+
 	// define a block of entities that should be shared
-	enum { ENTITY_COUNT = 10 };
-	Entity m_entities[ENTITY_COUNT];
+	// ZORA: Kept a column per field, so the loops over every entity only pull in the fields they use
+	EntityStore m_store;
+
+	// ZORA: The same entities as whole structs, for transports that can't take columns. Only the entities that changed are gathered into it each frame, and only if such a transport is publishing.
+	std::vector<Entity> m_gathered;
+
+	// ZORA: Set for every entity that Update changed since the last PublishEntities, so only those are copied into shared memory
+	std::vector<uint8_t> m_dirty;
+
+	// ZORA: A handle for every entity in m_store, which is what the GUI, the Display's edits and the arena hold on to instead of its place in the array
+	EntityHandleTable m_handles;
+
+	// ZORA: Where edits from the Display arrive, and room to drain a batch of them into
+	EntityCommandRing* m_commandRing;
+	std::vector<EntityCommand> m_commandBatch;
+
+	// ZORA: Where entity names are kept, if anywhere
+	EntityArena* m_arena;
+
+	// ZORA: Fills in every entity the Editor spawns itself
+	EntityGenerator m_generator;
 
-	HANDLE h;
+	// ZORA: Room for the handles ChurnEntities picks, kept so churning every frame doesn't allocate
+	std::vector<EntityHandle> m_churnHandles;
 };
\ No newline at end of file
@@ -0,0 +1,70 @@
+#include "EntityGenerator.h"
+
+// ZORA: The number of random numbers each entity uses: x, y, speed, rotation, r, g and b
+static const uint32_t FIELD_COUNT = 7;
+
+// ZORA: Chris Wellons' lowbias32 integer hash. Two multiplies and three shifts, all of which SSE4.1 and AVX2 do eight lanes at a time, with every output bit depending on every input bit.
+static inline uint32_t Hash(uint32_t x) {
+	x ^= x >> 16;
+	x *= 0x7FEB352Du;
+	x ^= x >> 15;
+	x *= 0x846CA68Bu;
+	x ^= x >> 16;
+	return x;
+}
+
+// ZORA: The top 24 bits as a float in [0, 1), which is every bit a float can hold
+static inline float ToUnit(uint32_t x) {
+	return (float)(x >> 8) * (1.0f / 16777216.0f);
+}
+
+EntityGenerator::EntityGenerator(uint32_t seed) : m_seed(Hash(seed)), m_counter(0), m_width(1), m_height(1) {
+
+}
+
+void EntityGenerator::SetBounds(float width, float height) {
+	m_width = width;
+	m_height = height;
+}
+
+void EntityGenerator::Generate(const EntityColumns& columns, uint32_t first, uint32_t count) {
+	// ZORA: Split wherever the top half of the counter changes, so each run hashes it once and the loops only count in the bottom half. An entity whose fields straddle the change keeps the top half it started with.
+	while (count > 0) {
+		uint32_t low = (uint32_t)m_counter;
+		uint64_t left = ((uint64_t)1 << 32) - low;
+		uint32_t run = left / FIELD_COUNT < count ? (uint32_t)(left / FIELD_COUNT) : count;
+		if (run == 0)
+			run = 1;
+
+		GenerateRun(columns, first, run, Hash(m_seed ^ (uint32_t)(m_counter >> 32)), low);
+		m_counter += (uint64_t)run * FIELD_COUNT;
+		first += run;
+		count -= run;
+	}
+}
+
+void EntityGenerator::GenerateRun(const EntityColumns& columns, uint32_t first, uint32_t count, uint32_t key, uint32_t base) {
+	unsigned char* colours[3] = { columns.r + first, columns.g + first, columns.b + first };
+
+	// ZORA: One loop per field, with no dependency from one entity to the next, so each loop vectorises
+	for (uint32_t i = 0; i < count; i++)
+		columns.x[first + i] = ToUnit(Hash(key ^ (base + i * FIELD_COUNT + 0))) * m_width;
+	for (uint32_t i = 0; i < count; i++)
+		columns.y[first + i] = ToUnit(Hash(key ^ (base + i * FIELD_COUNT + 1))) * m_height;
+	for (uint32_t i = 0; i < count; i++)
+		columns.speed[first + i] = ToUnit(Hash(key ^ (base + i * FIELD_COUNT + 2))) * 100;
+	for (uint32_t i = 0; i < count; i++)
+		columns.rotation[first + i] = ToUnit(Hash(key ^ (base + i * FIELD_COUNT + 3))) * 360;
+	for (uint32_t i = 0; i < count; i++)
+		columns.size[first + i] = 10;
+	for (uint32_t channel = 0; channel < 3; channel++)
+		for (uint32_t i = 0; i < count; i++)
+			colours[channel][i] = (unsigned char)(Hash(key ^ (base + i * FIELD_COUNT + 4 + channel)) % 255);
+}
+
+uint32_t EntityGenerator::NextIndex(uint32_t bound) {
+	// ZORA: The top half is hashed in first, as in Generate, so the sequence doesn't start over once the bottom half wraps around
+	uint32_t value = Hash(Hash(m_seed ^ (uint32_t)(m_counter >> 32)) ^ (uint32_t)m_counter);
+	m_counter++;
+	return (uint32_t)(((uint64_t)value * bound) >> 32);
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "EntityColumns.h"
+
+// ZORA: Fills blocks of new entities with random positions, speeds, rotations and colours, in the same ranges the Editor has always given them, fast enough to spawn hundreds of thousands a second.
+// rand() is a call per field, and each number depends on the one before, so nothing can be worked on side by side. Each number here is instead a hash of the seed and the number's place in the sequence, so every lane of a SIMD register can work on a different entity and the compiler vectorises the loops without any intrinsics.
+// Each field is generated straight into its column, one loop per field.
+class EntityGenerator {
+public:
+	explicit EntityGenerator(uint32_t seed = 0);
+
+	// ZORA: New entities are placed within 'width' by 'height'
+	void SetBounds(float width, float height);
+
+	// ZORA: Fill 'count' entities of 'columns' starting at 'first'
+	void Generate(const EntityColumns& columns, uint32_t first, uint32_t count);
+
+	// ZORA: A random number below 'bound', for picking entities to despawn
+	uint32_t NextIndex(uint32_t bound);
+
+private:
+	// ZORA: Generate, for a run of entities over which the top half of the counter stays the same. 'key' is the seed mixed with that top half, and 'base' is the bottom half where the run starts.
+	void GenerateRun(const EntityColumns& columns, uint32_t first, uint32_t count, uint32_t key, uint32_t base);
+
+	uint32_t m_seed;
+	uint64_t m_counter;	// ZORA: The place in the sequence. Each entity uses one number per field, so 32 bits would run out after about 600 million entities.
+	float m_width;
+	float m_height;
+};
@@ -0,0 +1,102 @@
+#include "EntityHandle.h"
+
+EntityHandleTable::EntityHandleTable() : m_freeHead(ENTITY_HANDLE_NONE) {
+
+}
+
+EntityHandle EntityHandleTable::Spawn(uint32_t entityIndex) {
+	uint32_t index = m_freeHead;
+	if (index != ENTITY_HANDLE_NONE) {
+		m_freeHead = m_slots[index].entityIndex;
+	}
+	else {
+		index = (uint32_t)m_slots.size();
+		m_slots.push_back(Slot{ 0, ENTITY_HANDLE_NONE });
+	}
+
+	// ZORA: Even to odd, so the slot is live again under a generation none of its old handles have
+	Slot& slot = m_slots[index];
+	slot.generation++;
+	slot.entityIndex = entityIndex;
+
+	if (entityIndex >= m_slotsByEntity.size())
+		m_slotsByEntity.resize((size_t)entityIndex + 1, ENTITY_HANDLE_NONE);
+	m_slotsByEntity[entityIndex] = index;
+
+	m_changes.push_back(index);
+	return EntityHandle{ index, slot.generation };
+}
+
+bool EntityHandleTable::Despawn(EntityHandle handle) {
+	uint32_t entityIndex = 0;
+	if (!Resolve(handle, entityIndex))
+		return false;
+
+	if (m_slotsByEntity[entityIndex] == handle.index)
+		m_slotsByEntity[entityIndex] = ENTITY_HANDLE_NONE;
+
+	// ZORA: Odd to even. A slot's generation only wraps round to match an old handle again after two billion despawns of that one slot.
+	Slot& slot = m_slots[handle.index];
+	slot.generation++;
+	slot.entityIndex = m_freeHead;
+	m_freeHead = handle.index;
+
+	m_changes.push_back(handle.index);
+	return true;
+}
+
+void EntityHandleTable::Move(EntityHandle handle, uint32_t entityIndex) {
+	uint32_t oldIndex = 0;
+	if (!Resolve(handle, oldIndex) || oldIndex == entityIndex)
+		return;
+
+	if (m_slotsByEntity[oldIndex] == handle.index)
+		m_slotsByEntity[oldIndex] = ENTITY_HANDLE_NONE;
+	if (entityIndex >= m_slotsByEntity.size())
+		m_slotsByEntity.resize((size_t)entityIndex + 1, ENTITY_HANDLE_NONE);
+	m_slotsByEntity[entityIndex] = handle.index;
+	m_slots[handle.index].entityIndex = entityIndex;
+
+	m_changes.push_back(handle.index);
+}
+
+bool EntityHandleTable::Resolve(EntityHandle handle, uint32_t& entityIndex) const {
+	if (handle.index >= m_slots.size() || (handle.generation & 1) == 0)
+		return false;
+
+	const Slot& slot = m_slots[handle.index];
+	if (slot.generation != handle.generation)
+		return false;
+
+	entityIndex = slot.entityIndex;
+	return true;
+}
+
+EntityHandle EntityHandleTable::GetHandle(uint32_t entityIndex) const {
+	if (entityIndex >= m_slotsByEntity.size() || m_slotsByEntity[entityIndex] == ENTITY_HANDLE_NONE)
+		return EntityHandle{ 0, 0 };
+
+	uint32_t index = m_slotsByEntity[entityIndex];
+	return EntityHandle{ index, m_slots[index].generation };
+}
+
+uint32_t EntityHandleTable::GetEntitySlot(uint32_t entityIndex) const {
+	return entityIndex < m_slotsByEntity.size() ? m_slotsByEntity[entityIndex] : ENTITY_HANDLE_NONE;
+}
+
+uint32_t EntityHandleTable::GetSlotCount() const {
+	return (uint32_t)m_slots.size();
+}
+
+uint64_t EntityHandleTable::GetPackedSlot(uint32_t index) const {
+	const Slot& slot = m_slots[index];
+	return PackEntityHandleSlot(slot.generation, (slot.generation & 1) ? slot.entityIndex : ENTITY_HANDLE_NONE);
+}
+
+const std::vector<uint32_t>& EntityHandleTable::GetChanges() const {
+	return m_changes;
+}
+
+void EntityHandleTable::ClearChanges() {
+	m_changes.clear();
+}
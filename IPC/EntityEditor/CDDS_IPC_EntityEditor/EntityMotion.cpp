@@ -0,0 +1,294 @@
+#include "EntityMotion.h"
+#include <cmath>
+#include <cstring>
+
+// ZORA: SSE2 is always there on x64, and on 32 bit x86 when the compiler has been told to use it
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ENTITY_MOTION_SSE2
+#include <emmintrin.h>
+#endif
+
+// ZORA: AVX2 is compiled into its own function wherever the compiler can do that without AVX2 being switched on for the whole build, and only run once the CPU has said it supports it
+#if defined(_M_X64)
+#define ENTITY_MOTION_AVX2
+#define ENTITY_MOTION_AVX2_TARGET
+#include <immintrin.h>
+#include <intrin.h>
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ENTITY_MOTION_AVX2
+#define ENTITY_MOTION_AVX2_TARGET __attribute__((target("avx2")))
+#include <immintrin.h>
+#endif
+
+// ZORA: Cephes' sinf and cosf. The angle is brought into [-pi/4, pi/4] by subtracting the nearest multiple of pi/4, in three parts so that hundreds of radians lose nothing, then one polynomial gives the sine and another the cosine.
+// Which of the two is the sine, and the sign of each, follow from the multiple of pi/4 that was taken off. That is all integer masking, so every lane can take a different path without a branch.
+static const float FOUR_OVER_PI = 1.27323954473516f;
+static const float PI_OVER_FOUR_1 = 0.78515625f;
+static const float PI_OVER_FOUR_2 = 2.4187564849853515625e-4f;
+static const float PI_OVER_FOUR_3 = 3.77489497744594108e-8f;
+static const float SIN_0 = -1.9515295891e-4f;
+static const float SIN_1 = 8.3321608736e-3f;
+static const float SIN_2 = -1.6666654611e-1f;
+static const float COS_0 = 2.443315711809948e-5f;
+static const float COS_1 = -1.388731625493765e-3f;
+static const float COS_2 = 4.166664568298827e-2f;
+
+static inline void SinCos(float angle, float& sine, float& cosine) {
+	float magnitude = fabsf(angle);
+	int32_t octant = ((int32_t)(magnitude * FOUR_OVER_PI) + 1) & ~1;
+	float nearest = (float)octant;
+	float x = ((magnitude - nearest * PI_OVER_FOUR_1) - nearest * PI_OVER_FOUR_2) - nearest * PI_OVER_FOUR_3;
+	float z = x * x;
+
+	float cosPoly = ((COS_0 * z + COS_1) * z + COS_2) * z * z - 0.5f * z + 1.0f;
+	float sinPoly = ((SIN_0 * z + SIN_1) * z + SIN_2) * z * x + x;
+
+	bool swap = (octant & 2) != 0;
+	sine = swap ? cosPoly : sinPoly;
+	cosine = swap ? sinPoly : cosPoly;
+	if ((angle < 0) != ((octant & 4) != 0))
+		sine = -sine;
+	if (((octant - 2) & 4) == 0)
+		cosine = -cosine;
+}
+
+// ZORA: 'value' wrapped into [0, 'size'). The floor can be one out when 'value' is within a rounding error of a multiple of 'size', so the result is nudged back into range afterwards.
+static inline float Wrap(float value, float size, float inverseSize) {
+	float wrapped = value - floorf(value * inverseSize) * size;
+	wrapped = wrapped >= size ? wrapped - size : wrapped;
+	return wrapped < 0 ? wrapped + size : wrapped;
+}
+
+static void MoveScalar(const EntityColumns& columns, uint32_t begin, uint32_t end, float deltaTime, float width, float height, uint8_t* dirty) {
+	float inverseWidth = 1.0f / width;
+	float inverseHeight = 1.0f / height;
+
+	for (uint32_t i = begin; i < end; i++) {
+		// ZORA: A stationary entity hasn't changed, so it doesn't need to be shared again
+		if (columns.speed[i] == 0)
+			continue;
+		dirty[i] = 1;
+
+		float sine, cosine;
+		SinCos(columns.rotation[i], sine, cosine);
+		float s = sine * columns.speed[i];
+		float c = cosine * columns.speed[i];
+		columns.x[i] = Wrap(columns.x[i] - s * deltaTime, width, inverseWidth);
+		columns.y[i] = Wrap(columns.y[i] + c * deltaTime, height, inverseHeight);
+	}
+}
+
+#ifdef ENTITY_MOTION_SSE2
+// ZORA: SinCos four lanes at a time
+static inline void SinCos4(__m128 angle, __m128& sine, __m128& cosine) {
+	const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000));
+	const __m128i one = _mm_set1_epi32(1);
+	const __m128i two = _mm_set1_epi32(2);
+	const __m128i four = _mm_set1_epi32(4);
+
+	__m128 angleSign = _mm_and_ps(angle, signMask);
+	__m128 magnitude = _mm_andnot_ps(signMask, angle);
+	__m128i octant = _mm_cvttps_epi32(_mm_mul_ps(magnitude, _mm_set1_ps(FOUR_OVER_PI)));
+	octant = _mm_andnot_si128(one, _mm_add_epi32(octant, one));
+	__m128 nearest = _mm_cvtepi32_ps(octant);
+
+	__m128 x = _mm_sub_ps(magnitude, _mm_mul_ps(nearest, _mm_set1_ps(PI_OVER_FOUR_1)));
+	x = _mm_sub_ps(x, _mm_mul_ps(nearest, _mm_set1_ps(PI_OVER_FOUR_2)));
+	x = _mm_sub_ps(x, _mm_mul_ps(nearest, _mm_set1_ps(PI_OVER_FOUR_3)));
+	__m128 z = _mm_mul_ps(x, x);
+
+	__m128 cosPoly = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(COS_0), z), _mm_set1_ps(COS_1));
+	cosPoly = _mm_add_ps(_mm_mul_ps(cosPoly, z), _mm_set1_ps(COS_2));
+	cosPoly = _mm_mul_ps(_mm_mul_ps(cosPoly, z), z);
+	cosPoly = _mm_add_ps(_mm_sub_ps(cosPoly, _mm_mul_ps(_mm_set1_ps(0.5f), z)), _mm_set1_ps(1.0f));
+
+	__m128 sinPoly = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(SIN_0), z), _mm_set1_ps(SIN_1));
+	sinPoly = _mm_add_ps(_mm_mul_ps(sinPoly, z), _mm_set1_ps(SIN_2));
+	sinPoly = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(sinPoly, z), x), x);
+
+	__m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(octant, two), two));
+	__m128 sineSign = _mm_xor_ps(angleSign, _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(octant, four), 29)));
+	__m128 cosineSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_andnot_si128(_mm_sub_epi32(octant, two), four), 29));
+
+	sine = _mm_or_ps(_mm_and_ps(swap, cosPoly), _mm_andnot_ps(swap, sinPoly));
+	cosine = _mm_or_ps(_mm_and_ps(swap, sinPoly), _mm_andnot_ps(swap, cosPoly));
+	sine = _mm_xor_ps(sine, sineSign);
+	cosine = _mm_xor_ps(cosine, cosineSign);
+}
+
+// ZORA: Wrap four lanes at a time. SSE2 has no floor, so truncate and step down one wherever that rounded up.
+static inline __m128 Wrap4(__m128 value, __m128 size, __m128 inverseSize) {
+	const __m128 zero = _mm_setzero_ps();
+	__m128 scaled = _mm_mul_ps(value, inverseSize);
+	__m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(scaled));
+	__m128 floored = _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, scaled), _mm_set1_ps(1.0f)));
+	__m128 wrapped = _mm_sub_ps(value, _mm_mul_ps(floored, size));
+	wrapped = _mm_sub_ps(wrapped, _mm_and_ps(_mm_cmpge_ps(wrapped, size), size));
+	return _mm_add_ps(wrapped, _mm_and_ps(_mm_cmplt_ps(wrapped, zero), size));
+}
+
+static uint32_t MoveSse2(const EntityColumns& columns, uint32_t begin, uint32_t end, float deltaTime, float width, float height, uint8_t* dirty) {
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 step = _mm_set1_ps(deltaTime);
+	const __m128 size[2] = { _mm_set1_ps(width), _mm_set1_ps(height) };
+	const __m128 inverseSize[2] = { _mm_set1_ps(1.0f / width), _mm_set1_ps(1.0f / height) };
+	const __m128i dirtyBit = _mm_set1_epi8(1);
+	uint32_t i = begin;
+
+	for (; i + 4 <= end; i += 4) {
+		__m128 speed = _mm_loadu_ps(columns.speed + i);
+		__m128 moving = _mm_cmpneq_ps(speed, zero);
+		__m128 sine, cosine;
+		SinCos4(_mm_loadu_ps(columns.rotation + i), sine, cosine);
+
+		// ZORA: Every lane is moved, then stationary lanes are given their old position back, so they are left exactly as they were
+		__m128 oldX = _mm_loadu_ps(columns.x + i);
+		__m128 oldY = _mm_loadu_ps(columns.y + i);
+		__m128 newX = Wrap4(_mm_sub_ps(oldX, _mm_mul_ps(_mm_mul_ps(sine, speed), step)), size[0], inverseSize[0]);
+		__m128 newY = Wrap4(_mm_add_ps(oldY, _mm_mul_ps(_mm_mul_ps(cosine, speed), step)), size[1], inverseSize[1]);
+		_mm_storeu_ps(columns.x + i, _mm_or_ps(_mm_and_ps(moving, newX), _mm_andnot_ps(moving, oldX)));
+		_mm_storeu_ps(columns.y + i, _mm_or_ps(_mm_and_ps(moving, newY), _mm_andnot_ps(moving, oldY)));
+
+		// ZORA: Narrow the lane mask to one byte per entity and OR it into the dirty flags, which may already be set for other reasons
+		__m128i bytes = _mm_packs_epi16(_mm_packs_epi32(_mm_castps_si128(moving), _mm_setzero_si128()), _mm_setzero_si128());
+		int32_t flags;
+		memcpy(&flags, dirty + i, sizeof(flags));
+		flags |= _mm_cvtsi128_si32(_mm_and_si128(bytes, dirtyBit));
+		memcpy(dirty + i, &flags, sizeof(flags));
+	}
+
+	return i;
+}
+#endif
+
+#ifdef ENTITY_MOTION_AVX2
+// ZORA: SinCos eight lanes at a time, step for step the same as SinCos4
+ENTITY_MOTION_AVX2_TARGET static inline void SinCos8(__m256 angle, __m256& sine, __m256& cosine) {
+	const __m256 signMask = _mm256_castsi256_ps(_mm256_set1_epi32((int)0x80000000));
+	const __m256i one = _mm256_set1_epi32(1);
+	const __m256i two = _mm256_set1_epi32(2);
+	const __m256i four = _mm256_set1_epi32(4);
+
+	__m256 angleSign = _mm256_and_ps(angle, signMask);
+	__m256 magnitude = _mm256_andnot_ps(signMask, angle);
+	__m256i octant = _mm256_cvttps_epi32(_mm256_mul_ps(magnitude, _mm256_set1_ps(FOUR_OVER_PI)));
+	octant = _mm256_andnot_si256(one, _mm256_add_epi32(octant, one));
+	__m256 nearest = _mm256_cvtepi32_ps(octant);
+
+	__m256 x = _mm256_sub_ps(magnitude, _mm256_mul_ps(nearest, _mm256_set1_ps(PI_OVER_FOUR_1)));
+	x = _mm256_sub_ps(x, _mm256_mul_ps(nearest, _mm256_set1_ps(PI_OVER_FOUR_2)));
+	x = _mm256_sub_ps(x, _mm256_mul_ps(nearest, _mm256_set1_ps(PI_OVER_FOUR_3)));
+	__m256 z = _mm256_mul_ps(x, x);
+
+	__m256 cosPoly = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(COS_0), z), _mm256_set1_ps(COS_1));
+	cosPoly = _mm256_add_ps(_mm256_mul_ps(cosPoly, z), _mm256_set1_ps(COS_2));
+	cosPoly = _mm256_mul_ps(_mm256_mul_ps(cosPoly, z), z);
+	cosPoly = _mm256_add_ps(_mm256_sub_ps(cosPoly, _mm256_mul_ps(_mm256_set1_ps(0.5f), z)), _mm256_set1_ps(1.0f));
+
+	__m256 sinPoly = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(SIN_0), z), _mm256_set1_ps(SIN_1));
+	sinPoly = _mm256_add_ps(_mm256_mul_ps(sinPoly, z), _mm256_set1_ps(SIN_2));
+	sinPoly = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(sinPoly, z), x), x);
+
+	__m256 swap = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(octant, two), two));
+	__m256 sineSign = _mm256_xor_ps(angleSign, _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(octant, four), 29)));
+	__m256 cosineSign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_andnot_si256(_mm256_sub_epi32(octant, two), four), 29));
+
+	sine = _mm256_xor_ps(_mm256_blendv_ps(sinPoly, cosPoly, swap), sineSign);
+	cosine = _mm256_xor_ps(_mm256_blendv_ps(cosPoly, sinPoly, swap), cosineSign);
+}
+
+ENTITY_MOTION_AVX2_TARGET static inline __m256 Wrap8(__m256 value, __m256 size, __m256 inverseSize) {
+	__m256 wrapped = _mm256_sub_ps(value, _mm256_mul_ps(_mm256_floor_ps(_mm256_mul_ps(value, inverseSize)), size));
+	wrapped = _mm256_sub_ps(wrapped, _mm256_and_ps(_mm256_cmp_ps(wrapped, size, _CMP_GE_OQ), size));
+	return _mm256_add_ps(wrapped, _mm256_and_ps(_mm256_cmp_ps(wrapped, _mm256_setzero_ps(), _CMP_LT_OQ), size));
+}
+
+// ZORA: Eight entities from 'index' onwards
+ENTITY_MOTION_AVX2_TARGET static inline void Move8(const EntityColumns& columns, uint32_t index, __m256 step, __m256 width, __m256 inverseWidth, __m256 height, __m256 inverseHeight, uint8_t* dirty) {
+	__m256 speed = _mm256_loadu_ps(columns.speed + index);
+	__m256 moving = _mm256_cmp_ps(speed, _mm256_setzero_ps(), _CMP_NEQ_UQ);
+	__m256 sine, cosine;
+	SinCos8(_mm256_loadu_ps(columns.rotation + index), sine, cosine);
+
+	__m256 oldX = _mm256_loadu_ps(columns.x + index);
+	__m256 oldY = _mm256_loadu_ps(columns.y + index);
+	__m256 newX = Wrap8(_mm256_sub_ps(oldX, _mm256_mul_ps(_mm256_mul_ps(sine, speed), step)), width, inverseWidth);
+	__m256 newY = Wrap8(_mm256_add_ps(oldY, _mm256_mul_ps(_mm256_mul_ps(cosine, speed), step)), height, inverseHeight);
+	_mm256_storeu_ps(columns.x + index, _mm256_blendv_ps(oldX, newX, moving));
+	_mm256_storeu_ps(columns.y + index, _mm256_blendv_ps(oldY, newY, moving));
+
+	// ZORA: The packs work within each 128 bit half, so the halves are narrowed together in SSE registers
+	__m256i mask = _mm256_castps_si256(moving);
+	__m128i words = _mm_packs_epi32(_mm256_castsi256_si128(mask), _mm256_extracti128_si256(mask, 1));
+	__m128i bytes = _mm_and_si128(_mm_packs_epi16(words, _mm_setzero_si128()), _mm_set1_epi8(1));
+	_mm_storel_epi64((__m128i*)(dirty + index), _mm_or_si128(_mm_loadl_epi64((const __m128i*)(dirty + index)), bytes));
+}
+
+// ZORA: Sixteen entities a pass, two independent registers of eight, so one's polynomial can run while the other's is waiting on a multiply
+ENTITY_MOTION_AVX2_TARGET static uint32_t MoveAvx2(const EntityColumns& columns, uint32_t begin, uint32_t end, float deltaTime, float width, float height, uint8_t* dirty) {
+	const __m256 step = _mm256_set1_ps(deltaTime);
+	const __m256 widthVector = _mm256_set1_ps(width);
+	const __m256 inverseWidth = _mm256_set1_ps(1.0f / width);
+	const __m256 heightVector = _mm256_set1_ps(height);
+	const __m256 inverseHeight = _mm256_set1_ps(1.0f / height);
+	uint32_t i = begin;
+
+	for (; i + 16 <= end; i += 16) {
+		Move8(columns, i, step, widthVector, inverseWidth, heightVector, inverseHeight, dirty);
+		Move8(columns, i + 8, step, widthVector, inverseWidth, heightVector, inverseHeight, dirty);
+	}
+	for (; i + 8 <= end; i += 8)
+		Move8(columns, i, step, widthVector, inverseWidth, heightVector, inverseHeight, dirty);
+
+	return i;
+}
+
+// ZORA: AVX2 needs the CPU to have it and the operating system to save the wider registers on a context switch
+static bool HasAvx2() {
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+		return false;
+	__cpuid(info, 1);
+	bool osSavesAvx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+	__cpuidex(info, 7, 0);
+	return osSavesAvx && (info[1] & (1 << 5)) != 0;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+#endif
+
+EntityMotionKernel GetBestMotionKernel() {
+#ifdef ENTITY_MOTION_AVX2
+	static const bool avx2 = HasAvx2();
+	if (avx2)
+		return ENTITY_MOTION_KERNEL_AVX2;
+#endif
+#ifdef ENTITY_MOTION_SSE2
+	return ENTITY_MOTION_KERNEL_SSE2;
+#else
+	return ENTITY_MOTION_KERNEL_SCALAR;
+#endif
+}
+
+void MoveEntities(const EntityColumns& columns, uint32_t first, uint32_t count, float deltaTime, float width, float height, uint8_t* dirty, EntityMotionKernel kernel) {
+	if (kernel == ENTITY_MOTION_KERNEL_BEST)
+		kernel = GetBestMotionKernel();
+
+	uint32_t end = first + count;
+	uint32_t i = first;
+
+	// ZORA: A kernel the build or the CPU doesn't have falls through to the next narrower one. Whatever is left over at the end goes through the scalar kernel.
+#ifdef ENTITY_MOTION_AVX2
+	if (kernel == ENTITY_MOTION_KERNEL_AVX2 && GetBestMotionKernel() == ENTITY_MOTION_KERNEL_AVX2)
+		i = MoveAvx2(columns, i, end, deltaTime, width, height, dirty);
+#endif
+#ifdef ENTITY_MOTION_SSE2
+	if (kernel != ENTITY_MOTION_KERNEL_SCALAR)
+		i = MoveSse2(columns, i, end, deltaTime, width, height, dirty);
+#endif
+	MoveScalar(columns, i, end, deltaTime, width, height, dirty);
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "EntityColumns.h"
+
+// ZORA: The ways MoveEntities can do its work. Every kernel uses the same polynomial and the same wraparound, so they agree with each other to the last bit or two whichever the CPU runs.
+enum EntityMotionKernel {
+	ENTITY_MOTION_KERNEL_BEST = 0,		// ZORA: The widest kernel this CPU supports
+	ENTITY_MOTION_KERNEL_SCALAR = 1,	// ZORA: One entity at a time, for CPUs without SSE2 and for checking the others against
+	ENTITY_MOTION_KERNEL_SSE2 = 2,		// ZORA: Four entities per instruction
+	ENTITY_MOTION_KERNEL_AVX2 = 3		// ZORA: Eight entities per instruction, two registers of them per pass
+};
+
+// ZORA: Move 'count' entities of 'columns', starting at 'first', 'deltaTime' seconds along their rotation at their speed, and wrap them around a 'width' by 'height' screen.
+// Every entity that moved is marked in 'dirty', which is indexed like the columns; stationary ones are left exactly as they were. Only the x, y, rotation and speed columns are touched.
+// Rotation is taken in radians, as sinf and cosf always took it here, and is good to a few ulps for any rotation the GUI can set.
+void MoveEntities(const EntityColumns& columns, uint32_t first, uint32_t count, float deltaTime, float width, float height, uint8_t* dirty, EntityMotionKernel kernel = ENTITY_MOTION_KERNEL_BEST);
+
+// ZORA: The kernel ENTITY_MOTION_KERNEL_BEST picks on this CPU
+EntityMotionKernel GetBestMotionKernel();
@@ -0,0 +1,436 @@
+#include "EntityRecording.h"
+#include "Platform.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#ifndef NDEBUG
+#include <iostream>
+#endif
+
+// ZORA: The space a chunk takes in the file, padding included
+static uint64_t GetChunkSpan(uint32_t bytes) {
+	return sizeof(EntityRecordingChunk) + (((uint64_t)bytes + 7) & ~(uint64_t)7);
+}
+
+EntityRecorder::EntityRecorder() : m_deflate(false), m_frameCount(0), m_endOffset(0), m_startMs(0), m_errorCode(0) {
+
+}
+
+EntityRecorder::~EntityRecorder() {
+	Close();
+}
+
+bool EntityRecorder::Create(const char* path) {
+	Close();
+
+	if (!m_file.Create(path, ENTITY_RECORDING_GROWTH)) {
+		m_errorCode = m_file.GetErrorCode();
+		return false;
+	}
+
+	// ZORA: Start from an empty history, so nothing from an earlier recording is encoded against
+	m_encoder = EntityEncoder();
+	m_encoder.SetKeyframeInterval(ENTITY_RECORDING_KEYFRAME_INTERVAL);
+	m_encoder.SetDeflate(m_deflate);
+
+	m_keyframes.clear();
+	m_frameCount = 0;
+	m_endOffset = sizeof(EntityRecordingHeader);
+	m_startMs = GetMonotonicMilliseconds();
+
+	EntityRecordingHeader* header = GetHeader();
+	header->magic = ENTITY_RECORDING_MAGIC;
+	header->version = ENTITY_RECORDING_VERSION;
+	header->entitySize = sizeof(Entity);
+	header->maxCount = 0;
+	header->frameCount = m_frameCount;
+	header->endOffset = m_endOffset;
+	header->indexOffset = 0;
+	header->indexCount = 0;
+	return true;
+}
+
+void EntityRecorder::Close() {
+	if (!m_file.IsOpen())
+		return;
+
+	WriteIndex();
+	m_file.Close();
+#ifndef NDEBUG
+	std::cout << "Recorded " << m_frameCount << " frames in " << m_endOffset << " bytes" << std::endl;
+#endif
+}
+
+bool EntityRecorder::IsOpen() const {
+	return m_file.IsOpen();
+}
+
+void EntityRecorder::SetDeflate(bool deflate) {
+	m_deflate = deflate;
+	m_encoder.SetDeflate(deflate);
+}
+
+uint64_t EntityRecorder::GetFrameCount() const {
+	return m_frameCount;
+}
+
+int EntityRecorder::GetErrorCode() const {
+	return m_errorCode;
+}
+
+EntityRecordingHeader* EntityRecorder::GetHeader() const {
+	return (EntityRecordingHeader*)m_file.GetView();
+}
+
+bool EntityRecorder::WriteIndex() {
+	// ZORA: Cut the file down to the chunks and the index, dropping the room it grew into but never used
+	uint64_t indexBytes = m_keyframes.size() * sizeof(EntityRecordingKeyframe);
+	if (!m_file.Resize((size_t)(m_endOffset + indexBytes))) {
+		m_errorCode = m_file.GetErrorCode();
+		return false;
+	}
+
+	char* view = (char*)m_file.GetView();
+	if (indexBytes > 0)
+		memcpy(view + m_endOffset, m_keyframes.data(), (size_t)indexBytes);
+
+	// ZORA: The offset goes last, so a reader never sees an offset without the count to go with it
+	EntityRecordingHeader* header = GetHeader();
+	header->indexCount = m_keyframes.size();
+	header->indexOffset = m_endOffset;
+	return true;
+}
+
+void EntityRecorder::MarkDirty(uint32_t) {
+
+}
+
+void EntityRecorder::MarkAllDirty() {
+
+}
+
+uint32_t EntityRecorder::GetRangeCapacity() const {
+	return ENTITY_CODEC_MAX_COUNT;
+}
+
+// ZORA: A recording has no fixed size to grow
+bool EntityRecorder::Resize(uint32_t capacity) {
+	return capacity <= ENTITY_CODEC_MAX_COUNT;
+}
+
+void EntityRecorder::Publish(const Entity* entities, uint32_t count) {
+	if (!m_file.IsOpen())
+		return;
+
+	// ZORA: Generations count from 1. Every frame is encoded against the newest keyframe rather than the frame before it, so any frame decodes from its keyframe and itself, without the frames in between.
+	count = std::min(count, ENTITY_CODEC_MAX_COUNT);
+	m_encoder.AddFrame(entities, count, m_frameCount + 1);
+	bool keyframe = m_encoder.EncodeFrame(m_encoder.GetKeyframeGeneration(), m_encoded);
+
+	uint64_t span = GetChunkSpan((uint32_t)m_encoded.size());
+	if (m_endOffset + span > m_file.GetSize()) {
+		size_t size = (size_t)std::max<uint64_t>(m_endOffset + span, m_file.GetSize() + ENTITY_RECORDING_GROWTH);
+		if (!m_file.Resize(size)) {
+			// ZORA: The frames already written stay in the file, and the header still describes them
+			m_errorCode = m_file.GetErrorCode();
+#ifndef NDEBUG
+			std::cout << "Could not grow the recording, stopping after " << m_frameCount << " frames: " << m_errorCode << std::endl;
+#endif
+			return;
+		}
+	}
+
+	EntityRecordingChunk chunk;
+	chunk.magic = ENTITY_RECORDING_CHUNK_MAGIC;
+	chunk.flags = keyframe ? (uint32_t)ENTITY_RECORDING_KEYFRAME : 0;
+	chunk.frame = m_frameCount;
+	chunk.timeMs = GetMonotonicMilliseconds() - m_startMs;
+	chunk.bytes = (uint32_t)m_encoded.size();
+	chunk.reserved = 0;
+
+	// ZORA: The padding is already zero, since the file grows with zeros and is never written twice
+	char* view = (char*)m_file.GetView();
+	memcpy(view + m_endOffset, &chunk, sizeof(chunk));
+	memcpy(view + m_endOffset + sizeof(chunk), m_encoded.data(), m_encoded.size());
+	if (keyframe)
+		m_keyframes.push_back(EntityRecordingKeyframe{ m_frameCount, m_endOffset });
+	m_endOffset += span;
+	m_frameCount++;
+
+	// ZORA: Only count the frame once it is all there
+	EntityRecordingHeader* header = GetHeader();
+	header->maxCount = std::max(header->maxCount, count);
+	header->frameCount = m_frameCount;
+	header->endOffset = m_endOffset;
+}
+
+EntityReplay::EntityReplay() : m_frameCount(0), m_endOffset(0), m_firstTimeMs(0), m_capacity(0), m_realTime(true), m_loop(false), m_next(0), m_nextOffset(0), m_target(0), m_seeking(false), m_startMs(0), m_generation(0), m_errorCode(0) {
+
+}
+
+EntityReplay::~EntityReplay() {
+	Close();
+}
+
+bool EntityReplay::Open(const char* path) {
+	Close();
+
+	if (!m_file.Open(path)) {
+		m_errorCode = m_file.GetErrorCode();
+		return false;
+	}
+
+	EntityRecordingHeader header;
+	if (m_file.GetSize() < sizeof(header)) {
+		m_errorCode = -1;
+		Close();
+		return false;
+	}
+	memcpy(&header, m_file.GetView(), sizeof(header));
+
+	if (header.magic != ENTITY_RECORDING_MAGIC || header.version != ENTITY_RECORDING_VERSION || header.entitySize != sizeof(Entity) || header.endOffset < sizeof(header)) {
+#ifndef NDEBUG
+		std::cout << "Not a recording this build can play: " << path << std::endl;
+#endif
+		m_errorCode = -1;
+		Close();
+		return false;
+	}
+
+	// ZORA: A file cut short ends the recording where it was cut
+	m_endOffset = std::min<uint64_t>(header.endOffset, m_file.GetSize());
+
+	if (!ReadIndex(header) && !WalkChunks(header)) {
+#ifndef NDEBUG
+		std::cout << "Recording has no frames: " << path << std::endl;
+#endif
+		m_errorCode = -1;
+		Close();
+		return false;
+	}
+
+	m_firstTimeMs = GetChunk(sizeof(header), 0)->timeMs;
+	m_generation = 0;
+	Rewind();
+	return true;
+}
+
+bool EntityReplay::ReadIndex(const EntityRecordingHeader& header) {
+	if (header.indexOffset < header.endOffset || header.indexOffset > m_file.GetSize() || header.indexCount == 0 ||
+		header.indexCount > (m_file.GetSize() - header.indexOffset) / sizeof(EntityRecordingKeyframe) || header.frameCount == 0)
+		return false;
+
+	const EntityRecordingKeyframe* index = (const EntityRecordingKeyframe*)((const char*)m_file.GetView() + header.indexOffset);
+	m_keyframes.assign(index, index + header.indexCount);
+
+	// ZORA: Only the first keyframe's chunk is checked now, since checking them all would read a page per keyframe. The rest are checked as they are seeked to.
+	bool ordered = m_keyframes[0].frame == 0 && m_keyframes[0].offset == sizeof(header);
+	for (size_t i = 1; i < m_keyframes.size() && ordered; i++)
+		ordered = m_keyframes[i].frame > m_keyframes[i - 1].frame && m_keyframes[i].offset > m_keyframes[i - 1].offset && m_keyframes[i].frame < header.frameCount;
+
+	if (!ordered || GetChunk(sizeof(header), 0) == nullptr) {
+#ifndef NDEBUG
+		std::cout << "Recording's keyframe index is damaged, walking its chunks instead" << std::endl;
+#endif
+		m_keyframes.clear();
+		return false;
+	}
+
+	m_frameCount = header.frameCount;
+	m_capacity = std::min(header.maxCount, ENTITY_CODEC_MAX_COUNT);
+	return true;
+}
+
+// ZORA: Build the keyframe index by reading every chunk. A chunk that doesn't check out ends the recording there.
+bool EntityReplay::WalkChunks(const EntityRecordingHeader& header) {
+	const char* view = (const char*)m_file.GetView();
+	uint64_t offset = sizeof(header);
+	uint64_t frame = 0;
+	for (; frame < header.frameCount; frame++) {
+		const EntityRecordingChunk* chunk = GetChunk(offset, frame);
+		if (chunk == nullptr)
+			break;
+
+		EntityCodecHeader codec;
+		memcpy(&codec, view + offset + sizeof(EntityRecordingChunk), sizeof(codec));
+		if (chunk->flags & ENTITY_RECORDING_KEYFRAME)
+			m_keyframes.push_back(EntityRecordingKeyframe{ frame, offset });
+		m_capacity = std::max(m_capacity, std::min(codec.count, ENTITY_CODEC_MAX_COUNT));
+		offset += GetChunkSpan(chunk->bytes);
+	}
+
+#ifndef NDEBUG
+	if (frame < header.frameCount)
+		std::cout << "Recording is damaged after frame " << frame << " of " << header.frameCount << std::endl;
+#endif
+
+	m_frameCount = frame;
+	return !m_keyframes.empty() && m_keyframes[0].frame == 0;
+}
+
+void EntityReplay::Close() {
+	m_file.Close();
+	m_keyframes.clear();
+	m_frameCount = 0;
+	m_endOffset = 0;
+	m_capacity = 0;
+	m_next = 0;
+	m_nextOffset = 0;
+	m_target = 0;
+	m_seeking = false;
+}
+
+bool EntityReplay::IsOpen() const {
+	return m_file.IsOpen();
+}
+
+void EntityReplay::SetRealTime(bool realTime) {
+	m_realTime = realTime;
+}
+
+void EntityReplay::SetLoop(bool loop) {
+	m_loop = loop;
+}
+
+uint64_t EntityReplay::GetFrameCount() const {
+	return m_frameCount;
+}
+
+uint64_t EntityReplay::GetFrame() const {
+	return m_next > 0 ? m_next - 1 : 0;
+}
+
+bool EntityReplay::IsFinished() const {
+	return m_next >= m_frameCount && !m_loop && !m_seeking;
+}
+
+int EntityReplay::GetErrorCode() const {
+	return m_errorCode;
+}
+
+const EntityRecordingChunk* EntityReplay::GetChunk(uint64_t offset, uint64_t frame) const {
+	if (offset > m_endOffset || m_endOffset - offset < sizeof(EntityRecordingChunk) + sizeof(EntityCodecHeader))
+		return nullptr;
+
+	const EntityRecordingChunk* chunk = (const EntityRecordingChunk*)((const char*)m_file.GetView() + offset);
+	if (chunk->magic != ENTITY_RECORDING_CHUNK_MAGIC || chunk->frame != frame || chunk->bytes < sizeof(EntityCodecHeader) || GetChunkSpan(chunk->bytes) > m_endOffset - offset)
+		return nullptr;
+	return chunk;
+}
+
+uint64_t EntityReplay::GetDueMs(const EntityRecordingChunk* chunk) const {
+	return m_startMs + (chunk->timeMs - m_firstTimeMs);
+}
+
+uint64_t EntityReplay::GetNextDueMs() const {
+	const EntityRecordingChunk* chunk = GetChunk(m_nextOffset, m_next);
+	return chunk != nullptr ? GetDueMs(chunk) : m_startMs;
+}
+
+void EntityReplay::Rewind() {
+	m_next = 0;
+	m_nextOffset = sizeof(EntityRecordingHeader);
+	m_target = 0;
+	m_seeking = false;
+	m_decoder.Reset();
+	m_startMs = GetMonotonicMilliseconds();
+}
+
+bool EntityReplay::Seek(uint64_t frame, bool exact) {
+	if (m_keyframes.empty())
+		return false;
+	frame = std::min(frame, m_frameCount - 1);
+
+	// ZORA: The last keyframe at or before the frame
+	auto keyframe = std::upper_bound(m_keyframes.begin(), m_keyframes.end(), frame, [](uint64_t f, const EntityRecordingKeyframe& k) { return f < k.frame; }) - 1;
+
+	m_next = keyframe->frame;
+	m_nextOffset = keyframe->offset;
+	m_target = exact ? frame : keyframe->frame;
+	m_seeking = true;
+	return true;
+}
+
+bool EntityReplay::ReadSnapshot(std::vector<Entity>& entities) {
+	if (m_frameCount == 0)
+		return false;
+	if (m_next >= m_frameCount && !m_seeking) {
+		if (!m_loop)
+			return false;
+		Rewind();
+	}
+
+	// ZORA: Find the frame to show: the next one, or the one a seek asked for, or at real speed the newest that is due. Only the chunk headers on the way are read.
+	uint64_t now = GetMonotonicMilliseconds();
+	const EntityRecordingChunk* target = nullptr;
+	const EntityRecordingChunk* keyframe = nullptr;
+	do {
+		const EntityRecordingChunk* chunk = GetChunk(m_nextOffset, m_next);
+		if (chunk == nullptr) {
+#ifndef NDEBUG
+			std::cout << "Recording is damaged at frame " << m_next << ", ending it there" << std::endl;
+#endif
+			m_frameCount = m_next;
+			break;
+		}
+
+		target = chunk;
+		if (chunk->flags & ENTITY_RECORDING_KEYFRAME)
+			keyframe = chunk;
+		m_nextOffset += GetChunkSpan(chunk->bytes);
+		m_next++;
+	} while (m_next < m_frameCount && (m_next <= m_target || (m_realTime && !m_seeking && GetNextDueMs() <= now)));
+
+	if (target == nullptr) {
+		m_seeking = false;
+		return false;
+	}
+
+	// ZORA: Every frame is encoded against its keyframe, so the frames skipped on the way don't need decoding. Only a keyframe passed on the way, which the decoder won't have yet, is decoded first.
+	bool decoded = true;
+	if (keyframe != nullptr && keyframe != target)
+		decoded = m_decoder.Decode((const uint8_t*)(keyframe + 1), keyframe->bytes, entities);
+	decoded = decoded && m_decoder.Decode((const uint8_t*)(target + 1), target->bytes, entities);
+
+	// ZORA: Carry on at real speed from wherever a seek landed
+	if (m_seeking) {
+		m_startMs = now - (target->timeMs - m_firstTimeMs);
+		m_seeking = false;
+	}
+
+	// ZORA: A frame that doesn't decode is skipped. With a damaged keyframe, the frames after it fail too until the next keyframe, which is at most ENTITY_RECORDING_KEYFRAME_INTERVAL frames on.
+	if (!decoded)
+		return false;
+	m_generation++;
+	return true;
+}
+
+bool EntityReplay::WaitForFrame(uint64_t, int timeoutMs) {
+	if (m_seeking)
+		return true;
+
+	if (m_frameCount == 0 || IsFinished()) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMs));
+		return false;
+	}
+
+	// ZORA: The next frame of a loop is due as soon as it starts again
+	if (!m_realTime || m_next >= m_frameCount)
+		return true;
+
+	uint64_t due = GetNextDueMs();
+	uint64_t now = GetMonotonicMilliseconds();
+	if (due > now)
+		std::this_thread::sleep_for(std::chrono::milliseconds(std::min<uint64_t>(due - now, (uint64_t)timeoutMs)));
+	return GetNextDueMs() <= GetMonotonicMilliseconds();
+}
+
+uint64_t EntityReplay::GetSnapshotGeneration() const {
+	return m_generation;
+}
+
+uint32_t EntityReplay::GetCapacity() const {
+	return m_capacity;
+}
@@ -0,0 +1,175 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Entity.h"
+#include "EntityCodec.h"
+#include "EntityTransport.h"
+#include "MappedFile.h"
+
+// ZORA: Written at the front of every recording, and of every chunk in it
+const uint32_t ENTITY_RECORDING_MAGIC = 0x43455245;	// 'EREC'
+const uint32_t ENTITY_RECORDING_CHUNK_MAGIC = 0x4B484345;	// 'ECHK'
+
+// ZORA: Bumped whenever the layout of a recording changes, so an old file is refused rather than misread
+const uint32_t ENTITY_RECORDING_VERSION = 2;
+
+// ZORA: Every frame is a delta against the newest keyframe, with a keyframe this often so deltas stay small and a damaged keyframe only loses a second or so of the recording
+const uint32_t ENTITY_RECORDING_KEYFRAME_INTERVAL = 60;
+
+// ZORA: How much the file grows by each time it fills, so growing it is rare. Whatever isn't used is cut off again when the recording is closed.
+const size_t ENTITY_RECORDING_GROWTH = 64 * 1024 * 1024;
+
+enum EntityRecordingChunkFlags : uint32_t {
+	ENTITY_RECORDING_KEYFRAME = 1	// ZORA: The frame decodes on its own
+};
+
+// ZORA: The front of a recording. It is rewritten after every frame, so a recording cut short by a crash still replays up to the last whole frame.
+struct EntityRecordingHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t entitySize;		// ZORA: sizeof(Entity) in the Editor that recorded it
+	uint32_t maxCount;			// ZORA: The most entities in any one frame
+	uint64_t frameCount;		// ZORA: The number of whole frames in the recording
+	uint64_t endOffset;			// ZORA: Where the last whole chunk ends
+	uint64_t indexOffset;		// ZORA: Where the keyframe index starts, 0 until the recording is closed
+	uint64_t indexCount;		// ZORA: The number of entries in the keyframe index
+};
+
+// ZORA: One entry of the keyframe index, which follows the last chunk as a footer and has an entry for every keyframe in frame order. A reader finds the keyframe to start any frame from with a binary search of it, rather than by walking the chunks.
+struct EntityRecordingKeyframe {
+	uint64_t frame;
+	uint64_t offset;			// ZORA: Where the keyframe's chunk starts
+};
+
+// ZORA: The front of every chunk, each of which holds one frame as encoded by EntityEncoder. Chunks follow each other from the end of the header, each padded to 8 bytes so the next header can be read in place.
+struct EntityRecordingChunk {
+	uint32_t magic;
+	uint32_t flags;
+	uint64_t frame;				// ZORA: The frame's place in the recording, counting from 0
+	uint64_t timeMs;			// ZORA: When the frame was published, in milliseconds since the recording started
+	uint32_t bytes;				// ZORA: The size of the encoded frame following the chunk header, before padding
+	uint32_t reserved;
+};
+
+// ZORA: Appends every published frame to a recording file through a memory-mapped view, so recording costs an encode and a copy into the page cache per frame and never waits on the disk.
+class EntityRecorder : public EntityPublisher {
+public:
+	EntityRecorder();
+	~EntityRecorder();
+
+	// ZORA: Start a new recording at 'path', replacing any file already there. Returns false if the file could not be created.
+	bool Create(const char* path);
+
+	// ZORA: Finish the recording, cutting the file down to what was written
+	void Close();
+
+	bool IsOpen() const;
+
+	// ZORA: DEFLATE each frame as well as delta encoding it. Smaller files, for a lot more time per frame.
+	void SetDeflate(bool deflate);
+
+	uint64_t GetFrameCount() const;
+
+	// ZORA: The platform error code from the most recent failed call, for debug printouts
+	int GetErrorCode() const;
+
+	// ZORA: Every frame is recorded whole, so which entities changed doesn't matter
+	void MarkDirty(uint32_t index) override;
+	void MarkAllDirty() override;
+	void Publish(const Entity* entities, uint32_t count) override;
+	uint32_t GetRangeCapacity() const override;
+	bool Resize(uint32_t capacity) override;
+
+private:
+	EntityRecorder(const EntityRecorder&) = delete;
+	EntityRecorder& operator=(const EntityRecorder&) = delete;
+
+	EntityRecordingHeader* GetHeader() const;
+
+	// ZORA: Write the keyframe index after the last chunk and point the header at it
+	bool WriteIndex();
+
+	MappedFile m_file;
+	bool m_deflate;
+	EntityEncoder m_encoder;
+	std::vector<uint8_t> m_encoded;
+	std::vector<EntityRecordingKeyframe> m_keyframes;
+	uint64_t m_frameCount;
+	uint64_t m_endOffset;
+	uint64_t m_startMs;
+	int m_errorCode;
+};
+
+// ZORA: Plays a recording back as if it were a live Editor, through the same interface the Display reads the segment with.
+// The recording is mapped read-only, so playing it back only decodes. At real speed each frame is shown when its time comes, skipping ahead if the Display falls behind. At full speed every frame is shown, one per ReadSnapshot.
+// Opening reads only the header and the keyframe index, whatever the size of the recording. A recording without an index, because the Editor never closed it, is indexed by walking its chunks instead.
+class EntityReplay : public EntitySubscriber {
+public:
+	EntityReplay();
+	~EntityReplay();
+
+	// ZORA: Open the recording at 'path'. Returns false if it isn't a recording this build can play.
+	bool Open(const char* path);
+	void Close();
+	bool IsOpen() const;
+
+	// ZORA: Play back at the speed it was recorded, or as fast as the Display can draw. Real speed by default.
+	void SetRealTime(bool realTime);
+
+	// ZORA: Start again from the beginning after the last frame, rather than stopping on it
+	void SetLoop(bool loop);
+
+	uint64_t GetFrameCount() const;
+
+	// ZORA: The frame most recently returned by ReadSnapshot
+	uint64_t GetFrame() const;
+
+	// ZORA: Move to 'frame', which the next ReadSnapshot returns. The keyframe before it is found by a binary search of the index. Exact, that decodes the keyframe and then the frame. Otherwise it lands on the keyframe itself, which costs one decode and suits scrubbing. Real-speed playback carries on from there.
+	// Returns false if there is nothing to seek to.
+	bool Seek(uint64_t frame, bool exact);
+
+	// ZORA: True once the last frame has been read and the replay isn't looping
+	bool IsFinished() const;
+
+	int GetErrorCode() const;
+
+	bool ReadSnapshot(std::vector<Entity>& entities) override;
+	bool WaitForFrame(uint64_t generation, int timeoutMs) override;
+	uint64_t GetSnapshotGeneration() const override;
+	uint32_t GetCapacity() const override;
+
+private:
+	EntityReplay(const EntityReplay&) = delete;
+	EntityReplay& operator=(const EntityReplay&) = delete;
+
+	// ZORA: The chunk at 'offset' if it is frame 'frame' and fits in the recording, otherwise a nullptr
+	const EntityRecordingChunk* GetChunk(uint64_t offset, uint64_t frame) const;
+
+	bool ReadIndex(const EntityRecordingHeader& header);
+	bool WalkChunks(const EntityRecordingHeader& header);
+
+	// ZORA: When a frame, or the next frame, is due on the GetMonotonicMilliseconds clock
+	uint64_t GetDueMs(const EntityRecordingChunk* chunk) const;
+	uint64_t GetNextDueMs() const;
+
+	// ZORA: Go back to the first frame, starting its clock now
+	void Rewind();
+
+	MappedFile m_file;
+	std::vector<EntityRecordingKeyframe> m_keyframes;
+	uint64_t m_frameCount;
+	uint64_t m_endOffset;
+	uint64_t m_firstTimeMs;
+	uint32_t m_capacity;
+	EntityDecoder m_decoder;
+	bool m_realTime;
+	bool m_loop;
+	uint64_t m_next;					// ZORA: The next frame to read
+	uint64_t m_nextOffset;				// ZORA: Where its chunk starts
+	uint64_t m_target;					// ZORA: The frame a seek asked for. The next ReadSnapshot decodes at least up to it.
+	bool m_seeking;
+	uint64_t m_startMs;					// ZORA: When frame 0 was, or would have been, shown
+	uint64_t m_generation;
+	int m_errorCode;
+};
@@ -0,0 +1,1149 @@
+#include "EntitySegment.h"
+#include "Platform.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <thread>
+
+// ZORA: The payload starts on its own cache line, clear of the header
+static const uint32_t PAYLOAD_ALIGNMENT = 64;
+
+// ZORA: How many times a reader retries a torn copy before giving up on this frame. A copy only tears if the Editor laps the reader, so a handful of retries is plenty.
+static const int SNAPSHOT_RETRIES = 64;
+
+// ZORA: A block generation the Editor never publishes, used by the reader for blocks it holds no copy of
+static const uint64_t INVALID_BLOCK_GENERATION = ~0ull;
+
+static uint32_t AlignUp(uint32_t value, uint32_t alignment) {
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+// ZORA: The bytes one slot takes for 'capacity' entities laid out as 'layout'
+static size_t GetSlotPayloadSize(uint32_t layout, uint32_t capacity) {
+	return layout == ENTITY_LAYOUT_COLUMNS ? GetEntityColumnsSize(capacity) : sizeof(Entity) * (size_t)capacity;
+}
+
+// ZORA: Create a block of shared memory big enough for 'capacity' entities in every slot, and lay out its header. Everything except the magic number, which the caller writes once the segment is ready to be read.
+static EntitySegmentHeader* CreateSegmentMemory(SharedMemory& memory, const char* name, uint32_t capacity, uint32_t layout, uint32_t epoch, uint64_t generation, uint32_t creatorProcessId, uint64_t createdMs) {
+	uint32_t blockCount = (capacity + ENTITY_BLOCK_SIZE - 1) / ENTITY_BLOCK_SIZE;
+	uint32_t blockTableOffset = AlignUp(sizeof(EntitySegmentHeader), PAYLOAD_ALIGNMENT);
+
+	// ZORA: The handle tables sit between the block tables and the payload, so every offset stays within 32 bits however big the payload gets
+	uint64_t handleSlotsOffset = AlignUp(blockTableOffset + sizeof(uint64_t) * blockCount * ENTITY_SLOT_COUNT, PAYLOAD_ALIGNMENT);
+	uint64_t handleEntitiesOffset = handleSlotsOffset + sizeof(uint64_t) * (uint64_t)capacity;
+	uint64_t payloadOffset = (handleEntitiesOffset + sizeof(uint32_t) * (uint64_t)capacity * ENTITY_SLOT_COUNT + PAYLOAD_ALIGNMENT - 1) / PAYLOAD_ALIGNMENT * PAYLOAD_ALIGNMENT;
+	if (payloadOffset > UINT32_MAX || !memory.Create(name, payloadOffset + GetSlotPayloadSize(layout, capacity) * ENTITY_SLOT_COUNT))
+		return nullptr;
+
+	// ZORA: New shared memory reads as zero, so the magic number isn't there yet and no reader will accept the segment until it is written
+	EntitySegmentHeader* header = new (memory.GetView()) EntitySegmentHeader();
+	header->version = ENTITY_SEGMENT_VERSION;
+	header->capacity = capacity;
+	header->entitySize = sizeof(Entity);
+	header->layout = layout;
+	header->slotCount = ENTITY_SLOT_COUNT;
+	header->payloadOffset = (uint32_t)payloadOffset;
+	header->blockSize = ENTITY_BLOCK_SIZE;
+	header->blockTableOffset = blockTableOffset;
+	header->handleSlotsOffset = (uint32_t)handleSlotsOffset;
+	header->handleEntitiesOffset = (uint32_t)handleEntitiesOffset;
+	header->epoch = epoch;
+	header->redirectEpoch.store(0, std::memory_order_relaxed);
+	header->generation.store(generation, std::memory_order_relaxed);
+	header->frameSignal.store(0, std::memory_order_relaxed);
+	header->waiters.store(0, std::memory_order_relaxed);
+	header->partitionLock.store(0, std::memory_order_relaxed);
+	header->creatorProcessId = creatorProcessId;
+	header->createdMs = createdMs;
+	for (auto& partition : header->partitions) {
+		partition.processId.store(0, std::memory_order_relaxed);
+		partition.first.store(0, std::memory_order_relaxed);
+		partition.capacity.store(0, std::memory_order_relaxed);
+		partition.latestSlot.store(0, std::memory_order_relaxed);
+		partition.heartbeat.store(0, std::memory_order_relaxed);
+		for (auto& slot : partition.slots) {
+			slot.sequence.store(0, std::memory_order_relaxed);
+			slot.count.store(0, std::memory_order_relaxed);
+			slot.generation.store(0, std::memory_order_relaxed);
+			slot.publishedUs.store(0, std::memory_order_relaxed);
+		}
+	}
+	for (auto& reader : header->readers) {
+		reader.processId.store(0, std::memory_order_relaxed);
+		reader.lastSeenGeneration.store(0, std::memory_order_relaxed);
+		reader.heartbeat.store(0, std::memory_order_relaxed);
+	}
+
+	return header;
+}
+
+// ZORA: Open a segment and check every assumption about its layout before trusting a single entity in it. 'report' prints why a segment was refused, which a reader polling for a new Editor doesn't want every few milliseconds.
+static bool OpenSegmentMemory(SharedMemory& memory, const char* name, bool report) {
+	if (!memory.Open(name))
+		return false;
+
+	EntitySegmentHeader* header = (EntitySegmentHeader*)memory.GetView();
+	const char* problem = nullptr;
+
+	if (memory.GetSize() < sizeof(EntitySegmentHeader))
+		problem = "segment is smaller than its header";
+	else if (header->magic.load(std::memory_order_acquire) != ENTITY_SEGMENT_MAGIC)
+		problem = "segment has no entity header";
+	else if (header->version != ENTITY_SEGMENT_VERSION)
+		problem = "segment layout version doesn't match";
+	else if (header->entitySize != sizeof(Entity))
+		problem = "sizeof(Entity) doesn't match";
+	else if (header->layout != ENTITY_LAYOUT_STRUCTS && header->layout != ENTITY_LAYOUT_COLUMNS)
+		problem = "segment layout is unknown";
+	else if (header->slotCount != ENTITY_SLOT_COUNT)
+		problem = "segment slot count doesn't match";
+	else if (header->blockSize != ENTITY_BLOCK_SIZE)
+		problem = "segment block size doesn't match";
+	else if (header->blockTableOffset + sizeof(uint64_t) * ((header->capacity + ENTITY_BLOCK_SIZE - 1) / ENTITY_BLOCK_SIZE) * header->slotCount > header->payloadOffset)
+		problem = "segment block tables overlap its payload";
+	else if (header->handleSlotsOffset < header->blockTableOffset || header->handleSlotsOffset + sizeof(uint64_t) * (size_t)header->capacity > header->handleEntitiesOffset || header->handleEntitiesOffset + sizeof(uint32_t) * (size_t)header->capacity * header->slotCount > header->payloadOffset)
+		problem = "segment handle tables overlap its payload";
+	else if (header->payloadOffset + GetSlotPayloadSize(header->layout, header->capacity) * header->slotCount > memory.GetSize())
+		problem = "segment is smaller than its capacity";
+
+	if (problem != nullptr) {
+		if (report) {
+#ifndef NDEBUG
+			std::cout << "Could not open entity segment " << name << ": " << problem << std::endl;
+#endif
+		}
+		memory.Close();
+		return false;
+	}
+
+	return true;
+}
+
+// ZORA: Whether any process that claimed a range in the segment is still running, crashed producers aside
+static bool HasRunningProducer(const EntitySegmentHeader& header) {
+	for (const auto& partition : header.partitions) {
+		uint32_t processId = partition.processId.load(std::memory_order_acquire);
+		if (processId != 0 && IsProcessRunning(processId))
+			return true;
+	}
+	return false;
+}
+
+EntitySegment::EntitySegment() : m_header(nullptr), m_creatorProcessId(0), m_createdMs(0), m_reattachCount(0), m_partition(nullptr), m_partitionIndex(0), m_publishedCount(0), m_handles(nullptr), m_handlesPublished(false), m_readCount(0), m_readGeneration(0), m_readPublishedUs(0), m_readerSlot(nullptr) {
+	m_name[0] = '\0';
+}
+
+EntitySegment::~EntitySegment() {
+	Close();
+}
+
+bool EntitySegment::Create(const char* name, uint32_t capacity, EntitySegmentLayout layout) {
+	Close();
+	snprintf(m_name, sizeof(m_name), "%s", name);
+
+	// ZORA: A segment with no room can never have a range claimed in it, so refuse it here where the mistake is made
+	if (capacity == 0) {
+#ifndef NDEBUG
+		std::cout << "Could not create entity segment " << name << ": capacity is 0" << std::endl;
+#endif
+		return false;
+	}
+
+	// ZORA: Only a segment nobody is publishing into is replaced. One left behind by Editors that have all gone is recreated, so readers see a new creator and move across.
+	SharedMemory existing;
+	if (OpenSegmentMemory(existing, name, false)) {
+		bool running = HasRunningProducer(*(const EntitySegmentHeader*)existing.GetView());
+		existing.Close();
+		if (running)
+			return Open(name);
+	}
+
+	m_creatorProcessId = GetCurrentProcessIdentifier();
+	m_createdMs = GetMonotonicMilliseconds();
+	m_header = CreateSegmentMemory(m_memory, name, capacity, layout, 0, 0, m_creatorProcessId, m_createdMs);
+	if (m_header == nullptr)
+		return false;
+
+	// ZORA: Readers can still poll for frames without the signal, so failing to create it isn't fatal. Every epoch of the segment shares the one signal.
+	m_signal.Create(name);
+
+	m_header->magic.store(ENTITY_SEGMENT_MAGIC, std::memory_order_release);
+	return true;
+}
+
+bool EntitySegment::Open(const char* name) {
+	Close();
+	snprintf(m_name, sizeof(m_name), "%s", name);
+
+	if (!OpenSegmentMemory(m_memory, name, true))
+		return false;
+
+	m_header = (EntitySegmentHeader*)m_memory.GetView();
+	m_creatorProcessId = m_header->creatorProcessId;
+	m_createdMs = m_header->createdMs;
+	m_signal.Open(name);
+	ResetReadState();
+	m_readGeneration = 0;
+	RegisterReader();
+
+	// ZORA: The segment may already have been resized, in which case the plain name only tells us where the newest one is
+	if (IsRedirected())
+		FollowRedirect();
+	return true;
+}
+
+bool EntitySegment::ClaimRange(uint32_t first, uint32_t capacity) {
+	if (m_header == nullptr || m_partition != nullptr)
+		return false;
+
+	if (!LockPartitions())
+		return false;
+
+	// ZORA: A resize may have finished just before the lock was taken, in which case the range has to be claimed in the new segment instead
+	while (IsRedirected()) {
+		UnlockPartitions();
+		if (!FollowRedirect() || !LockPartitions())
+			return false;
+	}
+
+	if (first % ENTITY_BLOCK_SIZE != 0 || capacity == 0 || first > m_header->capacity || capacity > m_header->capacity - first) {
+		UnlockPartitions();
+#ifndef NDEBUG
+		std::cout << "Could not claim entities " << first << " to " << first + capacity << ": range doesn't fit the segment or doesn't start on a block" << std::endl;
+#endif
+		return false;
+	}
+
+	// ZORA: With the lock held no other producer can claim a range in between checking for overlaps and taking a partition
+	EntityPartition* free = nullptr;
+	bool overlaps = false;
+	for (auto& partition : m_header->partitions) {
+		// ZORA: A producer that crashed never released its range, so its partition is as good as free and an Editor restarted with the same --producer can take it back
+		uint32_t processId = partition.processId.load(std::memory_order_acquire);
+		if (processId == 0 || !IsProcessRunning(processId)) {
+			if (free == nullptr)
+				free = &partition;
+			continue;
+		}
+
+		uint32_t otherFirst = partition.first.load(std::memory_order_relaxed);
+		uint32_t otherCapacity = partition.capacity.load(std::memory_order_relaxed);
+		if (first < otherFirst + otherCapacity && otherFirst < first + capacity)
+			overlaps = true;
+	}
+
+	if (overlaps || free == nullptr) {
+		UnlockPartitions();
+#ifndef NDEBUG
+		std::cout << "Could not claim entities " << first << " to " << first + capacity << ": " << (overlaps ? "range overlaps another producer's" : "every partition is taken") << std::endl;
+#endif
+		return false;
+	}
+
+	// ZORA: The slots keep counting from wherever the last owner left them, so a reader part way through a copy from the last owner still sees its sequence move
+	free->first.store(first, std::memory_order_relaxed);
+	free->capacity.store(capacity, std::memory_order_relaxed);
+	for (auto& slot : free->slots)
+		slot.count.store(0, std::memory_order_relaxed);
+
+	// ZORA: The last owner's handles mean nothing now. Cleared so none of them resolve to whatever this producer puts in their slots.
+	std::atomic<uint64_t>* handleSlots = GetHandleSlots() + first;
+	for (uint32_t index = 0; index < capacity; index++)
+		handleSlots[index].store(0, std::memory_order_relaxed);
+	free->heartbeat.store(GetMonotonicMilliseconds(), std::memory_order_relaxed);
+	free->processId.store(GetCurrentProcessIdentifier(), std::memory_order_release);
+	UnlockPartitions();
+
+	// ZORA: A producer isn't waiting on anybody's frames, so it shouldn't be reported as a Display
+	UnregisterReader();
+
+	m_partition = free;
+	m_partitionIndex = (uint32_t)(free - m_header->partitions);
+	ResetWriteState(capacity);
+	return true;
+}
+
+bool EntitySegment::Resize(uint32_t capacity) {
+	if (m_partition == nullptr || capacity == 0)
+		return false;
+
+	if (IsRedirected() && !FollowRedirect())
+		return false;
+
+	if (!LockPartitions())
+		return false;
+
+	// ZORA: Somebody else resized while we waited for the lock. Their segment will be picked up on the next Publish, and the resize can be tried again there.
+	if (IsRedirected()) {
+		UnlockPartitions();
+		return false;
+	}
+
+	// ZORA: Ranges after this one move along by however much this one grows, so nobody overlaps and any unclaimed space between ranges is kept
+	uint32_t rangeFirst = m_partition->first.load(std::memory_order_relaxed);
+	uint32_t oldSpan = AlignUp(m_partition->capacity.load(std::memory_order_relaxed), ENTITY_BLOCK_SIZE);
+	uint32_t newSpan = AlignUp(capacity, ENTITY_BLOCK_SIZE);
+	uint32_t growth = newSpan > oldSpan ? newSpan - oldSpan : 0;
+	if (m_header->capacity > UINT32_MAX - growth) {
+		UnlockPartitions();
+		return false;
+	}
+
+	uint32_t epoch = m_header->epoch + 1;
+	char name[sizeof(m_name) + 16];
+	GetEpochName(name, sizeof(name), epoch);
+
+	// ZORA: The new segment carries on from the old one's generation, so nobody waiting on a generation mistakes it for an older frame
+	uint64_t generation = m_header->generation.fetch_add(1, std::memory_order_relaxed) + 1;
+	SharedMemory memory;
+	EntitySegmentHeader* header = CreateSegmentMemory(memory, name, m_header->capacity + growth, m_header->layout, epoch, generation, m_header->creatorProcessId, m_header->createdMs);
+	if (header == nullptr) {
+		UnlockPartitions();
+#ifndef NDEBUG
+		std::cout << "Could not create entity segment " << name << ": " << memory.GetErrorCode() << std::endl;
+#endif
+		return false;
+	}
+
+	// ZORA: Carry every partition across with its newest frame in slot 0, so the Display has the same entities to draw the moment it moves over. The other producers are still publishing into the old segment, so their frames are copied the same careful way a reader would.
+	// ZORA: The new segment has the old one's layout, so either way the entities are copied across as they are
+	bool columnLayout = m_header->layout == ENTITY_LAYOUT_COLUMNS;
+	Entity* newEntities = (Entity*)((char*)memory.GetView() + header->payloadOffset);
+	EntityColumns newColumns = MakeEntityColumns((char*)memory.GetView() + header->payloadOffset, header->capacity);
+	uint64_t* newBlocks = (uint64_t*)((char*)memory.GetView() + header->blockTableOffset);
+	std::atomic<uint64_t>* newHandleSlots = (std::atomic<uint64_t>*)((char*)memory.GetView() + header->handleSlotsOffset);
+	uint32_t* newHandleEntities = (uint32_t*)((char*)memory.GetView() + header->handleEntitiesOffset);
+
+	for (uint32_t index = 0; index < ENTITY_MAX_PARTITIONS; index++) {
+		const EntityPartition& from = m_header->partitions[index];
+		EntityPartition& to = header->partitions[index];
+		uint32_t processId = from.processId.load(std::memory_order_acquire);
+		if (processId == 0)
+			continue;
+
+		uint32_t first = from.first.load(std::memory_order_relaxed);
+		uint32_t fromCapacity = from.capacity.load(std::memory_order_relaxed);
+		uint32_t toFirst = first > rangeFirst ? first + growth : first;
+		uint32_t toCapacity = &from == m_partition ? capacity : fromCapacity;
+		uint32_t count = 0;
+		uint64_t publishedUs = 0;
+
+		for (int attempt = 0; attempt < SNAPSHOT_RETRIES; attempt++) {
+			uint32_t latest = from.latestSlot.load(std::memory_order_acquire) % ENTITY_SLOT_COUNT;
+			const EntitySlotHeader& slot = from.slots[latest];
+			uint32_t before = slot.sequence.load(std::memory_order_acquire);
+			if (before & 1)
+				continue;
+
+			count = std::min(ClampCount(slot.count.load(std::memory_order_relaxed), fromCapacity), toCapacity);
+			publishedUs = slot.publishedUs.load(std::memory_order_relaxed);
+			if (columnLayout)
+				CopyEntityColumns(GetSlotColumns(latest), first, newColumns, toFirst, count);
+			else
+				memcpy(newEntities + toFirst, GetSlotEntities(latest) + first, sizeof(Entity) * count);
+			memcpy(newHandleEntities + toFirst, GetSlotHandleEntities(latest) + first, sizeof(uint32_t) * count);
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (slot.sequence.load(std::memory_order_relaxed) == before)
+				break;
+
+			// ZORA: Torn every time; the range starts out empty instead and its producer fills it on its next Publish
+			count = 0;
+		}
+
+		for (uint32_t block = 0; block < GetBlockCount(count); block++)
+			newBlocks[toFirst / ENTITY_BLOCK_SIZE + block] = generation;
+
+		// ZORA: The handle tables come across too, so handles the Displays hold keep resolving before each producer has published into the new segment. Handles past the new capacity are dropped along with their entities.
+		uint32_t handleCount = std::min(fromCapacity, toCapacity);
+		for (uint32_t handle = 0; handle < handleCount; handle++) {
+			uint64_t packed = GetHandleSlots()[first + handle].load(std::memory_order_acquire);
+			newHandleSlots[toFirst + handle].store((uint32_t)packed < toCapacity ? packed : 0, std::memory_order_relaxed);
+		}
+
+		to.first.store(toFirst, std::memory_order_relaxed);
+		to.capacity.store(toCapacity, std::memory_order_relaxed);
+		to.slots[0].count.store(count, std::memory_order_relaxed);
+		to.slots[0].generation.store(generation, std::memory_order_relaxed);
+		to.slots[0].publishedUs.store(publishedUs, std::memory_order_relaxed);
+		to.heartbeat.store(from.heartbeat.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		to.processId.store(processId, std::memory_order_relaxed);
+	}
+
+	header->magic.store(ENTITY_SEGMENT_MAGIC, std::memory_order_release);
+
+	// ZORA: Point the epoch 0 segment at the new one before the old one, so anybody who sees the old segment redirected always finds the new one
+	GetRootHeader()->redirectEpoch.store(epoch, std::memory_order_release);
+	m_header->redirectEpoch.store(epoch, std::memory_order_release);
+	UnlockPartitions();
+
+	// ZORA: Wake any reader asleep on the old segment so it moves across straight away
+	m_header->frameSignal.fetch_add(1);
+	uint32_t waiters = m_header->waiters.load();
+	if (waiters > 0)
+		m_signal.Wake(&m_header->frameSignal, waiters);
+
+	UseSegment(memory);
+	m_partition = &m_header->partitions[m_partitionIndex];
+	ResetWriteState(capacity);
+	return true;
+}
+
+void EntitySegment::Close() {
+	UnregisterReader();
+	if (m_partition != nullptr) {
+		m_partition->processId.store(0, std::memory_order_release);
+		m_partition = nullptr;
+
+		// ZORA: Wake any readers so they notice straight away that this producer has gone, and start looking for the next one
+		m_header->frameSignal.fetch_add(1);
+		uint32_t waiters = m_header->waiters.load();
+		if (waiters > 0)
+			m_signal.Wake(&m_header->frameSignal, waiters);
+	}
+	m_header = nullptr;
+	m_name[0] = '\0';
+	m_dirtyBlocks.clear();
+	m_blockGenerations.clear();
+	m_readBlockGenerations.clear();
+	m_changedBlocks.clear();
+	m_staging.clear();
+	m_readHandleEntities.clear();
+	m_stagingHandles.clear();
+	m_handles = nullptr;
+	m_signal.Close();
+	m_memory.Close();
+	m_root.Close();
+}
+
+void EntitySegment::MarkDirty(uint32_t index) {
+	uint32_t block = index / ENTITY_BLOCK_SIZE;
+	if (block < m_dirtyBlocks.size())
+		m_dirtyBlocks[block] = 1;
+}
+
+void EntitySegment::MarkAllDirty() {
+	std::fill(m_dirtyBlocks.begin(), m_dirtyBlocks.end(), 1);
+}
+
+void EntitySegment::Publish(const Entity* entities, uint32_t count) {
+	PublishFrame(entities, nullptr, count);
+}
+
+bool EntitySegment::AcceptsColumns() const {
+	return true;
+}
+
+void EntitySegment::PublishColumns(const EntityColumns& columns, uint32_t count) {
+	PublishFrame(nullptr, &columns, count);
+}
+
+// ZORA: Publish from whichever of 'entities' and 'columns' isn't null, into whichever layout the segment has. Copying like for like is a memcpy per block, or per column of a block; anything else is rearranged on the way.
+void EntitySegment::PublishFrame(const Entity* entities, const EntityColumns* columns, uint32_t count) {
+	// ZORA: Another producer resized the segment, so move this range across before publishing into it
+	if (m_partition != nullptr && IsRedirected())
+		FollowRedirect();
+
+	if (m_partition == nullptr)
+		return;
+
+	// ZORA: Stamped before anything is copied, so the copy counts towards how old the frame is when it is drawn
+	uint64_t publishedUs = GetMonotonicMicroseconds();
+	uint32_t first = m_partition->first.load(std::memory_order_relaxed);
+	uint32_t firstBlock = first / ENTITY_BLOCK_SIZE;
+	count = ClampCount(count, m_partition->capacity.load(std::memory_order_relaxed));
+
+	// ZORA: Entities that came or went since last time change the blocks they live in
+	if (count != m_publishedCount) {
+		uint32_t changedBlock = std::min(count, m_publishedCount) / ENTITY_BLOCK_SIZE;
+		uint32_t endBlock = GetBlockCount(std::max(count, m_publishedCount));
+		for (uint32_t block = changedBlock; block < endBlock; block++)
+			m_dirtyBlocks[block] = 1;
+		m_publishedCount = count;
+	}
+
+	// ZORA: The slot after the newest is the oldest, so any reader still copying from it has had two whole frames to finish
+	uint32_t latest = m_partition->latestSlot.load(std::memory_order_relaxed);
+	uint32_t target = (latest + 1) % ENTITY_SLOT_COUNT;
+	EntitySlotHeader& slot = m_partition->slots[target];
+
+	// ZORA: Other producers publish too, so take the next generation rather than assume it
+	uint64_t generation = m_header->generation.fetch_add(1, std::memory_order_relaxed) + 1;
+
+	// ZORA: Everything that changed this frame is stamped with the new generation
+	for (size_t block = 0; block < m_dirtyBlocks.size(); block++) {
+		if (m_dirtyBlocks[block]) {
+			m_blockGenerations[block] = generation;
+			m_dirtyBlocks[block] = 0;
+		}
+	}
+
+	// ZORA: An odd sequence tells readers a copy into this slot is in progress. The release fence keeps the payload writes from being reordered ahead of it.
+	uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+	slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	// ZORA: This slot was last written a few frames ago, so copy every block that has changed since then and nothing else. Only this producer's blocks are touched.
+	bool columnLayout = m_header->layout == ENTITY_LAYOUT_COLUMNS;
+	Entity* slotEntities = GetSlotEntities(target) + first;
+	EntityColumns slotColumns = GetSlotColumns(target);
+	uint32_t* slotHandles = GetSlotHandleEntities(target) + first;
+	uint64_t* slotBlocks = GetSlotBlockGenerations(target) + firstBlock;
+	uint32_t blockCount = GetBlockCount(count);
+
+	for (uint32_t block = 0; block < blockCount; block++) {
+		if (slotBlocks[block] == m_blockGenerations[block])
+			continue;
+
+		uint32_t index = block * ENTITY_BLOCK_SIZE;
+		uint32_t length = std::min(ENTITY_BLOCK_SIZE, count - index);
+		if (columnLayout && columns != nullptr)
+			CopyEntityColumns(*columns, index, slotColumns, first + index, length);
+		else if (columnLayout)
+			ScatterEntities(entities + index, length, slotColumns, first + index);
+		else if (columns != nullptr)
+			GatherEntities(*columns, index, length, slotEntities + index);
+		else
+			memcpy(slotEntities + index, entities + index, sizeof(Entity) * length);
+		for (uint32_t entity = index; entity < index + length; entity++)
+			slotHandles[entity] = m_handles != nullptr ? m_handles->GetEntitySlot(entity) : ENTITY_HANDLE_NONE;
+		slotBlocks[block] = m_blockGenerations[block];
+	}
+
+	slot.count.store(count, std::memory_order_relaxed);
+	slot.generation.store(generation, std::memory_order_relaxed);
+	slot.publishedUs.store(publishedUs, std::memory_order_relaxed);
+
+	// ZORA: Back to even once everything above is visible, then flip this partition's newest slot over to this one
+	slot.sequence.store(sequence + 2, std::memory_order_release);
+	m_partition->latestSlot.store(target, std::memory_order_release);
+	m_partition->heartbeat.store(GetMonotonicMilliseconds(), std::memory_order_relaxed);
+
+	// ZORA: Wake any readers sleeping in WaitForFrame. Both of these are sequentially consistent so that a reader who has just started waiting either sees the new signal or is counted here.
+	m_header->frameSignal.fetch_add(1);
+	uint32_t waiters = m_header->waiters.load();
+	if (waiters > 0)
+		m_signal.Wake(&m_header->frameSignal, waiters);
+}
+
+void EntitySegment::PublishHandles(const EntityHandleTable& handles) {
+	if (m_partition != nullptr && IsRedirected())
+		FollowRedirect();
+
+	if (m_partition == nullptr)
+		return;
+
+	m_handles = &handles;
+	uint32_t first = m_partition->first.load(std::memory_order_relaxed);
+	uint32_t capacity = m_partition->capacity.load(std::memory_order_relaxed);
+
+	if (!m_handlesPublished) {
+		for (uint32_t index = 0; index < handles.GetSlotCount(); index++)
+			PublishHandle(handles, index, first, capacity);
+		m_handlesPublished = true;
+		return;
+	}
+
+	for (uint32_t index : handles.GetChanges())
+		PublishHandle(handles, index, first, capacity);
+}
+
+// ZORA: Slots past the range's capacity can't be shared until a resize makes room, after which every slot is copied again
+void EntitySegment::PublishHandle(const EntityHandleTable& handles, uint32_t index, uint32_t first, uint32_t capacity) {
+	if (index >= capacity)
+		return;
+
+	// ZORA: The entity's handle slot travels with the entity itself, so a reader only finds it in a frame that has the entity in that place
+	uint64_t packed = handles.GetPackedSlot(index);
+	MarkDirty((uint32_t)packed);
+	GetHandleSlots()[first + index].store(packed, std::memory_order_release);
+}
+
+bool EntitySegment::ReadSnapshot(std::vector<Entity>& entities) {
+	// ZORA: Nothing to read until an Editor has created the segment
+	if (m_header == nullptr)
+		return false;
+
+	// ZORA: The segment has been resized. If the new one can't be opened yet, carry on reading the old one, which is still mapped and still the size it always was.
+	if (IsRedirected())
+		FollowRedirect();
+
+	// ZORA: A vector this segment didn't fill last time can't be patched, so copy everything into it
+	if (entities.size() != m_readCount) {
+		std::fill(m_readBlockGenerations.begin(), m_readBlockGenerations.end(), INVALID_BLOCK_GENERATION);
+		for (auto& placement : m_readPlacements)
+			placement = PartitionPlacement{ 0, 0, 0, 0 };
+	}
+
+	// ZORA: Taken before copying anything, so a frame published part way through is still newer than this snapshot and WaitForFrame won't sleep through it
+	uint64_t generation = m_header->generation.load(std::memory_order_acquire);
+	PartitionPlacement placements[ENTITY_MAX_PARTITIONS];
+
+	// ZORA: A crashed producer's range is only left out while somebody else is still publishing, so the last picture of a crashed Editor stays up on its own
+	EntityProducerState states[ENTITY_MAX_PARTITIONS];
+	uint64_t now = GetMonotonicMilliseconds();
+	bool anyLive = false;
+	for (uint32_t index = 0; index < ENTITY_MAX_PARTITIONS; index++) {
+		states[index] = GetPartitionState(m_header->partitions[index], now);
+		anyLive |= states[index] == ENTITY_PRODUCER_LIVE;
+	}
+	uint32_t offset = 0;
+	uint64_t publishedUs = 0;
+
+	m_changedBlocks.clear();
+	m_staging.clear();
+	m_stagingHandles.clear();
+
+	for (uint32_t index = 0; index < ENTITY_MAX_PARTITIONS; index++) {
+		const EntityPartition& partition = m_header->partitions[index];
+		placements[index] = PartitionPlacement{ 0, 0, 0, 0 };
+		bool copied = anyLive && states[index] == ENTITY_PRODUCER_DEAD;
+
+		for (int attempt = 0; attempt < SNAPSHOT_RETRIES && !copied; attempt++) {
+			uint32_t processId = partition.processId.load(std::memory_order_acquire);
+			if (processId == 0) {
+				copied = true;
+				break;
+			}
+
+			// ZORA: Never trust a range that doesn't fit the segment, whatever the partition says
+			uint32_t first = partition.first.load(std::memory_order_relaxed);
+			uint32_t capacity = partition.capacity.load(std::memory_order_relaxed);
+			if (first % ENTITY_BLOCK_SIZE != 0 || first > m_header->capacity || capacity > m_header->capacity - first) {
+				copied = true;
+				break;
+			}
+
+			uint32_t latest = partition.latestSlot.load(std::memory_order_acquire) % ENTITY_SLOT_COUNT;
+			const EntitySlotHeader& slot = partition.slots[latest];
+			uint32_t before = slot.sequence.load(std::memory_order_acquire);
+
+			// ZORA: The producer has already come back round to this slot, so look for the newest one again
+			if (before & 1)
+				continue;
+
+			uint32_t count = ClampCount(slot.count.load(std::memory_order_relaxed), capacity);
+			uint64_t slotPublishedUs = slot.publishedUs.load(std::memory_order_relaxed);
+			uint32_t firstBlock = first / ENTITY_BLOCK_SIZE;
+			uint32_t blockCount = GetBlockCount(count);
+			bool columnLayout = m_header->layout == ENTITY_LAYOUT_COLUMNS;
+			const Entity* slotEntities = GetSlotEntities(latest);
+			EntityColumns slotColumns = GetSlotColumns(latest);
+			const uint32_t* slotHandles = GetSlotHandleEntities(latest);
+			const uint64_t* slotBlocks = GetSlotBlockGenerations(latest);
+
+			// ZORA: A partition that has moved in the caller's vector, or changed hands, has nothing there worth keeping
+			const PartitionPlacement& previous = m_readPlacements[index];
+			bool moved = previous.processId != processId || previous.first != first || previous.offset != offset;
+
+			// ZORA: Stage every block whose generation differs from the copy the caller already holds
+			size_t changedMark = m_changedBlocks.size();
+			size_t stagingMark = m_staging.size();
+			size_t stagingHandlesMark = m_stagingHandles.size();
+
+			for (uint32_t block = 0; block < blockCount; block++) {
+				uint64_t blockGeneration = slotBlocks[firstBlock + block];
+				if (!moved && blockGeneration == m_readBlockGenerations[firstBlock + block])
+					continue;
+
+				uint32_t entity = block * ENTITY_BLOCK_SIZE;
+				uint32_t length = std::min(ENTITY_BLOCK_SIZE, count - entity);
+				m_changedBlocks.push_back(StagedBlock{ firstBlock + block, offset + entity, length, blockGeneration });
+				if (columnLayout) {
+					size_t staged = m_staging.size();
+					m_staging.resize(staged + length);
+					GatherEntities(slotColumns, first + entity, length, m_staging.data() + staged);
+				}
+				else {
+					m_staging.insert(m_staging.end(), slotEntities + first + entity, slotEntities + first + entity + length);
+				}
+				m_stagingHandles.insert(m_stagingHandles.end(), slotHandles + first + entity, slotHandles + first + entity + length);
+			}
+
+			// ZORA: If the sequence hasn't moved, the producer didn't touch the slot while it was being copied. If the partition changed hands, the range may no longer mean the same thing.
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (slot.sequence.load(std::memory_order_relaxed) != before ||
+				partition.processId.load(std::memory_order_relaxed) != processId ||
+				partition.first.load(std::memory_order_relaxed) != first ||
+				partition.capacity.load(std::memory_order_relaxed) != capacity) {
+				m_changedBlocks.resize(changedMark);
+				m_staging.resize(stagingMark);
+				m_stagingHandles.resize(stagingHandlesMark);
+				continue;
+			}
+
+			placements[index] = PartitionPlacement{ processId, first, offset, count };
+			offset += count;
+			if (publishedUs == 0 || slotPublishedUs < publishedUs)
+				publishedUs = slotPublishedUs;
+			copied = true;
+		}
+
+		if (!copied)
+			return false;
+	}
+
+	// ZORA: Blocks past each partition's count are gone, so forget them in case they come back later
+	for (uint32_t index = 0; index < ENTITY_MAX_PARTITIONS; index++) {
+		if (placements[index].processId == 0)
+			continue;
+
+		uint32_t firstBlock = placements[index].first / ENTITY_BLOCK_SIZE;
+		uint32_t endBlock = GetBlockCount(placements[index].first + m_header->partitions[index].capacity.load(std::memory_order_relaxed));
+		for (uint32_t block = firstBlock + GetBlockCount(placements[index].count); block < endBlock && block < m_readBlockGenerations.size(); block++)
+			m_readBlockGenerations[block] = INVALID_BLOCK_GENERATION;
+	}
+
+	// ZORA: Patch the staged blocks into the caller's vector
+	entities.resize(offset);
+	m_readHandleEntities.resize(offset);
+	const Entity* staged = m_staging.data();
+	const uint32_t* stagedHandles = m_stagingHandles.data();
+	for (const auto& change : m_changedBlocks) {
+		memcpy(entities.data() + change.offset, staged, sizeof(Entity) * change.length);
+		memcpy(m_readHandleEntities.data() + change.offset, stagedHandles, sizeof(uint32_t) * change.length);
+		staged += change.length;
+		stagedHandles += change.length;
+		m_readBlockGenerations[change.block] = change.generation;
+	}
+
+	for (uint32_t index = 0; index < ENTITY_MAX_PARTITIONS; index++)
+		m_readPlacements[index] = placements[index];
+
+	m_readCount = offset;
+	m_readGeneration = generation;
+	m_readPublishedUs = publishedUs;
+	ReaderHeartbeat();
+	return true;
+}
+
+bool EntitySegment::WaitForFrame(uint64_t generation, int timeoutMs) {
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+
+	// ZORA: A reader waiting for the Editor is idle, not gone
+	ReaderHeartbeat();
+
+	while (true) {
+		// ZORA: A new Editor's segment is as good as a new frame. Only looked for while nobody at all is publishing into this one, so a healthy segment costs nothing extra and one crashed Editor doesn't take the Display away from the others.
+		bool degraded = GetProducerState() != ENTITY_PRODUCER_LIVE;
+		if (degraded && Reattach())
+			return true;
+
+		uint32_t signal = 0;
+		if (m_header != nullptr) {
+			// ZORA: A resize is as good as a new frame, as long as there is a new segment to move to
+			if (IsRedirected() && FollowRedirect())
+				return true;
+
+			// ZORA: Read the signal before the generation, so a publish in between changes the signal and the sleep below returns straight away
+			signal = m_header->frameSignal.load();
+			if (GetGeneration() != generation)
+				return true;
+		}
+
+		auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+		if (remaining <= 0)
+			return false;
+
+		// ZORA: Nobody is going to raise the signal of a segment without a live producer, so wake up in time to look for a new one instead. A live producer that goes quiet doesn't raise it either, so wake up when it would count as stalled too.
+		long long sleepMs = degraded ? std::min<long long>(remaining, (long long)ENTITY_REATTACH_POLL_MS) : remaining;
+		if (!degraded)
+			sleepMs = std::min<long long>(sleepMs, (long long)GetMillisecondsUntilStall() + 1);
+		if (m_header == nullptr) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(sleepMs));
+			continue;
+		}
+
+		m_header->waiters.fetch_add(1);
+		m_signal.Wait(&m_header->frameSignal, signal, (int)sleepMs);
+		m_header->waiters.fetch_sub(1);
+	}
+}
+
+uint64_t EntitySegment::GetSnapshotGeneration() const {
+	return m_readGeneration;
+}
+
+uint64_t EntitySegment::GetSnapshotPublishedUs() const {
+	return m_readPublishedUs;
+}
+
+uint32_t EntitySegment::GetReaders(std::vector<EntityReaderStatus>& readers, uint64_t maxFramesBehind) const {
+	readers.clear();
+	uint32_t lagging = 0;
+	uint64_t now = GetMonotonicMilliseconds();
+	uint64_t generation = GetGeneration();
+
+	for (const auto& reader : m_header->readers) {
+		uint32_t processId = reader.processId.load(std::memory_order_acquire);
+		if (processId == 0)
+			continue;
+
+		EntityReaderStatus status;
+		status.processId = processId;
+		status.lastSeenGeneration = reader.lastSeenGeneration.load(std::memory_order_relaxed);
+		status.framesBehind = generation > status.lastSeenGeneration ? generation - status.lastSeenGeneration : 0;
+		uint64_t heartbeat = reader.heartbeat.load(std::memory_order_relaxed);
+		status.millisecondsSinceHeartbeat = now > heartbeat ? now - heartbeat : 0;
+
+		// ZORA: A reader that stopped checking in has most likely crashed without unregistering
+		if (status.millisecondsSinceHeartbeat > ENTITY_READER_TIMEOUT_MS)
+			continue;
+
+		if (status.framesBehind > maxFramesBehind)
+			lagging++;
+		readers.push_back(status);
+	}
+
+	return lagging;
+}
+
+EntityProducerState EntitySegment::GetProducerState() const {
+	if (m_header == nullptr)
+		return ENTITY_PRODUCER_ABSENT;
+
+	EntityProducerState state = ENTITY_PRODUCER_ABSENT;
+	uint64_t now = GetMonotonicMilliseconds();
+
+	for (const auto& partition : m_header->partitions) {
+		// ZORA: A live producer can't get any better, so stop before asking the operating system about anybody else
+		state = std::min(state, GetPartitionState(partition, now));
+		if (state == ENTITY_PRODUCER_LIVE)
+			break;
+	}
+
+	return state;
+}
+
+uint32_t EntitySegment::GetProducerCount(EntityProducerState state) const {
+	if (m_header == nullptr)
+		return 0;
+
+	uint32_t count = 0;
+	uint64_t now = GetMonotonicMilliseconds();
+	for (const auto& partition : m_header->partitions) {
+		if (partition.processId.load(std::memory_order_acquire) != 0 && GetPartitionState(partition, now) == state)
+			count++;
+	}
+
+	return count;
+}
+
+// ZORA: Only a producer that has gone quiet is worth asking the operating system about, so a healthy partition never makes a system call here
+EntityProducerState EntitySegment::GetPartitionState(const EntityPartition& partition, uint64_t now) const {
+	uint32_t processId = partition.processId.load(std::memory_order_acquire);
+	if (processId == 0)
+		return ENTITY_PRODUCER_ABSENT;
+
+	uint64_t heartbeat = partition.heartbeat.load(std::memory_order_relaxed);
+	if (now <= heartbeat || now - heartbeat <= ENTITY_PRODUCER_STALL_MS)
+		return ENTITY_PRODUCER_LIVE;
+
+	return IsProcessRunning(processId) ? ENTITY_PRODUCER_STALLED : ENTITY_PRODUCER_DEAD;
+}
+
+// ZORA: How long until the live producer that published least recently would count as stalled. Producers that already have are left out, or a single crashed one would wake the reader every millisecond.
+uint64_t EntitySegment::GetMillisecondsUntilStall() const {
+	uint64_t now = GetMonotonicMilliseconds();
+	uint64_t until = ENTITY_PRODUCER_STALL_MS;
+
+	for (const auto& partition : m_header->partitions) {
+		if (partition.processId.load(std::memory_order_acquire) == 0)
+			continue;
+
+		uint64_t stallMs = partition.heartbeat.load(std::memory_order_relaxed) + ENTITY_PRODUCER_STALL_MS;
+		if (stallMs >= now)
+			until = std::min(until, stallMs - now);
+	}
+
+	return until;
+}
+
+// ZORA: Once every Editor publishing into the old segment has gone, on Linux a new Editor unlinks it and creates its own under the name, leaving this reader holding an orphan. On Windows this reader's handle keeps the old segment alive, so the new Editor reinitialises it in place. Either way the segment under the name has a creator other than the one recorded when this one was opened.
+bool EntitySegment::Reattach() {
+	if (m_partition != nullptr || m_name[0] == '\0')
+		return false;
+
+	SharedMemory memory;
+	if (!OpenSegmentMemory(memory, m_name, false))
+		return false;
+
+	const EntitySegmentHeader* header = (const EntitySegmentHeader*)memory.GetView();
+	if (m_header != nullptr && header->creatorProcessId == m_creatorProcessId && header->createdMs == m_createdMs)
+		return false;
+	memory.Close();
+
+	// ZORA: The registry entry lives in the old Editor's segment, or on Windows has already been wiped by the new one, so it is left behind rather than cleared
+	m_readerSlot = nullptr;
+
+	// ZORA: Open starts by closing, which forgets the name
+	char name[sizeof(m_name)];
+	snprintf(name, sizeof(name), "%s", m_name);
+	if (!Open(name))
+		return false;
+
+	m_reattachCount++;
+	return true;
+}
+
+uint32_t EntitySegment::GetReattachCount() const {
+	return m_reattachCount;
+}
+
+uint32_t EntitySegment::GetCapacity() const {
+	return m_header != nullptr ? m_header->capacity : 0;
+}
+
+uint32_t EntitySegment::GetRangeCapacity() const {
+	return m_partition != nullptr ? m_partition->capacity.load(std::memory_order_relaxed) : 0;
+}
+
+uint32_t EntitySegment::GetPartitionIndex() const {
+	return m_partitionIndex;
+}
+
+bool EntitySegment::FindSnapshotEntity(size_t snapshotIndex, uint32_t& partition, uint32_t& index) const {
+	for (uint32_t i = 0; i < ENTITY_MAX_PARTITIONS; i++) {
+		const PartitionPlacement& placement = m_readPlacements[i];
+		if (placement.processId != 0 && snapshotIndex >= placement.offset && snapshotIndex < (size_t)placement.offset + placement.count) {
+			partition = i;
+			index = (uint32_t)(snapshotIndex - placement.offset);
+			return true;
+		}
+	}
+	return false;
+}
+
+bool EntitySegment::FindSnapshotHandle(size_t snapshotIndex, EntitySegmentHandle& handle) const {
+	uint32_t partition = 0;
+	uint32_t index = 0;
+	uint32_t first = 0;
+	uint32_t capacity = 0;
+	if (!FindSnapshotEntity(snapshotIndex, partition, index) || !GetHandleRange(m_header->partitions[partition], first, capacity) || index >= capacity)
+		return false;
+
+	uint32_t slot = m_readHandleEntities[snapshotIndex];
+	if (slot >= capacity)
+		return false;
+
+	// ZORA: The slot has to point back at the entity. If it doesn't, the entity has moved or gone in a newer frame, and the generation in the table may already belong to whatever took its slot.
+	uint64_t packed = GetHandleSlots()[first + slot].load(std::memory_order_acquire);
+	uint32_t generation = (uint32_t)(packed >> 32);
+	if ((uint32_t)packed != index || (generation & 1) == 0)
+		return false;
+
+	handle = EntitySegmentHandle{ partition, m_readPlacements[partition].processId, EntityHandle{ slot, generation } };
+	return true;
+}
+
+bool EntitySegment::FindHandleSnapshotIndex(const EntitySegmentHandle& handle, size_t& snapshotIndex) const {
+	if (m_header == nullptr || handle.partition >= ENTITY_MAX_PARTITIONS)
+		return false;
+
+	const PartitionPlacement& placement = m_readPlacements[handle.partition];
+	uint32_t first = 0;
+	uint32_t capacity = 0;
+	if (placement.processId == 0 || placement.processId != handle.processId || !GetHandleRange(m_header->partitions[handle.partition], first, capacity) || handle.handle.index >= capacity)
+		return false;
+
+	uint64_t packed = GetHandleSlots()[first + handle.handle.index].load(std::memory_order_acquire);
+	uint32_t index = (uint32_t)packed;
+	if ((uint32_t)(packed >> 32) != handle.handle.generation || (handle.handle.generation & 1) == 0 || index >= placement.count)
+		return false;
+
+	// ZORA: The table may be a frame ahead of the snapshot. Only trust it where the snapshot agrees the entity is there; otherwise it has just moved and is found again next frame.
+	if (m_readHandleEntities[placement.offset + index] != handle.handle.index)
+		return false;
+
+	snapshotIndex = placement.offset + index;
+	return true;
+}
+
+uint64_t EntitySegment::GetGeneration() const {
+	return m_header->generation.load(std::memory_order_acquire);
+}
+
+int EntitySegment::GetErrorCode() const {
+	return m_memory.GetErrorCode();
+}
+
+char* EntitySegment::GetSlotPayload(uint32_t slot) const {
+	return (char*)m_memory.GetView() + m_header->payloadOffset + GetSlotPayloadSize(m_header->layout, m_header->capacity) * slot;
+}
+
+Entity* EntitySegment::GetSlotEntities(uint32_t slot) const {
+	return (Entity*)GetSlotPayload(slot);
+}
+
+EntityColumns EntitySegment::GetSlotColumns(uint32_t slot) const {
+	return MakeEntityColumns(GetSlotPayload(slot), m_header->capacity);
+}
+
+uint64_t* EntitySegment::GetSlotBlockGenerations(uint32_t slot) const {
+	return (uint64_t*)((char*)m_memory.GetView() + m_header->blockTableOffset) + (size_t)slot * GetBlockCount(m_header->capacity);
+}
+
+std::atomic<uint64_t>* EntitySegment::GetHandleSlots() const {
+	return (std::atomic<uint64_t>*)((char*)m_memory.GetView() + m_header->handleSlotsOffset);
+}
+
+uint32_t* EntitySegment::GetSlotHandleEntities(uint32_t slot) const {
+	return (uint32_t*)((char*)m_memory.GetView() + m_header->handleEntitiesOffset) + (size_t)slot * m_header->capacity;
+}
+
+// ZORA: Never trust a range that doesn't fit the segment, whatever the partition says
+bool EntitySegment::GetHandleRange(const EntityPartition& partition, uint32_t& first, uint32_t& capacity) const {
+	first = partition.first.load(std::memory_order_relaxed);
+	capacity = partition.capacity.load(std::memory_order_relaxed);
+	return first <= m_header->capacity && capacity <= m_header->capacity - first;
+}
+
+uint32_t EntitySegment::GetBlockCount(uint32_t count) const {
+	return (count + ENTITY_BLOCK_SIZE - 1) / ENTITY_BLOCK_SIZE;
+}
+
+void EntitySegment::GetEpochName(char* out, size_t outSize, uint32_t epoch) const {
+	if (epoch == 0)
+		snprintf(out, outSize, "%s", m_name);
+	else
+		snprintf(out, outSize, "%s.%u", m_name, epoch);
+}
+
+EntitySegmentHeader* EntitySegment::GetRootHeader() const {
+	return m_root.IsOpen() ? (EntitySegmentHeader*)m_root.GetView() : m_header;
+}
+
+bool EntitySegment::IsRedirected() const {
+	return m_header->redirectEpoch.load(std::memory_order_acquire) > m_header->epoch;
+}
+
+// ZORA: Move over to the newest segment. The epoch 0 segment always knows which one that is, even if the segment in use was replaced more than once.
+bool EntitySegment::FollowRedirect() {
+	uint32_t epoch = GetRootHeader()->redirectEpoch.load(std::memory_order_acquire);
+	if (epoch <= m_header->epoch)
+		return false;
+
+	char name[sizeof(m_name) + 16];
+	GetEpochName(name, sizeof(name), epoch);
+	SharedMemory memory;
+	if (!OpenSegmentMemory(memory, name, true))
+		return false;
+
+	// ZORA: A reader moves its registry entry across with it
+	bool reader = m_partition == nullptr;
+	if (reader)
+		UnregisterReader();
+
+	UseSegment(memory);
+
+	if (reader) {
+		ResetReadState();
+		RegisterReader();
+		return true;
+	}
+
+	// ZORA: The resizing producer has already set this range up in the new segment, in the same partition as before
+	m_partition = &m_header->partitions[m_partitionIndex];
+	if (m_partition->processId.load(std::memory_order_acquire) != GetCurrentProcessIdentifier()) {
+		m_partition = nullptr;
+#ifndef NDEBUG
+		std::cout << "Entity segment " << name << " has no range for this producer" << std::endl;
+#endif
+		return false;
+	}
+
+	ResetWriteState(m_partition->capacity.load(std::memory_order_relaxed));
+	return true;
+}
+
+// ZORA: Swap 'memory' in as the segment in use. The epoch 0 segment is kept open for its redirect, and anything in between is closed, which also removes it if this application created it.
+void EntitySegment::UseSegment(SharedMemory& memory) {
+	if (!m_root.IsOpen())
+		m_root.Swap(m_memory);
+	m_memory.Swap(memory);
+	memory.Close();
+	m_header = (EntitySegmentHeader*)m_memory.GetView();
+}
+
+// ZORA: Nothing the reader holds can be patched from a different segment, so start again as if the segment had just been opened
+void EntitySegment::ResetReadState() {
+	m_readBlockGenerations.assign(GetBlockCount(m_header->capacity), INVALID_BLOCK_GENERATION);
+	for (auto& placement : m_readPlacements)
+		placement = PartitionPlacement{ 0, 0, 0, 0 };
+	m_readHandleEntities.clear();
+	m_readCount = 0;
+	m_readPublishedUs = 0;
+}
+
+// ZORA: Every block and every handle of a new range, or a range in a new segment, is dirty until it has been published once
+void EntitySegment::ResetWriteState(uint32_t capacity) {
+	m_dirtyBlocks.assign(GetBlockCount(capacity), 1);
+	m_blockGenerations.assign(GetBlockCount(capacity), 0);
+	m_publishedCount = 0;
+	m_handlesPublished = false;
+}
+
+// ZORA: Claiming a range is rare and quick, so a spin lock is enough. A producer that crashed while holding it can't be waited on forever, so after a while the lock is taken over.
+bool EntitySegment::LockPartitions() {
+	uint32_t processId = GetCurrentProcessIdentifier();
+	uint64_t start = GetMonotonicMilliseconds();
+
+	while (true) {
+		uint32_t holder = 0;
+		if (m_header->partitionLock.compare_exchange_weak(holder, processId, std::memory_order_acquire))
+			return true;
+
+		if (GetMonotonicMilliseconds() - start > ENTITY_READER_TIMEOUT_MS)
+			return m_header->partitionLock.compare_exchange_strong(holder, processId, std::memory_order_acquire);
+
+		std::this_thread::yield();
+	}
+}
+
+void EntitySegment::UnlockPartitions() {
+	m_header->partitionLock.store(0, std::memory_order_release);
+}
+
+// ZORA: Claim a free entry in the reader registry, or take over the entry of a reader that stopped checking in. If every entry is in use the reader still works, it just isn't reported.
+void EntitySegment::RegisterReader() {
+	uint32_t processId = GetCurrentProcessIdentifier();
+	uint64_t now = GetMonotonicMilliseconds();
+
+	for (auto& reader : m_header->readers) {
+		uint32_t current = reader.processId.load(std::memory_order_relaxed);
+		uint64_t heartbeat = reader.heartbeat.load(std::memory_order_relaxed);
+		bool stale = now > heartbeat && now - heartbeat > ENTITY_READER_TIMEOUT_MS;
+		if (current != 0 && !stale)
+			continue;
+
+		// ZORA: Another reader may be racing for the same entry, so only one compare-exchange wins it
+		if (reader.processId.compare_exchange_strong(current, processId)) {
+			reader.lastSeenGeneration.store(0, std::memory_order_relaxed);
+			reader.heartbeat.store(now, std::memory_order_release);
+			m_readerSlot = &reader;
+			return;
+		}
+	}
+}
+
+void EntitySegment::UnregisterReader() {
+	if (m_readerSlot != nullptr) {
+		m_readerSlot->processId.store(0, std::memory_order_release);
+		m_readerSlot = nullptr;
+	}
+}
+
+void EntitySegment::ReaderHeartbeat() {
+	if (m_readerSlot != nullptr) {
+		m_readerSlot->lastSeenGeneration.store(m_readGeneration, std::memory_order_relaxed);
+		m_readerSlot->heartbeat.store(GetMonotonicMilliseconds(), std::memory_order_release);
+	}
+}
+
+// ZORA: Never hand a reader more entities than there is room for, whatever the header says
+uint32_t EntitySegment::ClampCount(uint32_t count, uint32_t capacity) const {
+	return count < capacity ? count : capacity;
+}
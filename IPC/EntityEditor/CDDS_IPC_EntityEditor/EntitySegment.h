@@ -0,0 +1,299 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Entity.h"
+#include "EntityColumns.h"
+#include "EntityHandle.h"
+#include "EntityTransport.h"
+#include "FrameSignal.h"
+#include "SharedMemory.h"
+
+// ZORA: Written at the front of the segment so that a reader can tell it has found an entity segment, and one laid out the way it expects
+const uint32_t ENTITY_SEGMENT_MAGIC = 0x544E4545;	// 'EENT'
+const uint32_t ENTITY_SEGMENT_VERSION = 12;
+
+// ZORA: The number of entity arrays in the segment. With three, the Editor always has one to write into that is neither the newest frame nor the one before it.
+const uint32_t ENTITY_SLOT_COUNT = 3;
+
+// ZORA: Entities are tracked for changes in blocks of this many. A block of 16 is six cache lines, small enough that editing one entity copies very little and large enough that the table of block generations stays tiny.
+const uint32_t ENTITY_BLOCK_SIZE = 16;
+
+// ZORA: The most readers that can register with one segment. Readers beyond this still work, they just aren't reported to the Editor.
+const uint32_t ENTITY_MAX_READERS = 64;
+
+// ZORA: The most producers that can publish into one segment at the same time, each into its own range of entities
+const uint32_t ENTITY_MAX_PARTITIONS = 8;
+
+// ZORA: A reader that hasn't checked in for this long is considered gone, and its registry slot may be reused
+const uint64_t ENTITY_READER_TIMEOUT_MS = 2000;
+
+// ZORA: A producer that hasn't published for this long is reported as stalled. The Editor publishes every frame, even when nothing has changed, so this is a dozen or so missed frames.
+const uint64_t ENTITY_PRODUCER_STALL_MS = 250;
+
+// ZORA: How often a reader without a live producer looks for a segment created by a new Editor. Well under a frame, so a new Editor is picked up before the Display's next frame.
+const uint64_t ENTITY_REATTACH_POLL_MS = 4;
+
+// ZORA: How the entities in each slot are laid out. The creator picks one and everybody else follows the header.
+enum EntitySegmentLayout : uint32_t {
+	ENTITY_LAYOUT_STRUCTS = 0,		// ZORA: An array of Entity structs
+	ENTITY_LAYOUT_COLUMNS = 1		// ZORA: A column per field, laid out by MakeEntityColumns, so a producer that keeps its entities in columns copies them across without rearranging them
+};
+
+// ZORA: How a reader sees a producer publishing into its segment, worst last
+enum EntityProducerState : uint32_t {
+	ENTITY_PRODUCER_LIVE = 0,		// ZORA: The producer has published recently
+	ENTITY_PRODUCER_STALLED = 1,	// ZORA: The producer is still running but hasn't published for ENTITY_PRODUCER_STALL_MS
+	ENTITY_PRODUCER_DEAD = 2,		// ZORA: The producer's process has gone without releasing its range, most likely a crash
+	ENTITY_PRODUCER_ABSENT = 3		// ZORA: There is no segment yet, or no producer has a range in it
+};
+
+// ZORA: The bookkeeping for one partition's share of one entity array in the segment. Each slot sits on its own cache line so publishing into one doesn't disturb readers of another.
+struct alignas(64) EntitySlotHeader {
+	std::atomic<uint32_t> sequence;		// ZORA: The seqlock guarding this slot. Odd while the producer is part way through a copy, even once the copy is complete.
+	std::atomic<uint32_t> count;		// ZORA: The number of live entities in this slot
+	std::atomic<uint64_t> generation;	// ZORA: The generation of the frame held in this slot
+	std::atomic<uint64_t> publishedUs;	// ZORA: GetMonotonicMicroseconds() when the producer started publishing it, for measuring how old it is by the time it is drawn
+};
+
+// ZORA: One producer's range of entities. Every partition is triple buffered on its own, with its own newest slot and its own seqlocks, so producers never wait for each other either.
+struct alignas(64) EntityPartition {
+	std::atomic<uint32_t> processId;	// ZORA: The producer that claimed this range, or 0 if the partition is free. Written last when claiming, so 'first' and 'capacity' are already valid when a reader sees it.
+	std::atomic<uint32_t> first;		// ZORA: The index of the first entity in the range. Always a multiple of ENTITY_BLOCK_SIZE, so no two producers ever share a block.
+	std::atomic<uint32_t> capacity;		// ZORA: The number of entities the range has room for
+	std::atomic<uint32_t> latestSlot;	// ZORA: The slot holding this range's newest complete frame
+	std::atomic<uint64_t> heartbeat;	// ZORA: GetMonotonicMilliseconds() when the producer claimed the range or last published into it
+
+	EntitySlotHeader slots[ENTITY_SLOT_COUNT];
+};
+
+// ZORA: One reader's entry in the registry. Each reader only ever writes its own entry, and each entry sits on its own cache line.
+struct alignas(64) EntityReaderSlot {
+	std::atomic<uint32_t> processId;			// ZORA: The process that claimed this entry, or 0 if it is free
+	std::atomic<uint64_t> lastSeenGeneration;	// ZORA: The generation of the newest frame this reader has copied
+	std::atomic<uint64_t> heartbeat;			// ZORA: GetMonotonicMilliseconds() when this reader last checked in
+};
+
+// ZORA: What the Editor can find out about one registered reader
+struct EntityReaderStatus {
+	uint32_t processId;
+	uint64_t lastSeenGeneration;
+	uint64_t framesBehind;
+	uint64_t millisecondsSinceHeartbeat;
+};
+
+// ZORA: A Display's long-lived reference to an entity in the segment. A handle only means something to the producer that gave it out, so the reference remembers which producer that was as well as where its range is.
+struct EntitySegmentHandle {
+	uint32_t partition;
+	uint32_t processId;
+	EntityHandle handle;
+};
+
+// ZORA: The header at the front of the entity segment. Everything a reader needs to make sense of the payload travels in the same block of shared memory as the payload itself.
+struct EntitySegmentHeader {
+	std::atomic<uint32_t> magic;		// ZORA: Written last by the creator, so a reader never validates a half-initialised header
+	uint32_t version;					// ZORA: Bumped whenever the layout of the segment changes
+	uint32_t capacity;					// ZORA: The number of entities each slot has room for, across every partition
+	uint32_t entitySize;				// ZORA: sizeof(Entity) in the creating application
+	uint32_t layout;					// ZORA: How each slot's entities are laid out, one of EntitySegmentLayout
+	uint32_t slotCount;					// ZORA: The number of entity arrays that follow the header
+	uint32_t payloadOffset;				// ZORA: The byte offset from the front of the segment to the first entity of the first slot
+	uint32_t blockSize;					// ZORA: The number of entities in each change-tracked block
+	uint32_t blockTableOffset;			// ZORA: The byte offset to each slot's table of block generations, one uint64_t per block
+	uint32_t handleSlotsOffset;			// ZORA: The byte offset to the handle table, one slot packed by PackEntityHandleSlot for every entity the segment has room for. Each producer's handles sit in its own range, like its entities.
+	uint32_t handleEntitiesOffset;		// ZORA: The byte offset to each slot's handle slot for every entity, one uint32_t per entity, published block by block along with the entities
+	uint32_t epoch;						// ZORA: 0 for the segment created under the plain name, then one more for each resize. Segment N is named "<name>.N".
+	std::atomic<uint32_t> redirectEpoch;	// ZORA: Set once a resize has replaced this segment. In the segment with epoch 0 it always holds the epoch of the newest segment, so anybody can find it from the plain name.
+	std::atomic<uint64_t> generation;	// ZORA: Incremented every time any producer publishes a frame, so every frame of every partition has a generation of its own
+	std::atomic<uint32_t> frameSignal;	// ZORA: Incremented after every publish. This is the word readers sleep on while waiting for a new frame, so it is 32 bits to suit a futex.
+	std::atomic<uint32_t> waiters;		// ZORA: The number of readers asleep on frameSignal, so producers only make a wake-up call when somebody is listening
+	std::atomic<uint32_t> partitionLock;	// ZORA: The process id of the producer currently claiming a range, or 0. Only taken while claiming, never while publishing or reading.
+	uint32_t creatorProcessId;			// ZORA: The Editor that created the segment under the plain name. Carried across resizes.
+	uint64_t createdMs;					// ZORA: GetMonotonicMilliseconds() when it did. Together with creatorProcessId this tells one Editor's segment from the next one created under the same name.
+
+	EntityPartition partitions[ENTITY_MAX_PARTITIONS];
+	EntityReaderSlot readers[ENTITY_MAX_READERS];
+};
+
+// ZORA: A single block of named shared memory holding a header followed by three arrays of entities, the slots. Each slot holds either Entity structs or a column per field, whichever the creator asked for; producers can publish either way into either layout and readers always get Entity structs back.
+// One Editor creates it, and every Editor that publishes into it (the creator included) claims a disjoint range of entities, its partition. Each producer publishes every frame of its range into that partition's oldest slot, then makes that slot the newest with one atomic store.
+// The Display opens it with one call, validates the layout and copies the newest complete frame of every partition, one after the other, into a single vector.
+// Only blocks that changed are copied. Each slot has a table holding, for every block, the generation in which that block last changed. The Editor copies a block into a slot only when the slot's stamp is behind, and the Display patches a block only when its own stamp differs from the slot's.
+// Each slot is also guarded by a seqlock, so a Display slow enough to still be copying when the Editor comes round to its slot again notices and retries with the newest one.
+// Every slot also holds the handle slot of each of its entities, and alongside the slots sits a single copy of every producer's handle table, so the Display can hold on to an entity by handle and find it again however the producer has rearranged its entities since. The table is written just before each frame is published, so it may be a frame ahead of a reader's snapshot; the reader checks what the table says against the handle slots it copied with the snapshot, so it never finds the wrong entity.
+// No producer ever waits for the Display or for another producer, and no mutex is taken while publishing or reading, so every process runs at its own frame rate.
+// Every producer stamps its partition with a heartbeat as it publishes, so a reader can tell a producer that has stalled or crashed from one that is simply idle. A reader left without a single live producer keeps looking for a segment created by a new Editor under the same name, and moves to it by itself.
+// A segment can't grow in place, so a producer that needs more room creates a bigger one under a new epoch, carries every partition's newest frame across, and then redirects the old segment to it. Everybody else notices the redirect on their next Publish, ReadSnapshot or WaitForFrame and moves across, while still reading the old segment safely up to its own capacity until then.
+class EntitySegment : public EntityPublisher, public EntitySubscriber {
+public:
+	EntitySegment();
+	~EntitySegment();
+
+	// ZORA: Create a segment with room for 'capacity' entities in each slot, laid out as 'layout'. Returns false if 'capacity' is 0 or the shared memory could not be created.
+	// If producers are still running in a segment already under 'name', as when the first Editor is restarted while the others carry on, this joins that segment as Open does, keeping its capacity and layout. Recreating it would leave them publishing into one no reader opens any more.
+	bool Create(const char* name, uint32_t capacity, EntitySegmentLayout layout = ENTITY_LAYOUT_STRUCTS);
+
+	// ZORA: Open a segment created by another application. Returns false if it doesn't exist or its layout doesn't match this application's.
+	// A reader that fails to open still remembers the name, and WaitForFrame keeps looking for the segment, so a Display can be started before the Editor.
+	bool Open(const char* name);
+
+	// ZORA: Claim 'capacity' entities starting at 'first' for this application to publish into. 'first' must be a multiple of ENTITY_BLOCK_SIZE and the range must not overlap any other producer's.
+	// Returns false if the range doesn't fit, overlaps, or every partition is taken. An application that claims a range is a producer, so it stops being reported as a reader.
+	bool ClaimRange(uint32_t first, uint32_t capacity);
+
+	// ZORA: Move the claimed range to a new segment with room for 'capacity' entities in the range, leaving every other producer's range where it was relative to its neighbours. Entities past the new capacity are dropped.
+	// Returns false if the new segment could not be created or another producer is resizing at the same time, in which case the old segment is still in use and the call can be tried again.
+	bool Resize(uint32_t capacity) override;
+
+	void Close();
+
+	// ZORA: Record that the entity at 'index' within the claimed range has changed since the last Publish, so its block is copied next time
+	void MarkDirty(uint32_t index) override;
+	void MarkAllDirty() override;
+
+	// ZORA: Bring the oldest slot of the claimed range up to date with 'count' entities, copying only the blocks that changed since that slot was last written, and make it the newest frame. 'entities[0]' is the first entity of the range.
+	void Publish(const Entity* entities, uint32_t count) override;
+
+	// ZORA: As Publish, from entities held column by column. Into a column segment each changed block is copied a column at a time, with nothing rearranged.
+	bool AcceptsColumns() const override;
+	void PublishColumns(const EntityColumns& columns, uint32_t count) override;
+
+	// ZORA: Copy the slots of 'handles' that changed since the last call into the claimed range's handle table, and mark the entities they refer to dirty so the next Publish sends their handle slots along with them. The first call after claiming a range or moving to a new segment copies every slot.
+	// 'handles' must stay where it is until the next call, as Publish reads from it.
+	void PublishHandles(const EntityHandleTable& handles) override;
+
+	// ZORA: Bring 'entities' up to date with the newest complete frame of every partition, patching only the blocks that changed since the last call. Pass the same vector every time.
+	// The partitions follow each other in the vector in partition order, with no gaps between them. Each partition is internally consistent; partitions are published independently, so each is as new as its producer has made it.
+	// While any producer is live, the range of a producer whose process has gone is left out, so nothing it left behind is drawn or selected as if it were still being updated. With no live producer at all, every range is kept, so the last picture stays up until a new Editor arrives.
+	// Returns false, leaving 'entities' untouched, if every retry of any partition was torn.
+	bool ReadSnapshot(std::vector<Entity>& entities) override;
+
+	// ZORA: Sleep until a frame newer than 'generation' has been published, or until 'timeoutMs' milliseconds pass. Returns true if there is a newer frame.
+	// While not a single producer is live this wakes every ENTITY_REATTACH_POLL_MS to look for a segment created by a new Editor, and returns true once it has moved to one.
+	bool WaitForFrame(uint64_t generation, int timeoutMs) override;
+
+	// ZORA: The segment generation when ReadSnapshot last started copying
+	uint64_t GetSnapshotGeneration() const override;
+
+	// ZORA: When the oldest partition in the last snapshot was published, so the snapshot is never reported as newer than any of it
+	uint64_t GetSnapshotPublishedUs() const override;
+
+	// ZORA: Fill 'readers' with every registered reader that has checked in recently, and return how many are more than 'maxFramesBehind' frames behind the newest frame
+	uint32_t GetReaders(std::vector<EntityReaderStatus>& readers, uint64_t maxFramesBehind) const;
+
+	// ZORA: The best state of any producer with a range in the segment, so the segment counts as live while any producer is still publishing into it, for showing the user that the entities on screen are no longer being updated
+	EntityProducerState GetProducerState() const;
+
+	// ZORA: The number of producers with a range in the segment that are in 'state', for telling the user about the ones that have stalled or gone while the others carry on
+	uint32_t GetProducerCount(EntityProducerState state) const;
+
+	// ZORA: Reader side. Move to a segment created by a new Editor under the same name since this one was opened. Returns false if there is none, or it is the segment already in use.
+	bool Reattach();
+
+	// ZORA: The number of times Reattach has moved to a new Editor's segment. Anything opened against the old Editor, such as its command rings, is stale once this changes.
+	uint32_t GetReattachCount() const;
+
+	uint32_t GetCapacity() const override;
+	// ZORA: The number of entities the claimed range has room for, or 0 if no range is claimed
+	uint32_t GetRangeCapacity() const override;
+	// ZORA: The partition holding the claimed range. Stays the same across resizes.
+	uint32_t GetPartitionIndex() const;
+
+	// ZORA: Work out which partition the entity at 'snapshotIndex' of the last ReadSnapshot came from, and its index within that partition's range. Returns false if the index is past the end of the snapshot.
+	bool FindSnapshotEntity(size_t snapshotIndex, uint32_t& partition, uint32_t& index) const;
+
+	// ZORA: The handle of the entity at 'snapshotIndex' of the last ReadSnapshot. Returns false if there is none, or the entity has already moved or gone in the producer's newer frame, rather than hand out a handle to the wrong entity.
+	bool FindSnapshotHandle(size_t snapshotIndex, EntitySegmentHandle& handle) const;
+
+	// ZORA: Where 'handle''s entity is in the last ReadSnapshot. Returns false if it has been despawned, or its producer has gone.
+	bool FindHandleSnapshotIndex(const EntitySegmentHandle& handle, size_t& snapshotIndex) const;
+	uint64_t GetGeneration() const;
+
+	int GetErrorCode() const;
+
+private:
+	EntitySegment(const EntitySegment&) = delete;
+	EntitySegment& operator=(const EntitySegment&) = delete;
+
+	char* GetSlotPayload(uint32_t slot) const;
+	Entity* GetSlotEntities(uint32_t slot) const;
+	EntityColumns GetSlotColumns(uint32_t slot) const;
+	void PublishFrame(const Entity* entities, const EntityColumns* columns, uint32_t count);
+	uint64_t* GetSlotBlockGenerations(uint32_t slot) const;
+	std::atomic<uint64_t>* GetHandleSlots() const;
+	uint32_t* GetSlotHandleEntities(uint32_t slot) const;
+	bool GetHandleRange(const EntityPartition& partition, uint32_t& first, uint32_t& capacity) const;
+	void PublishHandle(const EntityHandleTable& handles, uint32_t index, uint32_t first, uint32_t capacity);
+	uint32_t GetBlockCount(uint32_t count) const;
+	uint32_t ClampCount(uint32_t count, uint32_t capacity) const;
+
+	void GetEpochName(char* out, size_t outSize, uint32_t epoch) const;
+	EntitySegmentHeader* GetRootHeader() const;
+	bool IsRedirected() const;
+	bool FollowRedirect();
+	void UseSegment(SharedMemory& memory);
+	void ResetReadState();
+	void ResetWriteState(uint32_t capacity);
+
+	EntityProducerState GetPartitionState(const EntityPartition& partition, uint64_t now) const;
+	uint64_t GetMillisecondsUntilStall() const;
+
+	bool LockPartitions();
+	void UnlockPartitions();
+
+	void RegisterReader();
+	void UnregisterReader();
+	void ReaderHeartbeat();
+
+	// ZORA: The name passed to Create or Open, the segment in use, and the segment with epoch 0 once a resize has moved everybody off it. That one is kept open because it always knows where the newest segment is.
+	char m_name[256];
+	SharedMemory m_memory;
+	SharedMemory m_root;
+	FrameSignal m_signal;
+	EntitySegmentHeader* m_header;
+
+	// ZORA: The creator of the segment in use, as it was when the segment was opened. A segment under the same name with a different creator belongs to a new Editor.
+	uint32_t m_creatorProcessId;
+	uint64_t m_createdMs;
+	uint32_t m_reattachCount;
+
+	// ZORA: Writer side: the claimed partition, blocks marked dirty since the last Publish, the generation in which each block last changed, and the count published last time. Block indices are relative to the start of the range.
+	EntityPartition* m_partition;
+	uint32_t m_partitionIndex;
+	std::vector<uint8_t> m_dirtyBlocks;
+	std::vector<uint64_t> m_blockGenerations;
+	uint32_t m_publishedCount;
+	const EntityHandleTable* m_handles;
+	bool m_handlesPublished;
+
+	// ZORA: Where one partition sat in the caller's vector last time. A partition that has moved, or changed hands, is copied in full.
+	struct PartitionPlacement {
+		uint32_t processId;
+		uint32_t first;
+		uint32_t offset;
+		uint32_t count;
+	};
+
+	// ZORA: One changed block waiting to be patched into the caller's vector
+	struct StagedBlock {
+		uint32_t block;			// ZORA: The block's index in the segment
+		uint32_t offset;		// ZORA: Where its first entity goes in the caller's vector
+		uint32_t length;
+		uint64_t generation;
+	};
+
+	// ZORA: Reader side: the generation of each block in the caller's vector, indexed by the block's place in the segment. Changed blocks are staged first, so a torn copy never reaches the caller.
+	std::vector<uint64_t> m_readBlockGenerations;
+	PartitionPlacement m_readPlacements[ENTITY_MAX_PARTITIONS];
+	size_t m_readCount;
+	uint64_t m_readGeneration;
+	uint64_t m_readPublishedUs;
+	EntityReaderSlot* m_readerSlot;
+	std::vector<StagedBlock> m_changedBlocks;
+	std::vector<Entity> m_staging;
+
+	// ZORA: Reader side: the handle slot of every entity in the caller's vector, patched along with it, and the staging for them
+	std::vector<uint32_t> m_readHandleEntities;
+	std::vector<uint32_t> m_stagingHandles;
+};
@@ -0,0 +1,515 @@
+#include "EntitySocket.h"
+#include "EntitySegment.h"
+#include "Platform.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// ZORA: How much the reader asks the socket for at a time while it waits for the rest of a frame
+static const size_t RECEIVE_CHUNK = 64 * 1024;
+
+// ZORA: The kernel buffer asked for on each end. The default is a couple of hundred kilobytes, which would take a frame of a million entities over a hundred Publishes to get through.
+static const int SOCKET_BUFFER_BYTES = 8 * 1024 * 1024;
+
+EntitySocket::EntitySocket() : m_fd(-1), m_listening(false), m_errorCode(0), m_publishedCount(0), m_generation(0), m_publishedUs(0), m_receiveLength(0), m_frameGeneration(0), m_framePublishedUs(0), m_readCount(0), m_readGeneration(0), m_readPublishedUs(0) {
+	m_path[0] = '\0';
+}
+
+EntitySocket::~EntitySocket() {
+	Close();
+}
+
+#ifdef _WIN32
+
+bool EntitySocket::Listen(const char* path) {
+	Close();
+	m_errorCode = -1;
+	return false;
+}
+
+bool EntitySocket::Connect(const char* path) {
+	Close();
+	m_errorCode = -1;
+	return false;
+}
+
+void EntitySocket::Close() {
+	m_clients.clear();
+	m_frame.clear();
+}
+
+void EntitySocket::Publish(const Entity* entities, uint32_t count) {
+
+}
+
+void EntitySocket::AcceptClients() {
+
+}
+
+bool EntitySocket::FlushClient(Client& client) {
+	return false;
+}
+
+bool EntitySocket::SendFrame(Client& client, const Entity* entities, const std::vector<EntityFrameRun>& runs) {
+	return false;
+}
+
+bool EntitySocket::Receive() {
+	return false;
+}
+
+bool EntitySocket::WaitForFrame(uint64_t generation, int timeoutMs) {
+	return false;
+}
+
+#else
+
+// ZORA: Neither end ever waits on the other, so every socket is non-blocking. The kernel may give less buffer than asked for, which only costs speed, so that isn't checked.
+static bool SetNonBlocking(int fd) {
+	int bufferBytes = SOCKET_BUFFER_BYTES;
+	setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &bufferBytes, sizeof(bufferBytes));
+	setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bufferBytes, sizeof(bufferBytes));
+
+	int flags = fcntl(fd, F_GETFL, 0);
+	return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+static bool MakeAddress(sockaddr_un& address, const char* path) {
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(address.sun_path))
+		return false;
+	strcpy(address.sun_path, path);
+	return true;
+}
+
+bool EntitySocket::Listen(const char* path) {
+	Close();
+
+	sockaddr_un address;
+	if (!MakeAddress(address, path)) {
+		m_errorCode = ENAMETOOLONG;
+		return false;
+	}
+
+	m_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (m_fd < 0) {
+		m_errorCode = errno;
+		return false;
+	}
+
+	// ZORA: Like a POSIX shared memory name, a socket path outlives a crashed Editor, so clear it out before binding
+	unlink(path);
+	if (bind(m_fd, (sockaddr*)&address, sizeof(address)) != 0 || listen(m_fd, (int)ENTITY_SOCKET_MAX_CLIENTS) != 0 || !SetNonBlocking(m_fd)) {
+		m_errorCode = errno;
+		Close();
+		return false;
+	}
+
+	m_listening = true;
+	snprintf(m_path, sizeof(m_path), "%s", path);
+	m_dirtyBlocks.clear();
+	m_publishedCount = 0;
+	m_generation = 0;
+	return true;
+}
+
+bool EntitySocket::Connect(const char* path) {
+	Close();
+
+	sockaddr_un address;
+	if (!MakeAddress(address, path)) {
+		m_errorCode = ENAMETOOLONG;
+		return false;
+	}
+
+	m_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (m_fd < 0) {
+		m_errorCode = errno;
+		return false;
+	}
+
+	if (connect(m_fd, (sockaddr*)&address, sizeof(address)) != 0 || !SetNonBlocking(m_fd)) {
+		m_errorCode = errno;
+		Close();
+		return false;
+	}
+
+	m_receive.resize(RECEIVE_CHUNK);
+	m_receiveLength = 0;
+	m_frame.clear();
+	m_frameGeneration = 0;
+	m_framePublishedUs = 0;
+	m_changedBlocks.clear();
+	m_readCount = 0;
+	m_readGeneration = 0;
+	m_readPublishedUs = 0;
+	return true;
+}
+
+void EntitySocket::Close() {
+	for (auto& client : m_clients)
+		close(client.fd);
+	m_clients.clear();
+
+	if (m_fd >= 0) {
+		close(m_fd);
+		m_fd = -1;
+	}
+
+	// ZORA: Only the Editor removes the path, the same as only the creator unlinks shared memory
+	if (m_listening) {
+		unlink(m_path);
+		m_listening = false;
+	}
+	m_path[0] = '\0';
+}
+
+void EntitySocket::AcceptClients() {
+	while (m_clients.size() < ENTITY_SOCKET_MAX_CLIENTS) {
+		int fd = accept(m_fd, nullptr, nullptr);
+		if (fd < 0)
+			return;
+
+		if (!SetNonBlocking(fd)) {
+			close(fd);
+			continue;
+		}
+
+		// ZORA: A new Display has nothing, so its first frame carries everything
+		m_clients.push_back(Client{ fd, std::vector<char>(), 0, true });
+	}
+}
+
+// ZORA: Send as much of the unfinished frame as the socket will take. Returns false if the Display has gone.
+bool EntitySocket::FlushClient(Client& client) {
+	while (client.pendingOffset < client.pending.size()) {
+		ssize_t sent = send(client.fd, client.pending.data() + client.pendingOffset, client.pending.size() - client.pendingOffset, MSG_NOSIGNAL | MSG_DONTWAIT);
+		if (sent < 0)
+			return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+		client.pendingOffset += (size_t)sent;
+	}
+
+	client.pending.clear();
+	client.pendingOffset = 0;
+	return true;
+}
+
+// ZORA: Gather the header, the runs and every run of entities into one call, straight out of the Editor's array. sendmsg is writev with flags, so a Display disconnecting mid-frame returns an error rather than raising SIGPIPE.
+// Whatever the socket won't take now is copied aside and finished on later Publishes, since the Editor's array will have changed by then. Returns false if the Display has gone.
+bool EntitySocket::SendFrame(Client& client, const Entity* entities, const std::vector<EntityFrameRun>& runs) {
+	EntityFrameHeader header;
+	header.magic = ENTITY_FRAME_MAGIC;
+	header.runCount = (uint32_t)runs.size();
+	header.generation = m_generation;
+	header.count = m_publishedCount;
+	header.reserved = 0;
+	header.payloadBytes = 0;
+	header.publishedUs = m_publishedUs;
+
+	iovec parts[ENTITY_SOCKET_MAX_RUNS + 2];
+	size_t partCount = 0;
+	parts[partCount++] = iovec{ &header, sizeof(header) };
+	if (!runs.empty())
+		parts[partCount++] = iovec{ (void*)runs.data(), sizeof(EntityFrameRun) * runs.size() };
+	for (const auto& run : runs) {
+		parts[partCount++] = iovec{ (void*)(entities + run.first), sizeof(Entity) * run.length };
+		header.payloadBytes += sizeof(Entity) * run.length;
+	}
+
+	size_t total = 0;
+	for (size_t i = 0; i < partCount; i++)
+		total += parts[i].iov_len;
+
+	msghdr message;
+	memset(&message, 0, sizeof(message));
+	message.msg_iov = parts;
+	message.msg_iovlen = partCount;
+
+	ssize_t sent = sendmsg(client.fd, &message, MSG_NOSIGNAL | MSG_DONTWAIT);
+	if (sent < 0) {
+		if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+			return false;
+		sent = 0;
+	}
+
+	// ZORA: Keep the rest of the frame, skipping the parts that did go
+	size_t skip = (size_t)sent;
+	client.pending.clear();
+	client.pendingOffset = 0;
+	if (skip < total) {
+		client.pending.reserve(total - skip);
+		for (size_t i = 0; i < partCount; i++) {
+			const char* part = (const char*)parts[i].iov_base;
+			size_t length = parts[i].iov_len;
+			if (skip >= length) {
+				skip -= length;
+				continue;
+			}
+			client.pending.insert(client.pending.end(), part + skip, part + length);
+			skip = 0;
+		}
+	}
+
+	client.needsFull = false;
+	return true;
+}
+
+// ZORA: Read everything the socket has for us without waiting. Returns false if the Editor has gone.
+bool EntitySocket::Receive() {
+	while (true) {
+		if (m_receive.size() - m_receiveLength < RECEIVE_CHUNK)
+			m_receive.resize(m_receiveLength + RECEIVE_CHUNK);
+
+		ssize_t received = recv(m_fd, m_receive.data() + m_receiveLength, m_receive.size() - m_receiveLength, MSG_DONTWAIT);
+		if (received > 0) {
+			m_receiveLength += (size_t)received;
+			continue;
+		}
+
+		if (received == 0)
+			return false;
+		return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+	}
+}
+
+bool EntitySocket::WaitForFrame(uint64_t generation, int timeoutMs) {
+	if (m_fd < 0 || m_listening)
+		return false;
+
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+
+	while (true) {
+		if (!Receive() || !ApplyFrames()) {
+			Close();
+			return false;
+		}
+
+		if (m_frameGeneration != generation)
+			return true;
+
+		auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+		if (remaining <= 0)
+			return false;
+
+		// ZORA: Sleep in the kernel until the Editor sends something
+		pollfd wait = { m_fd, POLLIN, 0 };
+		poll(&wait, 1, (int)remaining);
+	}
+}
+
+void EntitySocket::Publish(const Entity* entities, uint32_t count) {
+	if (!m_listening)
+		return;
+
+	AcceptClients();
+	count = std::min(count, ENTITY_SOCKET_MAX_COUNT);
+
+	// ZORA: Entities that came or went since last time change the blocks they live in
+	uint32_t blockCount = (count + ENTITY_BLOCK_SIZE - 1) / ENTITY_BLOCK_SIZE;
+	if (m_dirtyBlocks.size() < blockCount)
+		m_dirtyBlocks.resize(blockCount, 1);
+	if (count != m_publishedCount) {
+		uint32_t firstBlock = std::min(count, m_publishedCount) / ENTITY_BLOCK_SIZE;
+		for (uint32_t block = firstBlock; block < blockCount; block++)
+			m_dirtyBlocks[block] = 1;
+		m_publishedCount = count;
+	}
+
+	// ZORA: Join neighbouring dirty blocks into runs, and give up on runs altogether once there are too many of them
+	m_runs.clear();
+	for (uint32_t block = 0; block < blockCount; block++) {
+		if (!m_dirtyBlocks[block])
+			continue;
+
+		uint32_t first = block * ENTITY_BLOCK_SIZE;
+		uint32_t length = std::min(ENTITY_BLOCK_SIZE, count - first);
+		if (!m_runs.empty() && m_runs.back().first + m_runs.back().length == first)
+			m_runs.back().length += length;
+		else
+			m_runs.push_back(EntityFrameRun{ first, length });
+	}
+	std::fill(m_dirtyBlocks.begin(), m_dirtyBlocks.end(), 0);
+
+	m_fullRun.clear();
+	if (count > 0)
+		m_fullRun.push_back(EntityFrameRun{ 0, count });
+	if (m_runs.size() > ENTITY_SOCKET_MAX_RUNS)
+		m_runs = m_fullRun;
+
+	m_generation++;
+	m_publishedUs = GetMonotonicMicroseconds();
+
+	for (size_t i = 0; i < m_clients.size();) {
+		Client& client = m_clients[i];
+		bool connected = FlushClient(client);
+
+		// ZORA: Still sending an older frame, so this one is skipped. Having missed it, the Display needs everything next time.
+		if (connected && !client.pending.empty())
+			client.needsFull = true;
+		else if (connected)
+			connected = SendFrame(client, entities, client.needsFull ? m_fullRun : m_runs);
+
+		if (!connected) {
+#ifndef NDEBUG
+			std::cout << "Display disconnected from entity socket " << m_path << std::endl;
+#endif
+			close(client.fd);
+			m_clients.erase(m_clients.begin() + i);
+			continue;
+		}
+		i++;
+	}
+}
+
+#endif
+
+bool EntitySocket::IsOpen() const {
+	return m_fd >= 0;
+}
+
+void EntitySocket::MarkDirty(uint32_t index) {
+	uint32_t block = index / ENTITY_BLOCK_SIZE;
+	if (block >= m_dirtyBlocks.size())
+		m_dirtyBlocks.resize(block + 1, 1);
+	m_dirtyBlocks[block] = 1;
+}
+
+void EntitySocket::MarkAllDirty() {
+	std::fill(m_dirtyBlocks.begin(), m_dirtyBlocks.end(), 1);
+}
+
+uint32_t EntitySocket::GetRangeCapacity() const {
+	return ENTITY_SOCKET_MAX_COUNT;
+}
+
+// ZORA: A stream has no fixed size to grow
+bool EntitySocket::Resize(uint32_t capacity) {
+	return capacity <= ENTITY_SOCKET_MAX_COUNT;
+}
+
+// ZORA: Apply every complete frame received so far to the newest frame, in the order they were sent. Returns false if the stream is corrupt.
+bool EntitySocket::ApplyFrames() {
+	size_t offset = 0;
+
+	while (m_receiveLength - offset >= sizeof(EntityFrameHeader)) {
+		EntityFrameHeader header;
+		memcpy(&header, m_receive.data() + offset, sizeof(header));
+
+		if (header.magic != ENTITY_FRAME_MAGIC || header.count > ENTITY_SOCKET_MAX_COUNT || header.runCount > ENTITY_SOCKET_MAX_RUNS || header.payloadBytes > sizeof(Entity) * (uint64_t)header.count) {
+#ifndef NDEBUG
+			std::cout << "Entity socket stream is corrupt" << std::endl;
+#endif
+			return false;
+		}
+
+		size_t frameBytes = sizeof(EntityFrameHeader) + sizeof(EntityFrameRun) * header.runCount + (size_t)header.payloadBytes;
+		if (m_receiveLength - offset < frameBytes)
+			break;
+
+		const char* runData = m_receive.data() + offset + sizeof(EntityFrameHeader);
+		const Entity* payload = (const Entity*)(runData + sizeof(EntityFrameRun) * header.runCount);
+
+		// ZORA: Entities that came or went change the blocks they live in
+		size_t oldCount = m_frame.size();
+		m_frame.resize(header.count);
+		m_changedBlocks.resize((header.count + ENTITY_BLOCK_SIZE - 1) / ENTITY_BLOCK_SIZE, 1);
+		if (oldCount != header.count) {
+			for (size_t block = std::min<size_t>(oldCount, header.count) / ENTITY_BLOCK_SIZE; block < m_changedBlocks.size(); block++)
+				m_changedBlocks[block] = 1;
+		}
+
+		uint64_t payloadBytes = 0;
+		for (uint32_t run = 0; run < header.runCount; run++) {
+			EntityFrameRun span;
+			memcpy(&span, runData + sizeof(EntityFrameRun) * run, sizeof(span));
+			payloadBytes += sizeof(Entity) * (uint64_t)span.length;
+			if (span.first > header.count || span.length > header.count - span.first || payloadBytes > header.payloadBytes) {
+#ifndef NDEBUG
+				std::cout << "Entity socket stream is corrupt" << std::endl;
+#endif
+				return false;
+			}
+
+			// ZORA: The payload isn't necessarily aligned for an Entity, so copy it as bytes
+			memcpy(m_frame.data() + span.first, payload, sizeof(Entity) * span.length);
+			payload += span.length;
+
+			for (uint32_t block = span.first / ENTITY_BLOCK_SIZE; block * ENTITY_BLOCK_SIZE < span.first + span.length; block++)
+				m_changedBlocks[block] = 1;
+		}
+
+		m_frameGeneration = header.generation;
+		m_framePublishedUs = header.publishedUs;
+		offset += frameBytes;
+	}
+
+	// ZORA: Keep the start of any frame that hasn't finished arriving
+	if (offset > 0) {
+		memmove(m_receive.data(), m_receive.data() + offset, m_receiveLength - offset);
+		m_receiveLength -= offset;
+	}
+	return true;
+}
+
+bool EntitySocket::ReadSnapshot(std::vector<Entity>& entities) {
+	if (m_fd < 0 || m_listening)
+		return false;
+
+	if (!Receive() || !ApplyFrames()) {
+		Close();
+		return false;
+	}
+
+	// ZORA: A vector this socket didn't fill last time can't be patched, so copy everything into it
+	if (entities.size() != m_readCount)
+		std::fill(m_changedBlocks.begin(), m_changedBlocks.end(), 1);
+
+	entities.resize(m_frame.size());
+	for (size_t block = 0; block < m_changedBlocks.size(); block++) {
+		if (!m_changedBlocks[block])
+			continue;
+
+		size_t first = block * ENTITY_BLOCK_SIZE;
+		size_t length = std::min<size_t>(ENTITY_BLOCK_SIZE, m_frame.size() - first);
+		memcpy(entities.data() + first, m_frame.data() + first, sizeof(Entity) * length);
+		m_changedBlocks[block] = 0;
+	}
+
+	m_readCount = entities.size();
+	m_readGeneration = m_frameGeneration;
+	m_readPublishedUs = m_framePublishedUs;
+	return true;
+}
+
+uint64_t EntitySocket::GetSnapshotGeneration() const {
+	return m_readGeneration;
+}
+
+uint64_t EntitySocket::GetSnapshotPublishedUs() const {
+	return m_readPublishedUs;
+}
+
+uint32_t EntitySocket::GetCapacity() const {
+	return (uint32_t)m_frame.size();
+}
+
+uint32_t EntitySocket::GetClientCount() const {
+	return (uint32_t)m_clients.size();
+}
+
+int EntitySocket::GetErrorCode() const {
+	return m_errorCode;
+}
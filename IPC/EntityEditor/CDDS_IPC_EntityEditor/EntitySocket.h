@@ -0,0 +1,119 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Entity.h"
+#include "EntityTransport.h"
+
+// ZORA: Written at the front of every frame, so a reader that has lost its place in the stream notices straight away instead of reading garbage
+const uint32_t ENTITY_FRAME_MAGIC = 0x4D524645;	// 'EFRM'
+
+// ZORA: The most Displays one Editor streams to at once
+const uint32_t ENTITY_SOCKET_MAX_CLIENTS = 16;
+
+// ZORA: The most entities in one frame. Anything claiming more is treated as a corrupt stream rather than allocated.
+const uint32_t ENTITY_SOCKET_MAX_COUNT = 16 * 1024 * 1024;
+
+// ZORA: The most runs of changed entities in one frame. Past this many, sending the whole array is cheaper than describing the pieces.
+const uint32_t ENTITY_SOCKET_MAX_RUNS = 256;
+
+// ZORA: The front of every frame on the stream. The length prefix is payloadBytes, which with runCount says exactly how many bytes follow.
+struct EntityFrameHeader {
+	uint32_t magic;
+	uint32_t runCount;			// ZORA: The number of EntityFrameRun records that follow the header
+	uint64_t generation;		// ZORA: Goes up by one with every frame the Editor publishes
+	uint32_t count;				// ZORA: The number of live entities in the frame
+	uint32_t reserved;
+	uint64_t payloadBytes;		// ZORA: The number of bytes of entities following the runs, which is every run's length added together, times sizeof(Entity)
+	uint64_t publishedUs;		// ZORA: GetMonotonicMicroseconds() in the Editor when the frame was published. Both ends of a Unix domain socket share the clock.
+};
+
+// ZORA: A run of consecutive entities carried by the frame. A frame that carries everything is a single run from 0 to count.
+struct EntityFrameRun {
+	uint32_t first;
+	uint32_t length;
+};
+
+// ZORA: Streams entity frames over a Unix domain socket, for Displays that can't share memory with the Editor, such as those running in another container.
+// The Editor listens on a path and publishes every frame to every connected Display. Each frame is a header, a table of runs and the entities in those runs, gathered straight out of the Editor's array by a single sendmsg, so nothing is copied into a send buffer first.
+// A Display that has seen every frame so far only receives the blocks that changed. A Display that is new, or too slow to take a frame when it was sent, skips ahead and is sent the whole array next time, so the Editor never waits for a slow Display and never queues more than one frame for it.
+// The stream is length-prefixed SOCK_STREAM rather than SOCK_SEQPACKET, because a frame of a million entities is far bigger than the largest packet a socket will take.
+// Unix domain sockets and sendmsg are POSIX only, so on Windows Listen and Connect always fail.
+class EntitySocket : public EntityPublisher, public EntitySubscriber {
+public:
+	EntitySocket();
+	~EntitySocket();
+
+	// ZORA: Editor side. Listen for Displays on 'path', replacing anything left there by an Editor that crashed. Returns false if the socket could not be bound.
+	bool Listen(const char* path);
+
+	// ZORA: Display side. Connect to an Editor listening on 'path'. Returns false if nobody is listening.
+	bool Connect(const char* path);
+
+	void Close();
+	bool IsOpen() const;
+
+	void MarkDirty(uint32_t index) override;
+	void MarkAllDirty() override;
+
+	// ZORA: Accept any Displays that have connected, then send this frame to every Display that is ready for it. Never blocks.
+	void Publish(const Entity* entities, uint32_t count) override;
+
+	uint32_t GetRangeCapacity() const override;
+	bool Resize(uint32_t capacity) override;
+
+	bool ReadSnapshot(std::vector<Entity>& entities) override;
+	bool WaitForFrame(uint64_t generation, int timeoutMs) override;
+	uint64_t GetSnapshotGeneration() const override;
+	uint64_t GetSnapshotPublishedUs() const override;
+	uint32_t GetCapacity() const override;
+
+	// ZORA: The number of Displays the Editor is streaming to
+	uint32_t GetClientCount() const;
+
+	int GetErrorCode() const;
+
+private:
+	EntitySocket(const EntitySocket&) = delete;
+	EntitySocket& operator=(const EntitySocket&) = delete;
+
+	// ZORA: One connected Display, and whatever is left of a frame it couldn't take all at once
+	struct Client {
+		int fd;
+		std::vector<char> pending;
+		size_t pendingOffset;
+		bool needsFull;
+	};
+
+	void AcceptClients();
+	bool FlushClient(Client& client);
+	bool SendFrame(Client& client, const Entity* entities, const std::vector<EntityFrameRun>& runs);
+
+	bool Receive();
+	bool ApplyFrames();
+
+	int m_fd;
+	bool m_listening;
+	char m_path[108];
+	int m_errorCode;
+
+	// ZORA: Writer side: the connected Displays, blocks marked dirty since the last Publish, and the runs of this frame, for Displays that are up to date and for those that need everything
+	std::vector<Client> m_clients;
+	std::vector<uint8_t> m_dirtyBlocks;
+	uint32_t m_publishedCount;
+	uint64_t m_generation;
+	uint64_t m_publishedUs;
+	std::vector<EntityFrameRun> m_runs;
+	std::vector<EntityFrameRun> m_fullRun;
+
+	// ZORA: Reader side: bytes received but not yet made into frames, the newest frame put together from them, and which of its blocks changed since the caller last read it
+	std::vector<char> m_receive;
+	size_t m_receiveLength;
+	std::vector<Entity> m_frame;
+	uint64_t m_frameGeneration;
+	uint64_t m_framePublishedUs;
+	std::vector<uint8_t> m_changedBlocks;
+	size_t m_readCount;
+	uint64_t m_readGeneration;
+	uint64_t m_readPublishedUs;
+};
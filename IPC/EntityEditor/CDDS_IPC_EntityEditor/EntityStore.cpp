@@ -0,0 +1,64 @@
+#include "EntityStore.h"
+
+EntityStore::EntityStore() {
+
+}
+
+uint32_t EntityStore::GetCount() const {
+	return (uint32_t)m_x.size();
+}
+
+void EntityStore::Resize(uint32_t count) {
+	Entity defaults;
+	m_x.resize(count, defaults.x);
+	m_y.resize(count, defaults.y);
+	m_rotation.resize(count, defaults.rotation);
+	m_speed.resize(count, defaults.speed);
+	m_size.resize(count, defaults.size);
+	m_r.resize(count, defaults.r);
+	m_g.resize(count, defaults.g);
+	m_b.resize(count, defaults.b);
+}
+
+Entity EntityStore::Get(uint32_t index) const {
+	Entity entity;
+	entity.x = m_x[index];
+	entity.y = m_y[index];
+	entity.rotation = m_rotation[index];
+	entity.speed = m_speed[index];
+	entity.size = m_size[index];
+	entity.r = m_r[index];
+	entity.g = m_g[index];
+	entity.b = m_b[index];
+	return entity;
+}
+
+void EntityStore::Set(uint32_t index, const Entity& entity) {
+	m_x[index] = entity.x;
+	m_y[index] = entity.y;
+	m_rotation[index] = entity.rotation;
+	m_speed[index] = entity.speed;
+	m_size[index] = entity.size;
+	m_r[index] = entity.r;
+	m_g[index] = entity.g;
+	m_b[index] = entity.b;
+}
+
+void EntityStore::Move(uint32_t from, uint32_t to) {
+	Set(to, Get(from));
+}
+
+void EntityStore::PopBack() {
+	m_x.pop_back();
+	m_y.pop_back();
+	m_rotation.pop_back();
+	m_speed.pop_back();
+	m_size.pop_back();
+	m_r.pop_back();
+	m_g.pop_back();
+	m_b.pop_back();
+}
+
+EntityColumns EntityStore::GetColumns() {
+	return EntityColumns{ m_x.data(), m_y.data(), m_rotation.data(), m_speed.data(), m_size.data(), m_r.data(), m_g.data(), m_b.data() };
+}
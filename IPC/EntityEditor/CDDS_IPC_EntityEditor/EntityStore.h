@@ -0,0 +1,41 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Entity.h"
+#include "EntityColumns.h"
+
+// ZORA: The Editor's entities, stored as a structure of arrays. Every field has a contiguous column of its own, so moving the entities streams x, y, rotation and speed through the cache and leaves colour and size where they are.
+// Entities are still handed in and out whole where that is simpler, such as for the GUI, which only ever looks at one entity at a time.
+class EntityStore {
+public:
+	EntityStore();
+
+	uint32_t GetCount() const;
+
+	// ZORA: Grow or shrink to 'count' entities. New entities hold Entity's defaults until they are filled in.
+	void Resize(uint32_t count);
+
+	// ZORA: The entity at 'index' as a whole struct, and a way to write one back
+	Entity Get(uint32_t index) const;
+	void Set(uint32_t index, const Entity& entity);
+
+	// ZORA: Copy the entity at 'from' over the one at 'to'
+	void Move(uint32_t from, uint32_t to);
+
+	// ZORA: Drop the last entity
+	void PopBack();
+
+	// ZORA: A view of every column, for loops that work a field at a time. Only valid until the next Resize.
+	EntityColumns GetColumns();
+
+private:
+	std::vector<float> m_x;
+	std::vector<float> m_y;
+	std::vector<float> m_rotation;
+	std::vector<float> m_speed;
+	std::vector<float> m_size;
+	std::vector<unsigned char> m_r;
+	std::vector<unsigned char> m_g;
+	std::vector<unsigned char> m_b;
+};
@@ -0,0 +1,672 @@
+#include "EntityUdp.h"
+#include "EntitySegment.h"
+#include "Platform.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+// ZORA: The kernel buffer asked for on each end, so a burst of pieces for a large frame isn't dropped by the receiving kernel before the Display gets to it
+static const int SOCKET_BUFFER_BYTES = 8 * 1024 * 1024;
+
+// ZORA: How often the Display tells the Editor where it is up to, even when nothing has arrived, which also keeps it on the Editor's list
+static const uint64_t ACK_INTERVAL_MS = 20;
+
+// ZORA: A Display that hasn't finished its frame or asked for any of it for this long has lost it completely, and is sent the newest frame instead
+static const uint64_t RESEND_MS = 250;
+
+// ZORA: Marks a Display that is owed a new frame
+static const size_t NO_FRAME = (size_t)-1;
+
+EntityUdp::EntityUdp() : m_fd(-1), m_listening(false), m_port(0), m_errorCode(0), m_lossPercent(0), m_reorderPercent(0), m_random(0x9E3779B9), m_heldHost(0), m_heldPort(0), m_generation(0), m_packed(false), m_bounds{ 0, 0 }, m_compressed(false), m_session(0),
+	m_serverHost(0), m_serverPort(0), m_serverSession(0), m_previousServerSession(0), m_assemblyType(0), m_assemblyCount(0), m_receivedCount(0), m_highestFragment(0), m_lastFragmentMs(0), m_assemblingGeneration(0), m_needsKeyframe(false), m_frameGeneration(0), m_readGeneration(0), m_lastAckMs(0) {
+
+}
+
+EntityUdp::~EntityUdp() {
+	Close();
+}
+
+#ifdef _WIN32
+
+bool EntityUdp::Listen(uint16_t) {
+	Close();
+	m_errorCode = -1;
+	return false;
+}
+
+bool EntityUdp::Connect(const char*, uint16_t) {
+	Close();
+	m_errorCode = -1;
+	return false;
+}
+
+void EntityUdp::Close() {
+	m_clients.clear();
+	m_frames.clear();
+	m_heldDatagram.clear();
+	m_frame.clear();
+}
+
+void EntityUdp::SendRaw(const void*, size_t, uint32_t, uint16_t) {
+
+}
+
+bool EntityUdp::ReceiveRaw(char*, size_t, size_t&, uint32_t&, uint16_t&) {
+	return false;
+}
+
+bool EntityUdp::WaitForFrame(uint64_t, int) {
+	return false;
+}
+
+#else
+
+// ZORA: Neither end ever waits on the other, so both sockets are non-blocking. The kernel may give less buffer than asked for, which only costs dropped datagrams, so that isn't checked.
+static int OpenSocket() {
+	int fd = socket(AF_INET, SOCK_DGRAM, 0);
+	if (fd < 0)
+		return -1;
+
+	int bufferBytes = SOCKET_BUFFER_BYTES;
+	setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &bufferBytes, sizeof(bufferBytes));
+	setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bufferBytes, sizeof(bufferBytes));
+
+	int flags = fcntl(fd, F_GETFL, 0);
+	if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) != 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+bool EntityUdp::Listen(uint16_t port) {
+	Close();
+
+	m_fd = OpenSocket();
+	if (m_fd < 0) {
+		m_errorCode = errno;
+		return false;
+	}
+
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_ANY);
+	address.sin_port = htons(port);
+	if (bind(m_fd, (sockaddr*)&address, sizeof(address)) != 0) {
+		m_errorCode = errno;
+		Close();
+		return false;
+	}
+
+	m_listening = true;
+	m_port = port;
+	m_generation = 0;
+
+	// ZORA: The start time tells this session from any earlier one on this machine, and the process id from one started in the same microsecond
+	m_session = (GetMonotonicMicroseconds() ^ ((uint64_t)GetCurrentProcessIdentifier() << 40)) | 1;
+	return true;
+}
+
+bool EntityUdp::Connect(const char* host, uint16_t port) {
+	Close();
+
+	addrinfo hints;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_DGRAM;
+
+	addrinfo* resolved = nullptr;
+	int status = getaddrinfo(host, nullptr, &hints, &resolved);
+	if (status != 0 || resolved == nullptr) {
+		m_errorCode = status;
+		return false;
+	}
+	m_serverHost = ((sockaddr_in*)resolved->ai_addr)->sin_addr.s_addr;
+	m_serverPort = htons(port);
+	freeaddrinfo(resolved);
+
+	m_fd = OpenSocket();
+	if (m_fd < 0) {
+		m_errorCode = errno;
+		return false;
+	}
+
+	m_port = port;
+	m_serverSession = 0;
+	m_previousServerSession = 0;
+	m_decoder.Reset();
+	m_needsKeyframe = false;
+	m_assembly.clear();
+	m_received.clear();
+	m_receivedCount = 0;
+	m_assemblingGeneration = 0;
+	m_frame.clear();
+	m_frameGeneration = 0;
+	m_readGeneration = 0;
+
+	// ZORA: The first acknowledgement is the hello that puts this Display on the Editor's list
+	SendAck();
+	return true;
+}
+
+void EntityUdp::Close() {
+	if (m_fd >= 0) {
+		close(m_fd);
+		m_fd = -1;
+	}
+
+	m_listening = false;
+	m_clients.clear();
+	m_frames.clear();
+	m_heldDatagram.clear();
+}
+
+// ZORA: A datagram the socket won't take right now is simply lost, the same as one the network drops
+void EntityUdp::SendRaw(const void* data, size_t length, uint32_t host, uint16_t port) {
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = host;
+	address.sin_port = port;
+	sendto(m_fd, data, length, MSG_DONTWAIT, (sockaddr*)&address, sizeof(address));
+}
+
+// ZORA: Take the next datagram off the socket without waiting. Returns false once there are none left.
+bool EntityUdp::ReceiveRaw(char* buffer, size_t size, size_t& length, uint32_t& host, uint16_t& port) {
+	sockaddr_in address;
+	socklen_t addressLength = sizeof(address);
+	ssize_t received;
+	do {
+		received = recvfrom(m_fd, buffer, size, MSG_DONTWAIT, (sockaddr*)&address, &addressLength);
+	} while (received < 0 && errno == EINTR);
+
+	if (received < 0)
+		return false;
+
+	length = (size_t)received;
+	host = address.sin_addr.s_addr;
+	port = address.sin_port;
+	return true;
+}
+
+bool EntityUdp::WaitForFrame(uint64_t generation, int timeoutMs) {
+	if (m_fd < 0 || m_listening)
+		return false;
+
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+
+	while (true) {
+		Receive();
+		if (m_frameGeneration != 0 && m_frameGeneration != generation)
+			return true;
+
+		auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+		if (remaining <= 0)
+			return false;
+
+		// ZORA: Sleep in the kernel until the Editor sends something, waking in time to send the next acknowledgement
+		pollfd wait = { m_fd, POLLIN, 0 };
+		poll(&wait, 1, (int)std::min<long long>(remaining, (long long)ACK_INTERVAL_MS));
+	}
+}
+
+#endif
+
+bool EntityUdp::IsOpen() const {
+	return m_fd >= 0;
+}
+
+void EntityUdp::SetSimulatedLoss(int lossPercent, int reorderPercent) {
+	m_lossPercent = std::max(0, std::min(lossPercent, 100));
+	m_reorderPercent = std::max(0, std::min(reorderPercent, 100));
+}
+
+// ZORA: xorshift32. The simulated network only needs to be unpredictable, not good, and a fixed seed makes a lossy run repeatable.
+static uint32_t NextRandom(uint32_t& state) {
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+void EntityUdp::SendDatagram(const void* data, size_t length, uint32_t host, uint16_t port) {
+	if (m_lossPercent > 0 && (int)(NextRandom(m_random) % 100) < m_lossPercent)
+		return;
+
+	// ZORA: Hold this one back and send it after the next, which swaps the order they arrive in
+	if (m_heldDatagram.empty() && m_reorderPercent > 0 && (int)(NextRandom(m_random) % 100) < m_reorderPercent) {
+		m_heldDatagram.assign((const char*)data, (const char*)data + length);
+		m_heldHost = host;
+		m_heldPort = port;
+		return;
+	}
+
+	SendRaw(data, length, host, port);
+	if (!m_heldDatagram.empty()) {
+		SendRaw(m_heldDatagram.data(), m_heldDatagram.size(), m_heldHost, m_heldPort);
+		m_heldDatagram.clear();
+	}
+}
+
+void EntityUdp::MarkDirty(uint32_t) {
+
+}
+
+void EntityUdp::MarkAllDirty() {
+
+}
+
+uint32_t EntityUdp::GetRangeCapacity() const {
+	return ENTITY_UDP_MAX_COUNT;
+}
+
+// ZORA: A datagram stream has no fixed size to grow
+bool EntityUdp::Resize(uint32_t capacity) {
+	return capacity <= ENTITY_UDP_MAX_COUNT;
+}
+
+void EntityUdp::SetPacking(bool packed, const EntityPackBounds& bounds) {
+	m_packed = packed;
+	m_bounds = bounds;
+	m_encoder.SetPacking(packed, bounds);
+}
+
+void EntityUdp::SetCompression(bool compressed, bool deflate, uint32_t keyframeInterval) {
+	m_compressed = compressed;
+	m_encoder.SetDeflate(deflate);
+	m_encoder.SetKeyframeInterval(keyframeInterval);
+}
+
+// ZORA: How many units of a frame fit in one piece, and how big each unit is. A unit is an entity, or a byte of an encoded frame.
+static uint32_t GetUnitBytes(uint32_t type) {
+	return type == ENTITY_DATAGRAM_ENCODED_FRAGMENT ? 1 : type == ENTITY_DATAGRAM_PACKED_FRAGMENT ? (uint32_t)sizeof(PackedEntity) : (uint32_t)sizeof(Entity);
+}
+
+static uint32_t GetFragmentUnits(uint32_t type) {
+	return type == ENTITY_DATAGRAM_ENCODED_FRAGMENT ? ENTITY_UDP_ENCODED_FRAGMENT_BYTES : type == ENTITY_DATAGRAM_PACKED_FRAGMENT ? ENTITY_UDP_PACKED_FRAGMENT_ENTITIES : ENTITY_UDP_FRAGMENT_ENTITIES;
+}
+
+static uint32_t GetFragmentCount(uint32_t count, uint32_t type) {
+	uint32_t perFragment = GetFragmentUnits(type);
+	return std::max<uint32_t>(1, (count + perFragment - 1) / perFragment);
+}
+
+void EntityUdp::SendFragment(const SentFrame& frame, uint32_t fragment, const Client& client) {
+	uint32_t perFragment = GetFragmentUnits(frame.type);
+	uint32_t first = fragment * perFragment;
+
+	EntityFragmentHeader header;
+	header.magic = ENTITY_DATAGRAM_MAGIC;
+	header.type = frame.type;
+	header.generation = frame.generation;
+	header.session = m_session;
+	header.count = frame.count;
+	header.fragment = fragment;
+	header.fragmentCount = GetFragmentCount(frame.count, frame.type);
+	header.length = first < frame.count ? std::min(perFragment, frame.count - first) : 0;
+	header.bounds = frame.bounds;
+
+	size_t unitBytes = GetUnitBytes(frame.type);
+	const char* units = frame.type == ENTITY_DATAGRAM_ENCODED_FRAGMENT ? (const char*)frame.encoded.data() : frame.type == ENTITY_DATAGRAM_PACKED_FRAGMENT ? (const char*)frame.packed.data() : (const char*)frame.entities.data();
+
+	m_datagram.resize(sizeof(header) + unitBytes * header.length);
+	memcpy(m_datagram.data(), &header, sizeof(header));
+	if (header.length > 0)
+		memcpy(m_datagram.data() + sizeof(header), units + unitBytes * first, unitBytes * header.length);
+
+	SendDatagram(m_datagram.data(), m_datagram.size(), client.host, client.port);
+}
+
+// ZORA: Find room for a frame, reusing a copy no Display is waiting on, so the pieces sent now and any sent again later all come from the same frame
+size_t EntityUdp::TakeFrame() {
+	size_t frame = 0;
+	for (; frame < m_frames.size(); frame++) {
+		bool inUse = false;
+		for (const auto& client : m_clients)
+			inUse |= client.frame == frame;
+		if (!inUse)
+			break;
+	}
+	if (frame == m_frames.size())
+		m_frames.push_back(SentFrame());
+	return frame;
+}
+
+// ZORA: Copy the frame aside, packed or encoded if asked for. Packing happens once for every Display. Encoding happens once for every reference, since each Display is sent a delta against the frame it last acknowledged.
+void EntityUdp::FillFrame(SentFrame& sent, const Entity* entities, uint32_t count, uint64_t generation, uint64_t reference) {
+	sent.generation = generation;
+	sent.reference = reference;
+	sent.bounds = m_bounds;
+	sent.entities.clear();
+	sent.packed.clear();
+	sent.encoded.clear();
+
+	if (m_compressed) {
+		sent.type = ENTITY_DATAGRAM_ENCODED_FRAGMENT;
+		m_encoder.EncodeFrame(reference, sent.encoded);
+		sent.count = (uint32_t)sent.encoded.size();
+	}
+	else if (m_packed) {
+		sent.type = ENTITY_DATAGRAM_PACKED_FRAGMENT;
+		sent.packed.resize(count);
+		PackEntities(entities, sent.packed.data(), count, m_bounds);
+		sent.count = count;
+	}
+	else {
+		sent.type = ENTITY_DATAGRAM_FRAGMENT;
+		sent.entities.assign(entities, entities + count);
+		sent.count = count;
+	}
+}
+
+// ZORA: Read every acknowledgement waiting on the socket. A Display not heard from before is added, and any pieces a Display reports missing from the frame it was sent are sent again.
+void EntityUdp::ReceiveAcks() {
+	char buffer[ENTITY_UDP_MTU];
+	size_t length = 0;
+	uint32_t host = 0;
+	uint16_t port = 0;
+	uint64_t now = GetMonotonicMilliseconds();
+
+	while (ReceiveRaw(buffer, sizeof(buffer), length, host, port)) {
+		EntityAckHeader ack;
+		if (length < sizeof(ack))
+			continue;
+		memcpy(&ack, buffer, sizeof(ack));
+		if (ack.magic != ENTITY_DATAGRAM_MAGIC || ack.type != ENTITY_DATAGRAM_ACK || ack.missingCount > ENTITY_UDP_MAX_MISSING || length < sizeof(ack) + sizeof(uint32_t) * ack.missingCount)
+			continue;
+
+		auto client = std::find_if(m_clients.begin(), m_clients.end(), [&](const Client& c) { return c.host == host && c.port == port; });
+		if (client == m_clients.end()) {
+			if (m_clients.size() >= ENTITY_UDP_MAX_CLIENTS)
+				continue;
+
+			// ZORA: A new Display has nothing, so it is owed a frame straight away, and a keyframe at that
+			m_clients.push_back(Client{ host, port, NO_FRAME, 0, 0, 0, now, true });
+			client = m_clients.end() - 1;
+#ifndef NDEBUG
+			std::cout << "Display connected to entity UDP port " << m_port << std::endl;
+#endif
+		}
+
+		client->lastHeardMs = now;
+
+		// ZORA: A Display that hasn't heard from this session yet, such as one that was following this Editor before it restarted, has none of its frames, whatever generations it reports
+		uint64_t completeGeneration = ack.session == m_session ? ack.completeGeneration : 0;
+		uint64_t assemblingGeneration = ack.session == m_session ? ack.assemblingGeneration : 0;
+
+		if (completeGeneration > client->ackedGeneration && completeGeneration <= client->sentGeneration)
+			client->ackedGeneration = completeGeneration;
+		if (ack.flags & ENTITY_ACK_NEEDS_KEYFRAME)
+			client->needsKeyframe = true;
+
+		// ZORA: A Display still waiting on the frame it was sent well before this acknowledgement left, without a single piece of it, lost the lot. It is owed the newest frame now rather than after RESEND_MS.
+		if (client->ackedGeneration < client->sentGeneration && assemblingGeneration != client->sentGeneration && now - client->lastSentMs >= 2 * ACK_INTERVAL_MS)
+			client->lastSentMs = 0;
+
+		if (client->frame == NO_FRAME || client->ackedGeneration >= client->sentGeneration || assemblingGeneration != client->sentGeneration || ack.missingCount == 0)
+			continue;
+
+		const SentFrame& frame = m_frames[client->frame];
+		uint32_t fragmentCount = GetFragmentCount(frame.count, frame.type);
+		for (uint32_t i = 0; i < ack.missingCount; i++) {
+			uint32_t fragment;
+			memcpy(&fragment, buffer + sizeof(ack) + sizeof(uint32_t) * i, sizeof(fragment));
+			if (fragment < fragmentCount)
+				SendFragment(frame, fragment, *client);
+		}
+		client->lastSentMs = now;
+	}
+}
+
+void EntityUdp::Publish(const Entity* entities, uint32_t count) {
+	if (!m_listening)
+		return;
+
+	ReceiveAcks();
+	count = std::min(count, ENTITY_UDP_MAX_COUNT);
+	uint64_t now = GetMonotonicMilliseconds();
+
+	// ZORA: A Display that has stopped acknowledging has gone, since UDP never says so
+	for (size_t i = 0; i < m_clients.size();) {
+		if (now - m_clients[i].lastHeardMs > ENTITY_READER_TIMEOUT_MS) {
+#ifndef NDEBUG
+			std::cout << "Display disconnected from entity UDP port " << m_port << std::endl;
+#endif
+			m_clients.erase(m_clients.begin() + i);
+			continue;
+		}
+		i++;
+	}
+
+	// ZORA: A Display is owed a new frame once it has the last one, or once the last one is clearly lost. Either way it no longer needs its old copy.
+	bool owed = false;
+	for (auto& client : m_clients) {
+		if (client.ackedGeneration >= client.sentGeneration || now - client.lastSentMs >= RESEND_MS) {
+			client.frame = NO_FRAME;
+			owed = true;
+		}
+	}
+	if (!owed)
+		return;
+
+	uint64_t generation = ++m_generation;
+	if (m_compressed)
+		m_encoder.AddFrame(entities, count, generation);
+
+	for (auto& client : m_clients) {
+		if (client.frame != NO_FRAME)
+			continue;
+
+		// ZORA: Displays owed a frame against the same reference share one copy of it. Uncompressed, that is every Display.
+		uint64_t reference = client.needsKeyframe ? 0 : client.ackedGeneration;
+		size_t frame = NO_FRAME;
+		for (size_t i = 0; i < m_frames.size() && frame == NO_FRAME; i++) {
+			if (m_frames[i].generation == generation && (!m_compressed || m_frames[i].reference == reference))
+				frame = i;
+		}
+		if (frame == NO_FRAME) {
+			frame = TakeFrame();
+			FillFrame(m_frames[frame], entities, count, generation, reference);
+		}
+
+		client.frame = frame;
+		client.sentGeneration = generation;
+		client.lastSentMs = now;
+		client.needsKeyframe = false;
+		uint32_t fragmentCount = GetFragmentCount(m_frames[frame].count, m_frames[frame].type);
+		for (uint32_t fragment = 0; fragment < fragmentCount; fragment++)
+			SendFragment(m_frames[frame], fragment, client);
+	}
+}
+
+// ZORA: Read everything the socket has for us without waiting, and tell the Editor where we are up to if it is time to
+bool EntityUdp::Receive() {
+	if (m_fd < 0 || m_listening)
+		return false;
+
+	char buffer[ENTITY_UDP_MTU];
+	size_t length = 0;
+	uint32_t host = 0;
+	uint16_t port = 0;
+
+	while (ReceiveRaw(buffer, sizeof(buffer), length, host, port)) {
+		// ZORA: Only the Editor we asked is listened to
+		EntityFragmentHeader header;
+		if (host != m_serverHost || port != m_serverPort || length < sizeof(header))
+			continue;
+		memcpy(&header, buffer, sizeof(header));
+		if (header.magic != ENTITY_DATAGRAM_MAGIC || (header.type != ENTITY_DATAGRAM_FRAGMENT && header.type != ENTITY_DATAGRAM_PACKED_FRAGMENT && header.type != ENTITY_DATAGRAM_ENCODED_FRAGMENT))
+			continue;
+
+		ReceiveFragment(header, buffer + sizeof(header), length - sizeof(header));
+	}
+
+	if (GetMonotonicMilliseconds() - m_lastAckMs >= ACK_INTERVAL_MS)
+		SendAck();
+	return true;
+}
+
+void EntityUdp::ReceiveFragment(const EntityFragmentHeader& header, const char* payload, size_t payloadBytes) {
+	// ZORA: Check the piece describes itself consistently before trusting any of it. A bad datagram is dropped like a lost one.
+	uint32_t maxCount = header.type == ENTITY_DATAGRAM_ENCODED_FRAGMENT ? ENTITY_UDP_MAX_ENCODED_BYTES : ENTITY_UDP_MAX_COUNT;
+	if (header.count > maxCount || header.fragmentCount != GetFragmentCount(header.count, header.type) || header.fragment >= header.fragmentCount)
+		return;
+	uint32_t perFragment = GetFragmentUnits(header.type);
+	uint32_t first = header.fragment * perFragment;
+	uint32_t length = first < header.count ? std::min(perFragment, header.count - first) : 0;
+	if (header.length != length || payloadBytes != (size_t)GetUnitBytes(header.type) * length)
+		return;
+
+	// ZORA: A piece from the session before last was held up on the way, and belongs to an Editor that has since restarted
+	if (header.session == 0 || header.session == m_previousServerSession)
+		return;
+
+	// ZORA: The Editor has restarted and is numbering its frames from 1 again, so nothing from its last session can be built on. ReadSnapshot has nothing new until the first frame of the new session is finished, so the last one read stays on screen until then.
+	if (header.session != m_serverSession) {
+#ifndef NDEBUG
+		if (m_serverSession != 0)
+			std::cout << "Entity UDP Editor restarted, starting again from its first frame" << std::endl;
+#endif
+		m_previousServerSession = m_serverSession;
+		m_serverSession = header.session;
+		m_frameGeneration = 0;
+		m_assemblingGeneration = 0;
+		m_received.clear();
+		m_receivedCount = 0;
+		m_decoder.Reset();
+		m_needsKeyframe = false;
+	}
+
+	// ZORA: Stale: older than the frame being put together, or no newer than the one already finished
+	if (header.generation <= m_frameGeneration || header.generation < m_assemblingGeneration)
+		return;
+
+	uint64_t now = GetMonotonicMilliseconds();
+
+	// ZORA: A newer frame has started arriving, so the unfinished one will never be wanted
+	if (header.generation > m_assemblingGeneration) {
+		m_assemblingGeneration = header.generation;
+		m_assemblyType = header.type;
+		m_assemblyCount = header.count;
+		if (header.type == ENTITY_DATAGRAM_ENCODED_FRAGMENT)
+			m_encodedAssembly.resize(header.count);
+		else
+			m_assembly.resize(header.count);
+		m_received.assign(header.fragmentCount, 0);
+		m_receivedCount = 0;
+		m_highestFragment = 0;
+	}
+
+	if (m_assemblyType != header.type || m_assemblyCount != header.count || m_received[header.fragment])
+		return;
+
+	// ZORA: Packed pieces are unpacked straight into place. The payload isn't necessarily aligned for an Entity, so an unpacked one is copied as bytes.
+	if (header.type == ENTITY_DATAGRAM_ENCODED_FRAGMENT)
+		memcpy(m_encodedAssembly.data() + first, payload, payloadBytes);
+	else if (header.type == ENTITY_DATAGRAM_PACKED_FRAGMENT)
+		UnpackEntities((const PackedEntity*)payload, m_assembly.data() + first, length, header.bounds);
+	else
+		memcpy(m_assembly.data() + first, payload, payloadBytes);
+	m_received[header.fragment] = 1;
+	m_receivedCount++;
+	m_highestFragment = std::max(m_highestFragment, header.fragment);
+	m_lastFragmentMs = now;
+
+	if (m_receivedCount < header.fragmentCount)
+		return;
+
+	m_assemblingGeneration = 0;
+	m_received.clear();
+	m_receivedCount = 0;
+
+	// ZORA: An encoded frame is only a frame once it decodes. One that doesn't was encoded against a frame this Display no longer has, so ask for a keyframe and wait for that.
+	if (header.type == ENTITY_DATAGRAM_ENCODED_FRAGMENT) {
+		m_needsKeyframe = !m_decoder.Decode(m_encodedAssembly.data(), m_encodedAssembly.size(), m_assembly);
+		if (m_needsKeyframe) {
+#ifndef NDEBUG
+			std::cout << "Could not decode entity frame " << header.generation << " from UDP, asking for a keyframe" << std::endl;
+#endif
+			SendAck();
+			return;
+		}
+	}
+
+	// ZORA: Every piece is here, so this is the newest frame. Tell the Editor straight away so the next one isn't held up.
+	m_frame.swap(m_assembly);
+	m_frameGeneration = header.generation;
+	SendAck();
+}
+
+// ZORA: Tell the Editor the newest frame we have and which pieces of the next we're missing. Pieces past the highest one received are probably still on their way, so they are only asked for once nothing has arrived for a while.
+void EntityUdp::SendAck() {
+	char buffer[ENTITY_UDP_MTU];
+	uint64_t now = GetMonotonicMilliseconds();
+
+	EntityAckHeader ack;
+	ack.magic = ENTITY_DATAGRAM_MAGIC;
+	ack.type = ENTITY_DATAGRAM_ACK;
+	ack.completeGeneration = m_frameGeneration;
+	ack.assemblingGeneration = m_assemblingGeneration;
+	ack.session = m_serverSession;
+	ack.missingCount = 0;
+	ack.flags = m_needsKeyframe ? (uint32_t)ENTITY_ACK_NEEDS_KEYFRAME : 0;
+
+	uint32_t end = (uint32_t)m_received.size();
+	if (now - m_lastFragmentMs < ACK_INTERVAL_MS)
+		end = std::min(end, m_highestFragment);
+	for (uint32_t fragment = 0; fragment < end && ack.missingCount < ENTITY_UDP_MAX_MISSING; fragment++) {
+		if (!m_received[fragment]) {
+			memcpy(buffer + sizeof(ack) + sizeof(uint32_t) * ack.missingCount, &fragment, sizeof(fragment));
+			ack.missingCount++;
+		}
+	}
+	memcpy(buffer, &ack, sizeof(ack));
+
+	SendDatagram(buffer, sizeof(ack) + sizeof(uint32_t) * ack.missingCount, m_serverHost, m_serverPort);
+	m_lastAckMs = now;
+}
+
+bool EntityUdp::ReadSnapshot(std::vector<Entity>& entities) {
+	if (!Receive())
+		return false;
+
+	// ZORA: Nothing to show until the first whole frame arrives
+	if (m_frameGeneration == 0)
+		return false;
+
+	// ZORA: Every frame is a whole snapshot, so all of it is copied
+	entities.resize(m_frame.size());
+	if (!m_frame.empty())
+		memcpy(entities.data(), m_frame.data(), sizeof(Entity) * m_frame.size());
+	m_readGeneration = m_frameGeneration;
+	return true;
+}
+
+uint64_t EntityUdp::GetSnapshotGeneration() const {
+	return m_readGeneration;
+}
+
+uint32_t EntityUdp::GetCapacity() const {
+	return (uint32_t)m_frame.size();
+}
+
+uint32_t EntityUdp::GetClientCount() const {
+	return (uint32_t)m_clients.size();
+}
+
+int EntityUdp::GetErrorCode() const {
+	return m_errorCode;
+}
@@ -0,0 +1,204 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Entity.h"
+#include "EntityCodec.h"
+#include "EntityPacking.h"
+#include "EntityTransport.h"
+
+// ZORA: Written at the front of every datagram, so anything else that happens to arrive on the port is ignored
+const uint32_t ENTITY_DATAGRAM_MAGIC = 0x50445545;	// 'EUDP'
+
+// ZORA: The largest datagram either end sends. Comfortably under the 1500 byte Ethernet MTU once the IP and UDP headers are added, so no datagram is ever fragmented by IP, where losing one piece loses the lot.
+const uint32_t ENTITY_UDP_MTU = 1200;
+
+// ZORA: The most Displays one Editor sends to at once
+const uint32_t ENTITY_UDP_MAX_CLIENTS = 16;
+
+// ZORA: The most entities in one frame. Anything claiming more is treated as a corrupt datagram rather than allocated.
+const uint32_t ENTITY_UDP_MAX_COUNT = 16 * 1024 * 1024;
+
+enum EntityDatagramType : uint32_t {
+	ENTITY_DATAGRAM_FRAGMENT = 1,	// ZORA: Editor to Display, one piece of a frame
+	ENTITY_DATAGRAM_ACK = 2,		// ZORA: Display to Editor, the newest frame it has and the pieces it is missing from the next
+	ENTITY_DATAGRAM_PACKED_FRAGMENT = 3,	// ZORA: Editor to Display, one piece of a frame of PackedEntity rather than Entity
+	ENTITY_DATAGRAM_ENCODED_FRAGMENT = 4	// ZORA: Editor to Display, one piece of a frame encoded by EntityEncoder. Its count and length are in bytes rather than entities.
+};
+
+// ZORA: The front of every piece of a frame. Every frame is a whole snapshot cut into fragmentCount pieces of up to ENTITY_UDP_FRAGMENT_ENTITIES entities each, so any complete set of pieces for one generation is a consistent frame on its own.
+struct EntityFragmentHeader {
+	uint32_t magic;
+	uint32_t type;
+	uint64_t generation;		// ZORA: The frame this piece belongs to. Goes up with every frame the Editor sends.
+	uint64_t session;			// ZORA: Picked by the Editor each time it starts listening, never 0. Generations start again from 1 with every session.
+	uint32_t count;				// ZORA: The number of live entities in the whole frame, or bytes when encoded
+	uint32_t fragment;			// ZORA: Which piece this is, counting from 0. Its entities start at fragment * ENTITY_UDP_FRAGMENT_ENTITIES, ENTITY_UDP_PACKED_FRAGMENT_ENTITIES when packed, or ENTITY_UDP_ENCODED_FRAGMENT_BYTES bytes when encoded.
+	uint32_t fragmentCount;		// ZORA: The number of pieces in the frame. An empty frame is still one piece, with no entities in it.
+	uint32_t length;			// ZORA: The number of entities following the header, or bytes when encoded
+	EntityPackBounds bounds;	// ZORA: The screen a packed piece's positions are fixed point across. Unused when not packed.
+};
+
+// ZORA: The most entities in one piece of a frame. Packed, more than twice as many fit.
+const uint32_t ENTITY_UDP_FRAGMENT_ENTITIES = (ENTITY_UDP_MTU - sizeof(EntityFragmentHeader)) / sizeof(Entity);
+const uint32_t ENTITY_UDP_PACKED_FRAGMENT_ENTITIES = (ENTITY_UDP_MTU - sizeof(EntityFragmentHeader)) / sizeof(PackedEntity);
+const uint32_t ENTITY_UDP_ENCODED_FRAGMENT_BYTES = ENTITY_UDP_MTU - sizeof(EntityFragmentHeader);
+
+// ZORA: The most bytes in one encoded frame, enough for the largest frame at the largest size a varint can make each field
+const uint32_t ENTITY_UDP_MAX_ENCODED_BYTES = sizeof(EntityCodecHeader) + ENTITY_UDP_MAX_COUNT * ENTITY_CODEC_FIELDS * 5;
+
+enum EntityAckFlags : uint32_t {
+	ENTITY_ACK_NEEDS_KEYFRAME = 1	// ZORA: The Display couldn't decode the last encoded frame, so the next must not depend on anything before it
+};
+
+// ZORA: The Display's acknowledgement, followed by missingCount fragment indices it hasn't received for the frame it is putting together. It doubles as the Display's hello and keep-alive.
+struct EntityAckHeader {
+	uint32_t magic;
+	uint32_t type;
+	uint64_t completeGeneration;	// ZORA: The newest frame the Display has every piece of, 0 if none
+	uint64_t assemblingGeneration;	// ZORA: The frame the Display is putting together, 0 if none
+	uint64_t session;				// ZORA: The Editor session both generations belong to, 0 before the Display has heard from any
+	uint32_t missingCount;
+	uint32_t flags;
+};
+
+// ZORA: The most missing pieces named by one acknowledgement. Anything past this is asked for again in the next one.
+const uint32_t ENTITY_UDP_MAX_MISSING = (ENTITY_UDP_MTU - sizeof(EntityAckHeader)) / sizeof(uint32_t);
+
+// ZORA: Sends entity frames over UDP, for Displays on other machines.
+// The Editor listens on a port and learns of Displays from their acknowledgements. Each Display is sent a whole snapshot, cut into MTU-sized pieces, and isn't sent the next until it acknowledges that one, so the acknowledgements pace the Editor to what each Display and the network can take. Pieces the Display reports missing are sent again from the Editor's copy of that frame.
+// A Display only ever keeps the newest frame: pieces of a frame older than the one it is putting together, or than the last one it finished, are stale and dropped, and a piece of a newer frame abandons the unfinished one.
+// A restarted Editor numbers its frames from 1 again, so every piece carries the session it was sent in. A Display that sees a new session forgets everything from the old one, and the Editor ignores what a Display says about frames from any session but its own.
+// Encoded, each Display is sent a delta against the newest frame it acknowledged. The encoder keeps the last few frames, so Displays at different points each get a delta against their own. A Display that can't decode one says so in its acknowledgements and is sent a keyframe.
+// Either end can be told to drop and reorder a share of the datagrams it sends, to exercise all of this over loopback.
+// Like the Unix domain socket, this is POSIX only for now, so on Windows Listen and Connect always fail. Entities travel in the Editor's byte order.
+class EntityUdp : public EntityPublisher, public EntitySubscriber {
+public:
+	EntityUdp();
+	~EntityUdp();
+
+	// ZORA: Editor side. Listen for Displays on UDP 'port' on every interface. Returns false if the port could not be bound.
+	bool Listen(uint16_t port);
+
+	// ZORA: Display side. Ask the Editor at 'host':'port' for frames. UDP has no connection, so this only fails if the host can't be resolved; an Editor that isn't there simply never sends anything.
+	bool Connect(const char* host, uint16_t port);
+
+	void Close();
+	bool IsOpen() const;
+
+	// ZORA: Editor side. Send frames as PackedEntity, fixed point across 'bounds', which takes under half the datagrams at the cost of some precision. See PackedEntity for how much.
+	void SetPacking(bool packed, const EntityPackBounds& bounds);
+
+	// ZORA: Editor side. Send each Display a delta against the frame it last acknowledged, encoded by EntityEncoder, rather than a whole frame. Packing, if asked for, happens before encoding. 'deflate' and 'keyframeInterval' are passed to the encoder.
+	void SetCompression(bool compressed, bool deflate, uint32_t keyframeInterval);
+
+	// ZORA: Drop 'lossPercent' of the datagrams this end sends, and hold back 'reorderPercent' of them until after the next one. For testing over loopback, where nothing is ever lost or reordered.
+	void SetSimulatedLoss(int lossPercent, int reorderPercent);
+
+	// ZORA: Every frame is sent whole, so which entities changed doesn't matter
+	void MarkDirty(uint32_t index) override;
+	void MarkAllDirty() override;
+
+	// ZORA: Read the Displays' acknowledgements, then send this frame to every Display that has finished its last one. Never blocks.
+	void Publish(const Entity* entities, uint32_t count) override;
+
+	uint32_t GetRangeCapacity() const override;
+	bool Resize(uint32_t capacity) override;
+
+	bool ReadSnapshot(std::vector<Entity>& entities) override;
+	bool WaitForFrame(uint64_t generation, int timeoutMs) override;
+	uint64_t GetSnapshotGeneration() const override;
+	uint32_t GetCapacity() const override;
+
+	// ZORA: The number of Displays the Editor is sending to
+	uint32_t GetClientCount() const;
+
+	int GetErrorCode() const;
+
+private:
+	EntityUdp(const EntityUdp&) = delete;
+	EntityUdp& operator=(const EntityUdp&) = delete;
+
+	// ZORA: A frame as it was sent, kept until no Display could still ask for a piece of it
+	struct SentFrame {
+		uint64_t generation;
+		uint64_t reference;			// ZORA: The frame an encoded frame was asked to be encoded against
+		uint32_t type;				// ZORA: The type of datagram its pieces are sent in, which says which of the copies below is used
+		uint32_t count;				// ZORA: Entities, or bytes when encoded
+		EntityPackBounds bounds;
+		std::vector<Entity> entities;
+		std::vector<PackedEntity> packed;
+		std::vector<uint8_t> encoded;
+	};
+
+	// ZORA: One Display, which frame it was last sent and which it has acknowledged
+	struct Client {
+		uint32_t host;
+		uint16_t port;
+		size_t frame;
+		uint64_t sentGeneration;
+		uint64_t ackedGeneration;
+		uint64_t lastSentMs;
+		uint64_t lastHeardMs;
+		bool needsKeyframe;
+	};
+
+	// ZORA: The platform's socket calls. Host and port are in network byte order throughout.
+	void SendRaw(const void* data, size_t length, uint32_t host, uint16_t port);
+	bool ReceiveRaw(char* buffer, size_t size, size_t& length, uint32_t& host, uint16_t& port);
+
+	void SendDatagram(const void* data, size_t length, uint32_t host, uint16_t port);
+	void SendFragment(const SentFrame& frame, uint32_t fragment, const Client& client);
+	void ReceiveAcks();
+	size_t TakeFrame();
+	void FillFrame(SentFrame& sent, const Entity* entities, uint32_t count, uint64_t generation, uint64_t reference);
+
+	bool Receive();
+	void ReceiveFragment(const EntityFragmentHeader& header, const char* payload, size_t payloadBytes);
+	void SendAck();
+
+	int m_fd;
+	bool m_listening;
+	uint16_t m_port;
+	int m_errorCode;
+
+	// ZORA: The simulated network, and the datagram being held back to reorder it
+	int m_lossPercent;
+	int m_reorderPercent;
+	uint32_t m_random;
+	std::vector<char> m_heldDatagram;
+	uint32_t m_heldHost;
+	uint16_t m_heldPort;
+
+	// ZORA: Writer side: the Displays, and the frames they are being sent
+	std::vector<Client> m_clients;
+	std::vector<SentFrame> m_frames;
+	uint64_t m_generation;
+	bool m_packed;
+	EntityPackBounds m_bounds;
+	bool m_compressed;
+	EntityEncoder m_encoder;
+	std::vector<char> m_datagram;
+	uint64_t m_session;
+
+	// ZORA: Reader side: where the Editor is and which session of it we are following, the frame being put together and which of its pieces have arrived, the newest complete frame, and when the Editor was last told about them
+	uint32_t m_serverHost;
+	uint16_t m_serverPort;
+	uint64_t m_serverSession;
+	uint64_t m_previousServerSession;
+	uint32_t m_assemblyType;
+	uint32_t m_assemblyCount;
+	std::vector<Entity> m_assembly;
+	std::vector<uint8_t> m_encodedAssembly;
+	std::vector<uint8_t> m_received;
+	uint32_t m_receivedCount;
+	uint32_t m_highestFragment;
+	uint64_t m_lastFragmentMs;
+	uint64_t m_assemblingGeneration;
+	EntityDecoder m_decoder;
+	bool m_needsKeyframe;
+	std::vector<Entity> m_frame;
+	uint64_t m_frameGeneration;
+	uint64_t m_readGeneration;
+	uint64_t m_lastAckMs;
+};
@@ -0,0 +1,30 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// ZORA: Lets a reader sleep until a word in shared memory changes, instead of checking it every frame.
+// On Linux the word itself is the futex that readers sleep on. On Windows readers sleep on a named semaphore, which the writer releases once for every reader it knows is waiting. Anywhere else readers fall back to short sleeps.
+class FrameSignal {
+public:
+	FrameSignal();
+	~FrameSignal();
+
+	// ZORA: The writer creates the signal and the readers open it, with the same name as the shared memory the word lives in
+	bool Create(const char* name);
+	bool Open(const char* name);
+	void Close();
+
+	// ZORA: Wake up to 'waiters' readers sleeping in Wait on 'word'. Call after changing the word.
+	void Wake(std::atomic<uint32_t>* word, uint32_t waiters);
+
+	// ZORA: Sleep while 'word' still holds 'expected', for at most 'timeoutMs' milliseconds. May return early, so callers must check the word again.
+	void Wait(std::atomic<uint32_t>* word, uint32_t expected, int timeoutMs);
+
+private:
+	FrameSignal(const FrameSignal&) = delete;
+	FrameSignal& operator=(const FrameSignal&) = delete;
+
+#ifdef _WIN32
+	void* m_semaphore;
+#endif
+};
@@ -0,0 +1,249 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include "WinInc.h"
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile() : m_file(nullptr), m_mapping(nullptr), m_writable(false), m_view(nullptr), m_size(0), m_errorCode(0) {
+
+}
+
+MappedFile::~MappedFile() {
+	Close();
+}
+
+bool MappedFile::Create(const char* path, size_t size) {
+	Close();
+
+	// ZORA: Other applications may read the file while it is being written, but not write to it
+	HANDLE file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		m_errorCode = (int)GetLastError();
+		return false;
+	}
+	m_file = file;
+	m_writable = true;
+
+	return MapView(size);
+}
+
+bool MappedFile::Open(const char* path) {
+	Close();
+
+	// ZORA: The file may still be being written by the application that created it
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		m_errorCode = (int)GetLastError();
+		return false;
+	}
+	m_file = file;
+	m_writable = false;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size)) {
+		m_errorCode = (int)GetLastError();
+		Close();
+		return false;
+	}
+
+	return MapView((size_t)size.QuadPart);
+}
+
+bool MappedFile::Resize(size_t size) {
+	if (m_file == nullptr || !m_writable)
+		return false;
+
+	UnmapView();
+
+	// ZORA: Mapping grows the file by itself, but it has to be cut down by hand
+	LARGE_INTEGER end;
+	end.QuadPart = (LONGLONG)size;
+	if (!SetFilePointerEx(m_file, end, nullptr, FILE_BEGIN) || !SetEndOfFile(m_file)) {
+		m_errorCode = (int)GetLastError();
+		Close();
+		return false;
+	}
+
+	return MapView(size);
+}
+
+bool MappedFile::MapView(size_t size) {
+	// ZORA: Windows can't map an empty file
+	if (size == 0) {
+		m_errorCode = ERROR_FILE_INVALID;
+		Close();
+		return false;
+	}
+
+	// ZORA: A writable mapping of the given size extends the file to that size, the new bytes reading as zero
+	m_mapping = CreateFileMappingA(
+		m_file,
+		nullptr,
+		m_writable ? PAGE_READWRITE : PAGE_READONLY,
+		(DWORD)((unsigned long long)size >> 32), (DWORD)(size & 0xFFFFFFFF),
+		nullptr);							// ZORA: The mapping is only used by this application, so it has no name
+
+	if (m_mapping == nullptr) {
+		m_errorCode = (int)GetLastError();
+		Close();
+		return false;
+	}
+
+	m_view = MapViewOfFile(m_mapping, m_writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, size);
+	if (m_view == nullptr) {
+		m_errorCode = (int)GetLastError();
+		Close();
+		return false;
+	}
+
+	m_size = size;
+	return true;
+}
+
+void MappedFile::UnmapView() {
+	if (m_view != nullptr) {
+		UnmapViewOfFile(m_view);
+		m_view = nullptr;
+		m_size = 0;
+	}
+
+	if (m_mapping != nullptr) {
+		CloseHandle(m_mapping);
+		m_mapping = nullptr;
+	}
+}
+
+void MappedFile::Close() {
+	UnmapView();
+
+	if (m_file != nullptr) {
+		CloseHandle(m_file);
+		m_file = nullptr;
+	}
+}
+
+bool MappedFile::IsOpen() const {
+	return m_file != nullptr;
+}
+
+#else
+
+MappedFile::MappedFile() : m_fd(-1), m_writable(false), m_view(nullptr), m_size(0), m_errorCode(0) {
+
+}
+
+MappedFile::~MappedFile() {
+	Close();
+}
+
+bool MappedFile::Create(const char* path, size_t size) {
+	Close();
+
+	m_fd = open(path, O_CREAT | O_TRUNC | O_RDWR, 0644);
+	if (m_fd < 0) {
+		m_errorCode = errno;
+		return false;
+	}
+	m_writable = true;
+
+	return Resize(size);
+}
+
+bool MappedFile::Open(const char* path) {
+	Close();
+
+	m_fd = open(path, O_RDONLY);
+	if (m_fd < 0) {
+		m_errorCode = errno;
+		return false;
+	}
+	m_writable = false;
+
+	struct stat info;
+	if (fstat(m_fd, &info) != 0) {
+		m_errorCode = errno;
+		Close();
+		return false;
+	}
+
+	return MapView((size_t)info.st_size);
+}
+
+bool MappedFile::Resize(size_t size) {
+	if (m_fd < 0 || !m_writable)
+		return false;
+
+	UnmapView();
+
+	// ZORA: New bytes read as zero, the same as a growing mapping on Windows
+	if (ftruncate(m_fd, (off_t)size) != 0) {
+		m_errorCode = errno;
+		Close();
+		return false;
+	}
+
+	return MapView(size);
+}
+
+bool MappedFile::MapView(size_t size) {
+	// ZORA: An empty file can't be mapped, the same as on Windows
+	if (size == 0) {
+		m_errorCode = EINVAL;
+		Close();
+		return false;
+	}
+
+	void* view = mmap(nullptr, size, m_writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, m_fd, 0);
+	if (view == MAP_FAILED) {
+		m_errorCode = errno;
+		Close();
+		return false;
+	}
+
+	m_view = view;
+	m_size = size;
+	return true;
+}
+
+void MappedFile::UnmapView() {
+	if (m_view != nullptr) {
+		munmap(m_view, m_size);
+		m_view = nullptr;
+		m_size = 0;
+	}
+}
+
+void MappedFile::Close() {
+	UnmapView();
+
+	if (m_fd >= 0) {
+		close(m_fd);
+		m_fd = -1;
+	}
+}
+
+bool MappedFile::IsOpen() const {
+	return m_fd >= 0;
+}
+
+#endif
+
+void* MappedFile::GetView() const {
+	return m_view;
+}
+
+size_t MappedFile::GetSize() const {
+	return m_size;
+}
+
+int MappedFile::GetErrorCode() const {
+	return m_errorCode;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstddef>
+
+// ZORA: A file on disk mapped into memory, the file-backed counterpart of SharedMemory. The writing application calls Create() and grows the file with Resize() as it fills, and the reading application calls Open() and maps the whole file read-only.
+// Reads and writes go straight through the view, so the operating system pages the file in and out and neither side copies it through a buffer.
+// On Windows this is backed by CreateFile/CreateFileMapping/MapViewOfFile, everywhere else by open/ftruncate/mmap.
+class MappedFile {
+public:
+	MappedFile();
+	~MappedFile();
+
+	// ZORA: Create the file, replacing any file already at 'path', size it to 'size' bytes and map a writable view of it. Returns false if the file could not be created or mapped.
+	bool Create(const char* path, size_t size);
+
+	// ZORA: Open an existing file and map a read-only view of the whole of it. Returns false if the file doesn't exist, is empty or could not be mapped.
+	bool Open(const char* path);
+
+	// ZORA: Grow or shrink a file opened with Create() to 'size' bytes and map it again. The view moves, so any pointers into the old one are invalid afterwards. Returns false, closing the file, if it could not be resized.
+	bool Resize(size_t size);
+
+	// ZORA: Unmap the view and close the file. Whatever was written through the view stays in the file.
+	void Close();
+
+	bool IsOpen() const;
+
+	// ZORA: The view of the file, or a nullptr if nothing is open. Only written through when the file was opened with Create().
+	void* GetView() const;
+
+	// ZORA: The size of the view in bytes, which is the size of the file
+	size_t GetSize() const;
+
+	// ZORA: The platform error code (GetLastError or errno) from the most recent failed call, for debug printouts
+	int GetErrorCode() const;
+
+private:
+	// ZORA: Copying would leave two objects closing the same file
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool MapView(size_t size);
+	void UnmapView();
+
+#ifdef _WIN32
+	void* m_file;
+	void* m_mapping;
+#else
+	int m_fd;
+#endif
+	bool m_writable;
+	void* m_view;
+	size_t m_size;
+	int m_errorCode;
+};
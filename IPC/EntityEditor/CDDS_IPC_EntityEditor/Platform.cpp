@@ -0,0 +1,43 @@
+#include "Platform.h"
+#include <chrono>
+
+#ifdef _WIN32
+#include "WinInc.h"
+#else
+#include <cerrno>
+#include <csignal>
+#include <unistd.h>
+#endif
+
+uint32_t GetCurrentProcessIdentifier() {
+#ifdef _WIN32
+	return (uint32_t)GetCurrentProcessId();
+#else
+	return (uint32_t)getpid();
+#endif
+}
+
+uint64_t GetMonotonicMilliseconds() {
+	// ZORA: steady_clock is CLOCK_MONOTONIC on Linux and QueryPerformanceCounter on Windows, both of which are system-wide
+	return (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t GetMonotonicMicroseconds() {
+	return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool IsProcessRunning(uint32_t processId) {
+#ifdef _WIN32
+	HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, (DWORD)processId);
+	if (process == nullptr)
+		return GetLastError() == ERROR_ACCESS_DENIED;
+
+	// ZORA: A handle can outlive the process it names, so check it hasn't exited
+	bool running = WaitForSingleObject(process, 0) == WAIT_TIMEOUT;
+	CloseHandle(process);
+	return running;
+#else
+	// ZORA: Signal 0 sends nothing, it only checks the process exists
+	return kill((pid_t)processId, 0) == 0 || errno == EPERM;
+#endif
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include <cstdint>
+
+// ZORA: Small pieces of platform-specific process information, kept in one place so the shared memory code doesn't need windows.h or unistd.h
+
+// ZORA: The operating system's id for this process
+uint32_t GetCurrentProcessIdentifier();
+
+// ZORA: Milliseconds on a clock that never goes backwards and is shared by every process on the machine, so timestamps written by one application can be compared by another
+uint64_t GetMonotonicMilliseconds();
+
+// ZORA: The same clock in microseconds, for timing things that take less than a frame
+uint64_t GetMonotonicMicroseconds();
+
+// ZORA: Whether the process with this id is still running. A process that can't be looked into for lack of permission is assumed to be.
+bool IsProcessRunning(uint32_t processId);
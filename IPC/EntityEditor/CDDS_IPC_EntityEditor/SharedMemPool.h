@@ -0,0 +1,68 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// ZORA: Written at the front of a pool, so a process opening a buffer can tell it holds one, and one laid out the way it expects
+const uint32_t SHARED_MEMPOOL_MAGIC = 0x4C504D53;	// 'SMPL'
+const uint32_t SHARED_POOL_VERSION = 1;
+
+// ZORA: As in rmem.h, freed blocks of up to SHARED_MEMPOOL_BUCKET_SIZE * 8 bytes, header included, go into a bucket for their exact size, so small allocations come and go without walking the free list
+const uint32_t SHARED_MEMPOOL_BUCKET_SIZE = 8;
+const uint32_t SHARED_MEMPOOL_BUCKET_BITS = 3;
+
+// ZORA: A free block is only split to serve a smaller allocation when what would be left over is bigger than this, so the free list doesn't fill up with slivers nothing fits in
+const uint64_t SHARED_MEMPOOL_SPLIT_THRESHOLD = 32;
+
+// ZORA: rmem.h's MemNode with its pointers replaced by offsets from the front of the pool, so the node means the same thing wherever each process maps the pool. An offset of 0 is the pool header, which no node can be, so it stands in for a nullptr.
+struct SharedMemNode {
+	uint64_t size;		// ZORA: The size of the whole block, this header included
+	uint64_t next;
+	uint64_t prev;
+};
+
+// ZORA: rmem.h's MemPool, AllocList and Stack in one, kept at the front of the buffer rather than in the creating process, so every process that maps the buffer sees the same pool
+struct SharedMemPoolHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t size;			// ZORA: The size of the pool in bytes, this header included
+	uint64_t base;			// ZORA: The bottom of the stack. Blocks are carved off it downwards from the end of the pool.
+	uint64_t freeHead;
+	uint64_t freeTail;
+	uint64_t freeCount;
+	uint64_t buckets[SHARED_MEMPOOL_BUCKET_SIZE];
+};
+
+// ZORA: rmem.h's MemPool, built from a buffer with CreateMemPoolFromBuffer, made to live in shared memory or a mapped file.
+// Everything the pool knows lives inside the buffer and every link is an offset from its front, so another process can map the same buffer anywhere in its own address space and follow the same allocations. Allocations are handed out as offsets for the same reason.
+// Only one process may allocate and free, since nothing here is locked; any number of others may read what it allocated. Resolve checks an offset against the buffer before turning it into a pointer, so a reader can never be sent outside the pool, however stale or corrupt the offset it was given.
+class SharedMemPool {
+public:
+	SharedMemPool();
+
+	// ZORA: Lay a new, empty pool out across the first 'bytes' bytes of 'buffer'. Returns false if that isn't room for anything.
+	bool Create(void* buffer, size_t bytes);
+
+	// ZORA: Use a pool another process laid out in 'buffer'. Returns false if it doesn't hold one, or the pool claims to be bigger than the buffer.
+	bool Open(void* buffer, size_t bytes);
+
+	bool IsOpen() const;
+
+	// ZORA: Writer side. Allocate 'bytes' bytes of zeroed memory and return its offset, or 0 if the pool has no room.
+	uint64_t Alloc(size_t bytes);
+
+	// ZORA: Writer side. Give back an allocation. Offsets that aren't one of this pool's allocations are ignored, as rmem.h does.
+	void Free(uint64_t offset);
+
+	// ZORA: Writer side. Free everything at once.
+	void Reset();
+
+	// ZORA: The memory at 'offset', or a nullptr if 'bytes' bytes from there don't fit inside the pool
+	void* Resolve(uint64_t offset, size_t bytes) const;
+
+private:
+	SharedMemNode* GetNode(uint64_t offset) const;
+	void InsertFree(uint64_t offset);
+
+	SharedMemPoolHeader* m_header;
+	uint64_t m_size;	// ZORA: Kept on this side as well, so a reader's bounds checks don't depend on what is written in the buffer
+};
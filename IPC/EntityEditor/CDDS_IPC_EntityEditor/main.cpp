@@ -21,90 +21,210 @@
 
 #include "raylib.h"
 #include "EntityEditorApp.h"
+#include "EntityArena.h"
+#include "EntityCommandRing.h"
+#include "EntityRecording.h"
+#include "EntitySegment.h"
+#include "EntitySocket.h"
+#include "EntityUdp.h"
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 
+// ZORA: A Display this many frames behind the Editor is reported as lagging
+static const uint64_t LAGGING_READER_FRAMES = 10;
+
+// ZORA: The first Editor creates a segment with room for this many Editors' worth of entities, so more Editors can join it with --producer
+static const uint32_t SEGMENT_PRODUCERS = 4;
+
 int main(int argc, char* argv[])
 {
     float deltaTime = 0;
     EntityEditorApp app(800, 450);
 
+    // ZORA: Editor 0 creates the segment. Editors started with --producer 1, 2 and so on join it and publish into the range after it.
+    // ZORA: Displays that can't share memory with the Editor connect to the socket given with --socket instead, and Displays on other machines to the UDP port given with --udp
+    // ZORA: --udp-loss and --udp-reorder make the Editor drop and reorder that percentage of what it sends, for trying out a bad network over loopback. --udp-format packed sends PackedEntity rather than Entity, in under half the datagrams.
+    // ZORA: --udp-format delta and delta-packed send each Display a delta against the last frame it acknowledged instead, with --udp-deflate 1 to DEFLATE it as well and --udp-keyframes N to send a whole frame at least every N.
+    // ZORA: --record path appends every published frame to a recording the Display can play back with --replay. --record-deflate 1 DEFLATEs it as well.
+    // ZORA: --segment-layout columns has Editor 0 create the segment with a column per field rather than an array of Entity structs, so the Editor's own columns are copied in without being rearranged. Every other Editor and Display follows whichever layout the segment has.
+    // ZORA: --churn N despawns N random entities a second and spawns N new ones in their place, for load testing the Displays against entities that come and go
+    uint32_t producer = 0;
+    const char* socketPath = nullptr;
+    int udpPort = 0;
+    int udpLoss = 0;
+    int udpReorder = 0;
+    bool udpPacked = false;
+    bool udpDelta = false;
+    bool udpDeflate = false;
+    int udpKeyframes = 0;
+    const char* recordPath = nullptr;
+    bool recordDeflate = false;
+    float churnRate = 0;
+    EntitySegmentLayout segmentLayout = ENTITY_LAYOUT_STRUCTS;
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--producer") == 0)
+            producer = (uint32_t)atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--socket") == 0)
+            socketPath = argv[i + 1];
+        else if (strcmp(argv[i], "--udp") == 0)
+            udpPort = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--udp-loss") == 0)
+            udpLoss = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--udp-reorder") == 0)
+            udpReorder = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--udp-format") == 0) {
+            udpPacked = strcmp(argv[i + 1], "packed") == 0 || strcmp(argv[i + 1], "delta-packed") == 0;
+            udpDelta = strncmp(argv[i + 1], "delta", 5) == 0;
+        }
+        else if (strcmp(argv[i], "--udp-deflate") == 0)
+            udpDeflate = atoi(argv[i + 1]) != 0;
+        else if (strcmp(argv[i], "--udp-keyframes") == 0)
+            udpKeyframes = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--record") == 0)
+            recordPath = argv[i + 1];
+        else if (strcmp(argv[i], "--record-deflate") == 0)
+            recordDeflate = atoi(argv[i + 1]) != 0;
+        else if (strcmp(argv[i], "--churn") == 0)
+            churnRate = (float)atof(argv[i + 1]);
+        else if (strcmp(argv[i], "--segment-layout") == 0)
+            segmentLayout = strcmp(argv[i + 1], "columns") == 0 ? ENTITY_LAYOUT_COLUMNS : ENTITY_LAYOUT_STRUCTS;
+    }
+
     // Initialization
     //--------------------------------------------------------------------------------------
     app.Startup();
     //--------------------------------------------------------------------------------------
+
+    // ZORA: Every range starts on a block, so that no two Editors ever share one. Sized once Startup has made the initial entities, as the store is empty before then.
+    uint32_t rangeSize = (app.GetEntityCount() + ENTITY_BLOCK_SIZE - 1) / ENTITY_BLOCK_SIZE * ENTITY_BLOCK_SIZE;
  
     // NAMED SHARED MEMORY SETUP START vvvvv
     // +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-    /* ZORA: CreateFileMapping is the windows.h function to create a virtual file.This method returns a HANDLE object which is like a pointer to a file.If the function fails, the HANDLE will be a nullptr.This is set by the first parameter.Access type is set by the 3rd parameter.
+    /* ZORA: EntitySegment::Create creates a single block of named shared memory through SharedMemory, which wraps CreateFileMapping on Windows and shm_open followed by ftruncate on Linux. If the function fails it returns false and GetErrorCode() holds the reason.
 
-    The size of the memory block to be allocated is recorded in the 4th and 5th parameters, and the Microsoft documentation explains: "If this parameter (5th) and dwMaximumSizeHigh (4th) are 0, the maximum size of the file mapping object is equal to the current size of the file that hFile (the HANDLE) identifies."
+    The block starts with a header holding a magic number, the layout version, the capacity, sizeof(Entity) and a frame generation, followed by three arrays (slots) of Entity objects, or of one column per field with --segment-layout columns. Each Editor claims its own range of every slot, a partition. Each frame is written into the partition's oldest slot and then made the newest with a single atomic store, so the Display always copies the newest complete frame of every partition and no application ever waits for another. Each partition's slots carry their own live count, so there is no second block just for the count.
 
-    Currently the named shared memory is configured to share memory of a size equal to a user-defined struct called MyData, which is the size of its 5 member variables.
-
-    Memory is allocated at the point when CreateFileMapping is executed so there is no need to use the 'new' keyword to instantiate anything / allocate memory.
+    Memory is allocated at the point when the shared memory is created so there is no need to use the 'new' keyword to instantiate anything / allocate memory.
         */
+    EntitySegment segment;
 
-    // ZORA: Create a named shared memory file map
-    HANDLE fileHandle_01 = CreateFileMapping(
-        INVALID_HANDLE_VALUE,	    // a handle to an existing virtual file, or invalid
-        nullptr,				    // optional security attributes
-        PAGE_READWRITE,			    // read/write access control
-        0, sizeof(unsigned int),	// ZORA: The memory needs of the virtual file, determined according to the combination of the size of the array inside the EntityEditorApp instance, plus an unsigned int which will tell the second application, numerically, how many objects to expect in the array
-        L"IntSharedMemory");		// ZORA: The string name that the 2nd application will use to access the virtual file
-    
     // ZORA: Where the creation of the file map fails, perform a debug printout
-    if (fileHandle_01 == nullptr) {
+    if (producer == 0 && !segment.Create(
+        "EntitySharedMemory",                   // ZORA: The string name that the 2nd application will use to access the virtual file
+        rangeSize * SEGMENT_PRODUCERS,          // ZORA: The number of entities the segment has room for, across every Editor
+        segmentLayout)) {                       // ZORA: How each slot lays out its entities
 #ifndef NDEBUG
-        std::cout << "Could not create file mapping object (application 1): " << GetLastError() << std::endl;
+        std::cout << "Could not create file mapping object (application 1): " << segment.GetErrorCode() << std::endl;
 #endif
         return 1;
     }
 
-    else {
+    // ZORA: Every other Editor joins the segment the first one created
+    else if (producer != 0 && !segment.Open("EntitySharedMemory")) {
 #ifndef NDEBUG
-        std::cout << "File mapping object created successfully (application 1)." << std::endl;
+        std::cout << "Could not open file mapping object (application 1, producer " << producer << "): " << segment.GetErrorCode() << std::endl;
 #endif
+        return 1;
     }
 
-    /* ZORA: The memory allocated by CreateFileMapping is hidden from all applications within a virtual file system. Each application requires a temporary pointer to that virtual file in order to access it.The MapViewOfFile function creates a void pointer so that we can refer to any object type, but we want the same type as the object at the shared memory location. The pointer will point to the first element in the array, but the memory allocation size needs to be equal to the size of the entire array.
-    */
-    // ZORA: Make the volume of objects inside the array known to the other application
-    unsigned int* size = (unsigned int*)MapViewOfFile(
-        fileHandle_01,          // ZORA: Target HANDLE
-        FILE_MAP_ALL_ACCESS,    // ZORA: Type of access, per CreateFileMapping
-        0,                      // ZORA: Offset within the memory allocation of the named shared memory for dynamic or selective access to a specific area in the target memory.
-        0,                      // ZORA: Offset within the memory allocation of the named shared memory for dynamic or selective access to a specific area in the target memory.
-        sizeof(unsigned int));  // ZORA: The size of the named shared memory to map
+    // ZORA: Claim this Editor's range of the segment. This fails if another Editor is already using the same --producer.
+    if (!segment.ClaimRange(producer * rangeSize, app.GetEntityCount())) {
+#ifndef NDEBUG
+        std::cout << "Could not claim a range of the file mapping object (application 1, producer " << producer << ")." << std::endl;
+#endif
+        return 1;
+    }
 
-    *size = app.GetEntityCount();
+    else {
+#ifndef NDEBUG
+        std::cout << "File mapping object ready (application 1, producer " << producer << ")." << std::endl;
+#endif
+    }
 
-    // ZORA: Where the creation of the pointer to view the file map fails, perform a debug printout
-    if (size == nullptr) {
+    // ZORA: The return channel from the Display. Each Editor has a ring of its own, named after its partition, so the Display can send an edit to whichever Editor owns the entity. The Editor still runs without it, it just can't be edited from the Display.
+    EntityCommandRing commands;
+    char commandRingName[300];
+    MakeCommandRingName(commandRingName, sizeof(commandRingName), "EntitySharedMemory", segment.GetPartitionIndex());
+    if (commands.Create(commandRingName)) {
+        app.SetCommandRing(&commands);
+    }
+
+    else {
 #ifndef NDEBUG
-        std::cout << "Could not map view of file (for the size): " << GetLastError() << std::endl;
+        std::cout << "Could not create command ring (application 1): " << commands.GetErrorCode() << std::endl;
 #endif
-        // ZORA: This is for identical, but even more important, reasons as file I/O closures
-        CloseHandle(fileHandle_01);
-        return 1;
+    }
+
+    // ZORA: Variable-length entity data, names for now, which the Display reads in place. Named after the partition like the command ring, as each arena can only have one Editor writing to it. The Editor still runs without it, its entities just can't be named.
+    EntityArena arena;
+    char arenaName[300];
+    MakeArenaName(arenaName, sizeof(arenaName), "EntitySharedMemory", segment.GetPartitionIndex());
+    if (arena.Create(arenaName)) {
+        app.SetArena(&arena);
     }
 
     else {
 #ifndef NDEBUG
-        std::cout << "Map viewed successfully (unsigned int)." << std::endl;
+        std::cout << "Could not create arena (application 1): " << arena.GetErrorCode() << std::endl;
 #endif
     }
 
-    UnmapViewOfFile(size);
-    
 
+    // ZORA: Every transport the entities are published through. The segment always, the socket, UDP and a recording as well when asked for.
+    std::vector<EntityPublisher*> publishers;
+    publishers.push_back(&segment);
+
+    EntitySocket socket;
+    if (socketPath != nullptr) {
+        if (socket.Listen(socketPath)) {
+            publishers.push_back(&socket);
+        }
+
+        else {
+#ifndef NDEBUG
+            std::cout << "Could not listen on entity socket " << socketPath << " (application 1): " << socket.GetErrorCode() << std::endl;
+#endif
+        }
+    }
+
+    EntityUdp udp;
+    if (udpPort != 0) {
+        if (udp.Listen((uint16_t)udpPort)) {
+            udp.SetSimulatedLoss(udpLoss, udpReorder);
+            udp.SetPacking(udpPacked, EntityPackBounds{ (float)app.m_screenWidth, (float)app.m_screenHeight });
+            udp.SetCompression(udpDelta, udpDeflate, udpKeyframes > 0 ? (uint32_t)udpKeyframes : 0);
+            publishers.push_back(&udp);
+        }
 
-    HANDLE fileHandle_02 = CreateFileMapping(
-        INVALID_HANDLE_VALUE,	    // a handle to an existing virtual file, or invalid
-        nullptr,				    // optional security attributes
-        PAGE_READWRITE,			    // read/write access control
-        0, size_t(app.GetArraySize()),		// ZORA: The memory needs of the virtual file, determined according to the combination of the size of the array inside the EntityEditorApp instance, plus an unsigned int which will tell the second application, numerically, how many objects to expect in the array
-        L"ArraySharedMemory");		// ZORA: The string name that the 2nd application will use to access the virtual file
+        else {
+#ifndef NDEBUG
+            std::cout << "Could not listen on entity UDP port " << udpPort << " (application 1): " << udp.GetErrorCode() << std::endl;
+#endif
+        }
+    }
 
+    EntityRecorder recorder;
+    if (recordPath != nullptr) {
+        recorder.SetDeflate(recordDeflate);
+        if (recorder.Create(recordPath)) {
+            publishers.push_back(&recorder);
+        }
+
+        else {
+#ifndef NDEBUG
+            std::cout << "Could not create recording " << recordPath << " (application 1): " << recorder.GetErrorCode() << std::endl;
+#endif
+        }
+    }
+
+    // ZORA: The Displays registered with the segment, as last reported
+    std::vector<EntityReaderStatus> readers;
+    size_t readerCount = 0;
+    unsigned int laggingCount = 0;
+
+    // ZORA: The entities --churn has yet to churn, carried from frame to frame
+    float churnOwed = 0;
 
     // +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ 
     // NAMED SHARED MEMORY SETUP FINISH ^^^^^
@@ -120,32 +240,27 @@ int main(int argc, char* argv[])
         app.Update(deltaTime);
         //----------------------------------------------------------------------------------
 
-        // ZORA: Make the array of objects available to the other application
-        Entity* data = (Entity*)MapViewOfFile(
-            fileHandle_02,          // ZORA: Target HANDLE
-            FILE_MAP_ALL_ACCESS,    // ZORA: Type of access, per CreateFileMapping
-            0,                      // ZORA: Offset within the memory allocation of the named shared memory for dynamic or selective access to a specific area in the target memory.
-            0,                      // ZORA: Offset within the memory allocation of the named shared memory for dynamic or selective access to a specific area in the target memory.
-            size_t(app.GetArraySize()));    // ZORA: The size of the named shared memory to map
-
-        // ZORA: Where the creation of the pointer to view the file map fails, perform a debug printout
-        if (data == nullptr) {
-#ifndef NDEBUG
-            std::cout << "Could not map view of file (for the array): " << GetLastError() << std::endl;
-#endif
-            // ZORA: This is for identical, but even more important, reasons as file I/O closures
-            CloseHandle(fileHandle_02);
-            return 1;
+        // ZORA: The fraction of an entity left over is carried into the next frame, so low rates still churn at the rate asked for
+        if (churnRate > 0) {
+            churnOwed += churnRate * deltaTime;
+            unsigned int churnCount = (unsigned int)churnOwed;
+            churnOwed -= churnCount;
+            if (churnCount > 0)
+                app.ChurnEntities(churnCount);
         }
 
-        else {
+        // ZORA: Copy the array of Entities into the shared memory through the long-lived view, and down the socket and UDP to any Displays connected to them
+        app.PublishEntities(publishers);
+
 #ifndef NDEBUG
-            std::cout << "Map viewed successfully (array)." << std::endl;
-#endif
+        // ZORA: Report Displays attaching, detaching or falling behind
+        unsigned int lagging = segment.GetReaders(readers, LAGGING_READER_FRAMES);
+        if (readers.size() != readerCount || lagging != laggingCount) {
+            readerCount = readers.size();
+            laggingCount = lagging;
+            std::cout << "Displays attached: " << readerCount << " (" << laggingCount << " lagging)" << std::endl;
         }
-
-        // ZORA: Set the file map pointer so that it points to the memory address of the object at the front of the array of Entities
-        app.ArrayOfEntities(data);
+#endif
 
 
 
@@ -153,9 +268,6 @@ int main(int argc, char* argv[])
         //----------------------------------------------------------------------------------
         app.Draw();
         //----------------------------------------------------------------------------------
-               
-
-        UnmapViewOfFile(data);
     }
 
     // De-Initialization
@@ -164,8 +276,15 @@ int main(int argc, char* argv[])
     //--------------------------------------------------------------------------------------
 
     
-    CloseHandle(fileHandle_01);
-    CloseHandle(fileHandle_02);
+    // ZORA: This is for identical, but even more important, reasons as file I/O closures. Closing also unmaps the long-lived view.
+    app.SetCommandRing(nullptr);
+    commands.Close();
+    app.SetArena(nullptr);
+    arena.Close();
+    recorder.Close();
+    udp.Close();
+    socket.Close();
+    segment.Close();
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,156 @@
+// ZORA: The movement kernels at a million entities: the loop the Editor used to run, with sinf, cosf and fmod, against MoveEntities' scalar, SSE2 and AVX2 kernels.
+// Each kernel moves the same entities one step, and must land within a thousandth of a pixel of the old loop and of the scalar kernel, on the same side of every wraparound, marking exactly the same entities dirty and leaving stationary ones untouched. Then each is timed over a run of frames.
+// In an optimised build on a CPU with AVX2 the best kernel must be at least five times as fast as the old loop. Anywhere else the speedups are only reported.
+// Usage: MotionBench [entities] [frames]
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "EntityGenerator.h"
+#include "EntityMotion.h"
+#include "EntityStore.h"
+
+static const float WIDTH = 800;
+static const float HEIGHT = 450;
+static const float DELTA_TIME = 1.0f / 60.0f;
+
+// ZORA: How far a kernel may land from the old loop after one step. The polynomial is good to a few ulps of sinf and cosf, which at a speed of 100 moves an entity far less than the last bit of a position on screen, so this leaves plenty of room.
+static const float POSITION_TOLERANCE = 0.001f;
+
+// ZORA: How many times faster than the old loop the best kernel has to be
+static const double REQUIRED_SPEEDUP = 5.0;
+
+static const int KERNEL_COUNT = 4;
+static const char* KERNEL_NAMES[KERNEL_COUNT] = { "sinf and fmod", "scalar", "SSE2", "AVX2" };
+
+// ZORA: The loop EntityEditorApp::Update ran before MoveEntities, kept here to measure against
+static void MoveOriginal(const EntityColumns& columns, uint32_t count, float deltaTime, float width, float height, uint8_t* dirty) {
+	for (uint32_t i = 0; i < count; i++) {
+		if (columns.speed[i] == 0)
+			continue;
+		dirty[i] = 1;
+
+		float s = sinf(columns.rotation[i]) * columns.speed[i];
+		float c = cosf(columns.rotation[i]) * columns.speed[i];
+		columns.x[i] -= s * deltaTime;
+		columns.y[i] += c * deltaTime;
+
+		columns.x[i] = fmod(columns.x[i], width);
+		if (columns.x[i] < 0)
+			columns.x[i] += width;
+		columns.y[i] = fmod(columns.y[i], height);
+		if (columns.y[i] < 0)
+			columns.y[i] += height;
+	}
+}
+
+// ZORA: Kernel 0 is the old loop, the rest are EntityMotionKernel values
+static void Move(int kernel, const EntityColumns& columns, uint32_t count, uint8_t* dirty) {
+	if (kernel == 0)
+		MoveOriginal(columns, count, DELTA_TIME, WIDTH, HEIGHT, dirty);
+	else
+		MoveEntities(columns, 0, count, DELTA_TIME, WIDTH, HEIGHT, dirty, (EntityMotionKernel)kernel);
+}
+
+static bool IsAvailable(int kernel) {
+	return kernel <= ENTITY_MOTION_KERNEL_SCALAR || kernel <= (int)GetBestMotionKernel();
+}
+
+// ZORA: The distance between two positions on a screen that wraps around, so 0.001 and 799.999 are close together
+static float WrappedDistance(float a, float b, float size) {
+	float distance = std::fabs(a - b);
+	return std::min(distance, size - distance);
+}
+
+int main(int argc, char** argv) {
+	uint32_t count = argc > 1 ? (uint32_t)atoi(argv[1]) : 1000000;
+	int frames = argc > 2 ? atoi(argv[2]) : 30;
+	if (count == 0 || frames <= 0) {
+		printf("Usage: MotionBench [entities] [frames]\n");
+		return 1;
+	}
+
+	// ZORA: Random entities as the Editor spawns them, with every tenth one stationary
+	EntityStore start;
+	start.Resize(count);
+	EntityGenerator generator(1);
+	generator.SetBounds(WIDTH, HEIGHT);
+	generator.Generate(start.GetColumns(), 0, count);
+	for (uint32_t i = 0; i < count; i += 10)
+		start.GetColumns().speed[i] = 0;
+
+	printf("%u entities, best kernel on this CPU: %s\n", count, KERNEL_NAMES[GetBestMotionKernel()]);
+
+	// ZORA: One step of each kernel from the same entities, against one step of the old loop
+	EntityStore moved[KERNEL_COUNT];
+	std::vector<uint8_t> dirty[KERNEL_COUNT];
+	bool failed = false;
+	for (int kernel = 0; kernel < KERNEL_COUNT; kernel++) {
+		if (!IsAvailable(kernel))
+			continue;
+		moved[kernel] = start;
+		dirty[kernel].assign(count, 0);
+		Move(kernel, moved[kernel].GetColumns(), count, dirty[kernel].data());
+	}
+
+	const EntityColumns original = moved[0].GetColumns();
+	const EntityColumns scalar = moved[ENTITY_MOTION_KERNEL_SCALAR].GetColumns();
+	const EntityColumns before = start.GetColumns();
+	for (int kernel = 1; kernel < KERNEL_COUNT; kernel++) {
+		if (!IsAvailable(kernel))
+			continue;
+
+		const EntityColumns columns = moved[kernel].GetColumns();
+		float worst = 0;
+		float worstScalar = 0;
+		uint32_t outside = 0;
+		uint32_t stationaryMoved = 0;
+		for (uint32_t i = 0; i < count; i++) {
+			worst = std::max(worst, std::max(WrappedDistance(columns.x[i], original.x[i], WIDTH), WrappedDistance(columns.y[i], original.y[i], HEIGHT)));
+			worstScalar = std::max(worstScalar, std::max(WrappedDistance(columns.x[i], scalar.x[i], WIDTH), WrappedDistance(columns.y[i], scalar.y[i], HEIGHT)));
+			outside += columns.x[i] < 0 || columns.x[i] >= WIDTH || columns.y[i] < 0 || columns.y[i] >= HEIGHT ? 1 : 0;
+			if (before.speed[i] == 0)
+				stationaryMoved += memcmp(&columns.x[i], &before.x[i], sizeof(float)) != 0 || memcmp(&columns.y[i], &before.y[i], sizeof(float)) != 0 ? 1 : 0;
+		}
+		bool sameDirty = dirty[kernel] == dirty[0];
+
+		printf("%-14s furthest from the old loop %.2e px and from scalar %.2e px, %u off screen, %u stationary moved, dirty flags %s\n", KERNEL_NAMES[kernel], worst, worstScalar, outside, stationaryMoved, sameDirty ? "match" : "DIFFER");
+		failed |= !(worst <= POSITION_TOLERANCE) || !(worstScalar <= POSITION_TOLERANCE) || outside > 0 || stationaryMoved > 0 || !sameDirty;
+	}
+
+	// ZORA: The fastest of a run of frames, which is the least disturbed by whatever else the machine is doing
+	double fastest[KERNEL_COUNT];
+	for (int kernel = 0; kernel < KERNEL_COUNT; kernel++) {
+		fastest[kernel] = 0;
+		if (!IsAvailable(kernel))
+			continue;
+
+		EntityStore store = start;
+		std::vector<uint8_t> flags(count, 0);
+		fastest[kernel] = 1e30;
+		for (int frame = 0; frame < frames; frame++) {
+			auto begin = std::chrono::steady_clock::now();
+			Move(kernel, store.GetColumns(), count, flags.data());
+			fastest[kernel] = std::min(fastest[kernel], std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count());
+		}
+		printf("%-14s %7.2f ms a frame, %5.1fx the old loop\n", KERNEL_NAMES[kernel], fastest[kernel], fastest[0] / fastest[kernel]);
+	}
+
+	double speedup = fastest[0] / fastest[GetBestMotionKernel()];
+#ifdef NDEBUG
+	bool checkSpeed = GetBestMotionKernel() == ENTITY_MOTION_KERNEL_AVX2;
+#else
+	bool checkSpeed = false;
+#endif
+	if (checkSpeed && speedup < REQUIRED_SPEEDUP) {
+		printf("The best kernel is only %.1fx the old loop, short of %.0fx\n", speedup, REQUIRED_SPEEDUP);
+		failed = true;
+	}
+	else if (!checkSpeed) {
+		printf("Not checking the %.0fx speedup without AVX2 in an optimised build\n", REQUIRED_SPEEDUP);
+	}
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,169 @@
+// ZORA: Packs and unpacks random entities, and checks the two things PackedEntity promises: SSE2 and scalar give exactly the same bytes, and a round trip is never further out than the bounds documented on PackedEntity.
+// PackEntities runs SSE2 four entities at a time and scalar on whatever is left, so one entity per call is the scalar kernel and a whole array is SSE2.
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+#include "EntityPacking.h"
+
+static int g_failures = 0;
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+			g_failures++; \
+		} \
+	} while (0)
+
+// ZORA: Not a multiple of four, so every batch has a scalar tail as well
+static const size_t ENTITY_COUNT = 100003;
+
+// ZORA: The screens the bounds are checked on, the Editor's default window among them
+static const EntityPackBounds BOUNDS[] = { { 800, 450 }, { 1920, 1080 }, { 3840, 2160 } };
+
+// ZORA: Floats are compared by their bits, so a NaN only matches the same NaN and 0 doesn't match -0
+static bool SameBits(float a, float b) {
+	return memcmp(&a, &b, sizeof(float)) == 0;
+}
+
+static bool SameEntity(const Entity& a, const Entity& b) {
+	return SameBits(a.x, b.x) && SameBits(a.y, b.y) && SameBits(a.rotation, b.rotation) && SameBits(a.speed, b.speed) && SameBits(a.size, b.size) && a.r == b.r && a.g == b.g && a.b == b.b;
+}
+
+// ZORA: Entities anywhere on the screen and a little way off it, turned any number of times either way, with every speed and size the Editor's sliders give and a little beyond
+static std::vector<Entity> MakeEntities(std::mt19937& random, const EntityPackBounds& bounds) {
+	std::uniform_real_distribution<float> x(-0.1f * bounds.width, 1.1f * bounds.width);
+	std::uniform_real_distribution<float> y(-0.1f * bounds.height, 1.1f * bounds.height);
+	std::uniform_real_distribution<float> rotation(-720.0f, 720.0f);
+	std::uniform_real_distribution<float> slider(-10.0f, 110.0f);
+	std::uniform_int_distribution<int> colour(0, 255);
+
+	std::vector<Entity> entities(ENTITY_COUNT);
+	for (Entity& entity : entities) {
+		entity.x = x(random);
+		entity.y = y(random);
+		entity.rotation = rotation(random);
+		entity.speed = slider(random);
+		entity.size = slider(random);
+		entity.r = (unsigned char)colour(random);
+		entity.g = (unsigned char)colour(random);
+		entity.b = (unsigned char)colour(random);
+	}
+	return entities;
+}
+
+// ZORA: Values no Editor should send, which still have to pack the same way in both kernels
+static std::vector<Entity> MakeSpecialEntities() {
+	const float specials[] = { 0.0f, -0.0f, 1e30f, -1e30f, 1e-30f, std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(), std::numeric_limits<float>::quiet_NaN(), 359.99999f, 360.0f, -360.0f, 65535.5f };
+	const size_t count = sizeof(specials) / sizeof(specials[0]);
+
+	std::vector<Entity> entities;
+	for (size_t i = 0; i < count * count; i++) {
+		Entity entity;
+		entity.x = specials[i % count];
+		entity.y = specials[i / count];
+		entity.rotation = specials[(i + 3) % count];
+		entity.speed = specials[(i + 5) % count];
+		entity.size = specials[(i + 7) % count];
+		entity.r = entity.g = entity.b = (unsigned char)i;
+		entities.push_back(entity);
+	}
+	return entities;
+}
+
+static void CheckKernelsMatch(const std::vector<Entity>& entities, const EntityPackBounds& bounds) {
+	size_t count = entities.size();
+	std::vector<PackedEntity> vector(count);
+	std::vector<PackedEntity> scalar(count);
+	PackEntities(entities.data(), vector.data(), count, bounds);
+	for (size_t i = 0; i < count; i++)
+		PackEntities(&entities[i], &scalar[i], 1, bounds);
+	CHECK(memcmp(vector.data(), scalar.data(), sizeof(PackedEntity) * count) == 0);
+
+	std::vector<Entity> vectorUnpacked(count);
+	std::vector<Entity> scalarUnpacked(count);
+	UnpackEntities(vector.data(), vectorUnpacked.data(), count, bounds);
+	for (size_t i = 0; i < count; i++)
+		UnpackEntities(&vector[i], &scalarUnpacked[i], 1, bounds);
+
+	size_t mismatches = 0;
+	for (size_t i = 0; i < count; i++)
+		mismatches += SameEntity(vectorUnpacked[i], scalarUnpacked[i]) ? 0 : 1;
+	CHECK(mismatches == 0);
+}
+
+static float Clamp(float value, float low, float high) {
+	return value < low ? low : value > high ? high : value;
+}
+
+// ZORA: The distance around the circle between two rotations, in degrees
+static float AngleBetween(float a, float b) {
+	float difference = std::fmod(std::fabs(a - b), 360.0f);
+	return difference > 180.0f ? 360.0f - difference : difference;
+}
+
+struct RoundTripErrors {
+	float x, y, rotation, speed, size;
+	bool coloursExact;
+};
+
+static RoundTripErrors MeasureRoundTrip(const std::vector<Entity>& entities, const EntityPackBounds& bounds) {
+	size_t count = entities.size();
+	std::vector<PackedEntity> packed(count);
+	std::vector<Entity> unpacked(count);
+	PackEntities(entities.data(), packed.data(), count, bounds);
+	UnpackEntities(packed.data(), unpacked.data(), count, bounds);
+
+	// ZORA: Anything outside the bounds is clamped to them, so the error is measured from where it was clamped to
+	RoundTripErrors errors = { 0, 0, 0, 0, 0, true };
+	for (size_t i = 0; i < count; i++) {
+		const Entity& before = entities[i];
+		const Entity& after = unpacked[i];
+		errors.x = std::max(errors.x, std::fabs(after.x - Clamp(before.x, 0, bounds.width)));
+		errors.y = std::max(errors.y, std::fabs(after.y - Clamp(before.y, 0, bounds.height)));
+		errors.rotation = std::max(errors.rotation, AngleBetween(after.rotation, before.rotation));
+		errors.speed = std::max(errors.speed, std::fabs(after.speed - Clamp(before.speed, 0, ENTITY_PACK_MAX_SPEED)));
+		errors.size = std::max(errors.size, std::fabs(after.size - Clamp(before.size, 0, ENTITY_PACK_MAX_SIZE)));
+		errors.coloursExact &= after.r == before.r && after.g == before.g && after.b == before.b;
+		CHECK(after.rotation >= 0 && after.rotation < 360.0f);
+	}
+	return errors;
+}
+
+int main() {
+	std::mt19937 random(12345);
+
+	CheckKernelsMatch(MakeSpecialEntities(), BOUNDS[0]);
+
+	for (const EntityPackBounds& bounds : BOUNDS) {
+		std::vector<Entity> entities = MakeEntities(random, bounds);
+		CheckKernelsMatch(entities, bounds);
+
+		// ZORA: The bounds documented on PackedEntity: half a step of fixed point for each field. Positions are allowed the last bit of a float on top, from scaling back up across the screen.
+		float xBound = bounds.width / 65535.0f * 0.5f + bounds.width * std::numeric_limits<float>::epsilon();
+		float yBound = bounds.height / 65535.0f * 0.5f + bounds.height * std::numeric_limits<float>::epsilon();
+		float rotationBound = 0.003f;
+		float sliderBound = 0.2f;
+
+		RoundTripErrors errors = MeasureRoundTrip(entities, bounds);
+		printf("%4.0f x %4.0f: x %.5f of %.5f, y %.5f of %.5f, rotation %.5f of %.3f, speed %.3f and size %.3f of %.1f\n", bounds.width, bounds.height,
+			errors.x, xBound, errors.y, yBound, errors.rotation, rotationBound, errors.speed, errors.size, sliderBound);
+		CHECK(errors.x <= xBound);
+		CHECK(errors.y <= yBound);
+		CHECK(errors.rotation <= rotationBound);
+		CHECK(errors.speed <= sliderBound);
+		CHECK(errors.size <= sliderBound);
+		CHECK(errors.coloursExact);
+	}
+
+	if (g_failures > 0) {
+		printf("%d checks failed\n", g_failures);
+		return 1;
+	}
+	printf("All checks passed\n");
+	return 0;
+}
@@ -0,0 +1,66 @@
+// ZORA: raylib's CompressData and DecompressData, for building the codec where raylib itself isn't installed. raylib DEFLATEs with sdefl and inflates with sinfl, both raw DEFLATE streams with no zlib header, so zlib with negative window bits reads and writes the same format.
+// Both return memory from RL_MALLOC, which the caller gives back with RL_FREE, as raylib's own do.
+#include <cstdlib>
+#include <zlib.h>
+#include "raylib.h"
+
+unsigned char* CompressData(unsigned char* data, int dataLength, int* compDataLength) {
+	*compDataLength = 0;
+	z_stream stream = {};
+	if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+		return nullptr;
+
+	uLong bound = deflateBound(&stream, (uLong)dataLength);
+	unsigned char* compressed = (unsigned char*)RL_MALLOC(bound);
+	stream.next_in = data;
+	stream.avail_in = (uInt)dataLength;
+	stream.next_out = compressed;
+	stream.avail_out = (uInt)bound;
+	bool finished = compressed != nullptr && deflate(&stream, Z_FINISH) == Z_STREAM_END;
+	deflateEnd(&stream);
+
+	if (!finished) {
+		RL_FREE(compressed);
+		return nullptr;
+	}
+	*compDataLength = (int)stream.total_out;
+	return compressed;
+}
+
+// ZORA: The decompressed size isn't stored anywhere, so the buffer starts at four times the input and doubles until everything fits
+unsigned char* DecompressData(unsigned char* compData, int compDataLength, int* dataLength) {
+	*dataLength = 0;
+	z_stream stream = {};
+	if (inflateInit2(&stream, -MAX_WBITS) != Z_OK)
+		return nullptr;
+
+	size_t capacity = (size_t)compDataLength * 4 + 64;
+	unsigned char* data = (unsigned char*)RL_MALLOC(capacity);
+	stream.next_in = compData;
+	stream.avail_in = (uInt)compDataLength;
+
+	int status = Z_OK;
+	while (data != nullptr && status == Z_OK) {
+		if (stream.total_out == capacity) {
+			capacity *= 2;
+			unsigned char* grown = (unsigned char*)RL_REALLOC(data, capacity);
+			if (grown == nullptr)
+				RL_FREE(data);
+			data = grown;
+			if (data == nullptr)
+				break;
+		}
+
+		stream.next_out = data + stream.total_out;
+		stream.avail_out = (uInt)(capacity - stream.total_out);
+		status = inflate(&stream, Z_NO_FLUSH);
+	}
+	inflateEnd(&stream);
+
+	if (data == nullptr || status != Z_STREAM_END) {
+		RL_FREE(data);
+		return nullptr;
+	}
+	*dataLength = (int)stream.total_out;
+	return data;
+}
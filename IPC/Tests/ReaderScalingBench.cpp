@@ -0,0 +1,153 @@
+// ZORA: Measures what publishing a frame costs the Editor as more and more Displays read the same segment. The registry means the Editor knows about every reader, but it must never copy anything per reader, so the cost should stay flat from 1 reader to ENTITY_MAX_READERS.
+// Every reader is its own process, as a Display would be, sleeping on the frame signal and copying each new frame as it arrives. On a machine with fewer cores than readers they take CPU time from the Editor, which shows in the wall clock time of a publish but not in the CPU time the Editor spends on it, so both are reported.
+// Usage: ReaderScalingBench [entities] [frames per step]
+#include <cstdio>
+#include <cstdlib>
+#include <signal.h>
+#include <time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+#include "EntitySegment.h"
+#include "Platform.h"
+
+// ZORA: The entities changed in each frame of the first measurement, as in a typical Editor frame where only a few have been edited. The second changes them all.
+static const uint32_t CHANGED_PER_FRAME = 100;
+
+static const uint32_t READER_COUNTS[] = { 1, 2, 4, 8, 16, 32, 64 };
+
+// ZORA: The child side. Read every frame until the parent kills us.
+static void RunReader(const char* name) {
+	EntitySegment segment;
+	if (!segment.Open(name))
+		_exit(1);
+
+	std::vector<Entity> entities;
+	uint64_t generation = 0;
+	for (;;) {
+		if (segment.WaitForFrame(generation, 100) && segment.ReadSnapshot(entities))
+			generation = segment.GetSnapshotGeneration();
+	}
+}
+
+// ZORA: Wait for 'count' readers to show up in the registry. Returns false if they don't within a few seconds.
+static bool WaitForReaders(EntitySegment& segment, uint32_t count) {
+	std::vector<EntityReaderStatus> readers;
+	uint64_t deadline = GetMonotonicMilliseconds() + 5000;
+	while (GetMonotonicMilliseconds() < deadline) {
+		segment.GetReaders(readers, UINT64_MAX);
+		if (readers.size() >= count)
+			return true;
+		usleep(1000);
+	}
+	return false;
+}
+
+// ZORA: The average time one Publish took, in microseconds
+struct PublishTimes {
+	double wallUs;
+	double cpuUs;	// ZORA: CPU time spent by the publishing thread, which is all the work the Editor did whoever else was running
+};
+
+static uint64_t GetThreadCpuMicroseconds() {
+	timespec now;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+	return (uint64_t)now.tv_sec * 1000000 + (uint64_t)now.tv_nsec / 1000;
+}
+
+// ZORA: Publish 'frames' frames, changing 'changed' entities in each, and time each Publish
+static PublishTimes TimePublishes(EntitySegment& segment, std::vector<Entity>& entities, uint32_t frames, uint32_t changed) {
+	PublishTimes times = { 0, 0 };
+	uint32_t count = (uint32_t)entities.size();
+	uint32_t next = 0;
+
+	for (uint32_t frame = 0; frame < frames; frame++) {
+		for (uint32_t i = 0; i < changed; i++) {
+			uint32_t index = (next + i * 997) % count;
+			entities[index].x += 1;
+			segment.MarkDirty(index);
+		}
+		next = (next + changed) % count;
+
+		uint64_t wallStart = GetMonotonicMicroseconds();
+		uint64_t cpuStart = GetThreadCpuMicroseconds();
+		segment.Publish(entities.data(), count);
+		times.cpuUs += (double)(GetThreadCpuMicroseconds() - cpuStart);
+		times.wallUs += (double)(GetMonotonicMicroseconds() - wallStart);
+
+		// ZORA: Give the readers a frame's worth of time, as the Editor would, so they aren't all still copying when the next Publish starts
+		usleep(2000);
+	}
+
+	times.wallUs /= frames;
+	times.cpuUs /= frames;
+	return times;
+}
+
+int main(int argc, char** argv) {
+	uint32_t entityCount = argc > 1 ? (uint32_t)atoi(argv[1]) : 100000;
+	uint32_t frames = argc > 2 ? (uint32_t)atoi(argv[2]) : 100;
+	if (entityCount == 0 || frames == 0) {
+		printf("Usage: ReaderScalingBench [entities] [frames per step]\n");
+		return 1;
+	}
+
+	char name[64];
+	snprintf(name, sizeof(name), "ReaderScalingBench.%u", GetCurrentProcessIdentifier());
+
+	EntitySegment segment;
+	if (!segment.Create(name, entityCount) || !segment.ClaimRange(0, entityCount)) {
+		printf("Could not create a segment for %u entities\n", entityCount);
+		return 1;
+	}
+
+	std::vector<Entity> entities(entityCount);
+	for (uint32_t i = 0; i < entityCount; i++) {
+		entities[i].x = (float)(i % 1920);
+		entities[i].y = (float)(i % 1080);
+		entities[i].rotation = 0;
+		entities[i].speed = 10;
+		entities[i].size = 10;
+		entities[i].r = entities[i].g = entities[i].b = 255;
+	}
+	segment.MarkAllDirty();
+	segment.Publish(entities.data(), entityCount);
+
+	printf("%u entities, %u frames per step, %u changed per frame\n", entityCount, frames, CHANGED_PER_FRAME);
+	printf("%8s %14s %14s %14s %14s %8s\n", "readers", "changed wall", "changed cpu", "all wall", "all cpu", "lagging");
+
+	std::vector<pid_t> children;
+	bool failed = false;
+	for (uint32_t readers : READER_COUNTS) {
+		while (children.size() < readers) {
+			pid_t child = fork();
+			if (child == 0)
+				RunReader(name);
+			if (child < 0)
+				break;
+			children.push_back(child);
+		}
+		if (!WaitForReaders(segment, readers)) {
+			printf("Only some of %u readers registered\n", readers);
+			failed = true;
+			break;
+		}
+
+		PublishTimes changed = TimePublishes(segment, entities, frames, CHANGED_PER_FRAME);
+		PublishTimes all = TimePublishes(segment, entities, frames, entityCount);
+
+		// ZORA: Every reader should be keeping up; one still more than a few frames behind after the last publish is falling behind rather than just mid-copy
+		usleep(20000);
+		std::vector<EntityReaderStatus> statuses;
+		uint32_t lagging = segment.GetReaders(statuses, 3);
+
+		printf("%8u %12.1fus %12.1fus %12.1fus %12.1fus %8u\n", readers, changed.wallUs, changed.cpuUs, all.wallUs, all.cpuUs, lagging);
+	}
+
+	for (pid_t child : children) {
+		kill(child, SIGKILL);
+		waitpid(child, nullptr, 0);
+	}
+	segment.Close();
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,176 @@
+// ZORA: Checks how a Display on shared memory sees several Editors publishing into one segment when one of them crashes.
+// While any Editor is still publishing, the segment must count as live, the crashed one must be counted on its own and its entities left out of the snapshot. Once nobody is publishing, every range must be kept, so the last picture stays up.
+// Then the Editor that created the segment crashes and is restarted while another carries on, and the restarted one must publish into the same segment as the other, the one the Display already has open.
+#include <cstdint>
+#include <cstdio>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+#include "EntitySegment.h"
+#include "Platform.h"
+
+static int g_failures = 0;
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+			g_failures++; \
+		} \
+	} while (0)
+
+// ZORA: Every producer's range, a whole number of blocks so the next one can start straight after it
+static const uint32_t RANGE = ENTITY_BLOCK_SIZE * 4;
+
+// ZORA: Every entity is tagged in its colour with the producer that published it
+static std::vector<Entity> MakeEntities(uint32_t producer) {
+	std::vector<Entity> entities(RANGE);
+	for (uint32_t i = 0; i < RANGE; i++) {
+		entities[i].x = (float)i;
+		entities[i].y = 0;
+		entities[i].rotation = 0;
+		entities[i].speed = 0;
+		entities[i].size = 10;
+		entities[i].r = (unsigned char)producer;
+		entities[i].g = entities[i].b = 0;
+	}
+	return entities;
+}
+
+static void Publish(EntitySegment& segment, const std::vector<Entity>& entities) {
+	segment.MarkAllDirty();
+	segment.Publish(entities.data(), (uint32_t)entities.size());
+}
+
+// ZORA: A producer that creates or joins the segment, publishes one frame and exits without letting go of its range or the segment, as a crashed Editor would. Returns once it has gone, so it is no longer running.
+static bool RunCrashingProducer(const char* name, uint32_t producer, bool create) {
+	pid_t child = fork();
+	if (child < 0)
+		return false;
+
+	if (child == 0) {
+		EntitySegment segment;
+		bool ready = create ? segment.Create(name, RANGE * 2) : segment.Open(name);
+		if (!ready || !segment.ClaimRange(producer * RANGE, RANGE))
+			_exit(1);
+		Publish(segment, MakeEntities(producer));
+		_exit(0);
+	}
+
+	int status = 0;
+	waitpid(child, &status, 0);
+	return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+// ZORA: The number of entities in 'snapshot' tagged with 'producer'
+static uint32_t CountTagged(const std::vector<Entity>& snapshot, uint32_t producer) {
+	uint32_t count = 0;
+	for (const Entity& entity : snapshot)
+		count += entity.r == producer ? 1 : 0;
+	return count;
+}
+
+// ZORA: Producer 0 carries on while producer 1 crashes, then goes quiet itself
+static void TestCrashedProducer() {
+	char name[64];
+	snprintf(name, sizeof(name), "SegmentProducerTest.%u", GetCurrentProcessIdentifier());
+
+	EntitySegment producer;
+	CHECK(producer.Create(name, RANGE * 2) && producer.ClaimRange(0, RANGE));
+	std::vector<Entity> entities = MakeEntities(0);
+	Publish(producer, entities);
+	CHECK(RunCrashingProducer(name, 1, false));
+
+	EntitySegment reader;
+	CHECK(reader.Open(name));
+	std::vector<Entity> snapshot;
+	CHECK(reader.ReadSnapshot(snapshot));
+	CHECK(snapshot.size() == RANGE * 2);
+	CHECK(CountTagged(snapshot, 1) == RANGE);
+	CHECK(reader.GetProducerState() == ENTITY_PRODUCER_LIVE);
+
+	// ZORA: Keep producer 0 publishing until producer 1 has been quiet long enough to be asked about
+	uint64_t startMs = GetMonotonicMilliseconds();
+	while (GetMonotonicMilliseconds() - startMs < ENTITY_PRODUCER_STALL_MS + 50) {
+		Publish(producer, entities);
+		usleep(10000);
+	}
+	Publish(producer, entities);
+
+	CHECK(reader.GetProducerState() == ENTITY_PRODUCER_LIVE);
+	CHECK(reader.GetProducerCount(ENTITY_PRODUCER_LIVE) == 1);
+	CHECK(reader.GetProducerCount(ENTITY_PRODUCER_DEAD) == 1);
+	CHECK(reader.ReadSnapshot(snapshot));
+	CHECK(snapshot.size() == RANGE);
+	CHECK(CountTagged(snapshot, 0) == RANGE);
+
+	// ZORA: With a producer still live, the reader sleeps on the signal rather than polling for a new Editor, and producer 0's next frame wakes it
+	CHECK(reader.WaitForFrame(reader.GetSnapshotGeneration(), 100) == false);
+	Publish(producer, entities);
+	CHECK(reader.WaitForFrame(reader.GetSnapshotGeneration(), 100));
+	CHECK(reader.GetReattachCount() == 0);
+
+	// ZORA: Now nobody is publishing, so the crashed producer's entities come back rather than leave an emptier picture than the last one
+	usleep((useconds_t)(ENTITY_PRODUCER_STALL_MS + 50) * 1000);
+	CHECK(reader.GetProducerState() == ENTITY_PRODUCER_STALLED);
+	CHECK(reader.GetProducerCount(ENTITY_PRODUCER_STALLED) == 1);
+	CHECK(reader.GetProducerCount(ENTITY_PRODUCER_DEAD) == 1);
+	CHECK(reader.ReadSnapshot(snapshot));
+	CHECK(snapshot.size() == RANGE * 2);
+	CHECK(CountTagged(snapshot, 1) == RANGE);
+
+	reader.Close();
+	producer.Close();
+}
+
+// ZORA: Producer 0 creates the segment and crashes, producer 1 carries on, and producer 0 is restarted under a Display that has the segment open
+static void TestRestartedCreator() {
+	char name[64];
+	snprintf(name, sizeof(name), "SegmentProducerTest.%u.restart", GetCurrentProcessIdentifier());
+	CHECK(RunCrashingProducer(name, 0, true));
+
+	EntitySegment other;
+	CHECK(other.Open(name) && other.ClaimRange(RANGE, RANGE));
+	std::vector<Entity> otherEntities = MakeEntities(1);
+	Publish(other, otherEntities);
+
+	EntitySegment reader;
+	CHECK(reader.Open(name));
+	std::vector<Entity> snapshot;
+	CHECK(reader.ReadSnapshot(snapshot));
+	CHECK(CountTagged(snapshot, 1) == RANGE);
+
+	// ZORA: The restarted producer 0 tags its entities as producer 2, so they can be told from the crashed one's
+	EntitySegment restarted;
+	CHECK(restarted.Create(name, RANGE * 2) && restarted.ClaimRange(0, RANGE));
+	Publish(restarted, MakeEntities(2));
+	Publish(other, otherEntities);
+
+	CHECK(reader.ReadSnapshot(snapshot));
+	CHECK(snapshot.size() == RANGE * 2);
+	CHECK(CountTagged(snapshot, 2) == RANGE);
+	CHECK(CountTagged(snapshot, 1) == RANGE);
+	CHECK(reader.GetReattachCount() == 0);
+
+	reader.Close();
+	restarted.Close();
+	other.Close();
+
+	// ZORA: The crashed creator never removed the name, and a producer that joined never does
+	char posixName[80];
+	snprintf(posixName, sizeof(posixName), "/%s", name);
+	shm_unlink(posixName);
+}
+
+int main() {
+	TestCrashedProducer();
+	TestRestartedCreator();
+
+	if (g_failures > 0) {
+		printf("%d checks failed\n", g_failures);
+		return 1;
+	}
+	printf("All checks passed\n");
+	return 0;
+}
@@ -0,0 +1,214 @@
+// ZORA: Compares the Unix domain socket with the shared memory segment, from 10 entities to a million. For each count the Editor publishes a frame with every entity moved at a steady frame rate, and a Display in another process reads every frame it can.
+// Reported for each transport: the time the Editor spends in Publish, the time from the start of Publish to the Display having the snapshot, and the share of frames the Display got. The socket skips frames for a Display that hasn't taken the last one yet, so at large counts it delivers fewer.
+// Both transports number their frames 1, 2, 3 and so on, one per Publish, so the Editor writes down when it started each Publish in memory it shares with the Display, and the Display looks up the frame it read there.
+// Usage: TransportBench [frames per count] [milliseconds between frames]
+#include <cstdio>
+#include <cstdlib>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+#include "EntitySegment.h"
+#include "EntitySocket.h"
+#include "Platform.h"
+
+static const uint32_t ENTITY_COUNTS[] = { 10, 100, 1000, 10000, 100000, 1000000 };
+
+// ZORA: A Display that gets nothing for this long has been left behind for good
+static const int READER_TIMEOUT_MS = 5000;
+
+// ZORA: The most Publishes whose start times are written down. Any after that aren't timed.
+static const uint32_t MAX_PUBLISHES = 1 << 16;
+
+enum TransportKind {
+	TRANSPORT_SEGMENT,
+	TRANSPORT_SOCKET
+};
+
+// ZORA: What the Display sends back once it has read the last timed frame, or given up waiting for it
+struct ReaderResult {
+	uint32_t framesRead;
+	double totalLatencyUs;
+};
+
+struct TransportResult {
+	double publishUs;
+	double latencyUs;
+	double delivered;	// ZORA: The share of timed frames the Display read, from 0 to 1
+	bool finished;
+};
+
+// ZORA: The child side. Say when the first frame has arrived, then read frames until the one 'frames' after it, timing how long after publishing each was read.
+static void RunReader(TransportKind kind, const char* name, uint32_t frames, const volatile uint64_t* publishedUs, int readyFd, int resultFd) {
+	EntitySegment segment;
+	EntitySocket socket;
+	EntitySubscriber* subscriber = kind == TRANSPORT_SEGMENT ? (EntitySubscriber*)&segment : (EntitySubscriber*)&socket;
+	bool opened = kind == TRANSPORT_SEGMENT ? segment.Open(name) : socket.Connect(name);
+	if (!opened)
+		_exit(1);
+
+	std::vector<Entity> entities;
+	uint64_t generation = 0;
+	uint64_t first = 0;
+	ReaderResult result = { 0, 0 };
+	uint64_t lastFrameMs = GetMonotonicMilliseconds();
+
+	while (GetMonotonicMilliseconds() - lastFrameMs < (uint64_t)READER_TIMEOUT_MS) {
+		if (!subscriber->WaitForFrame(generation, 100) || !subscriber->ReadSnapshot(entities))
+			continue;
+		uint64_t now = GetMonotonicMicroseconds();
+		if (subscriber->GetSnapshotGeneration() == generation)
+			continue;
+
+		generation = subscriber->GetSnapshotGeneration();
+		lastFrameMs = GetMonotonicMilliseconds();
+		if (first == 0) {
+			first = generation;
+			char ready = 1;
+			if (write(readyFd, &ready, 1) != 1)
+				_exit(1);
+			continue;
+		}
+
+		if (generation <= first + frames && generation < MAX_PUBLISHES) {
+			result.framesRead++;
+			result.totalLatencyUs += (double)(now - publishedUs[generation]);
+		}
+		if (generation >= first + frames)
+			break;
+	}
+
+	if (write(resultFd, &result, sizeof(result)) != sizeof(result))
+		_exit(1);
+	_exit(0);
+}
+
+// ZORA: Wait up to 'timeoutMs' for something to read on 'fd'
+static bool WaitReadable(int fd, int timeoutMs) {
+	pollfd entry = { fd, POLLIN, 0 };
+	return poll(&entry, 1, timeoutMs) > 0;
+}
+
+// ZORA: Publish a frame, writing down when it started under the generation it will carry
+static void PublishTimed(EntityPublisher* publisher, const std::vector<Entity>& entities, volatile uint64_t* publishedUs, uint32_t& published) {
+	published++;
+	if (published < MAX_PUBLISHES)
+		publishedUs[published] = GetMonotonicMicroseconds();
+	publisher->Publish(entities.data(), (uint32_t)entities.size());
+}
+
+static TransportResult RunTransport(TransportKind kind, uint32_t count, uint32_t frames, uint32_t intervalMs) {
+	TransportResult result = { 0, 0, 0, false };
+
+	char name[108];
+	EntitySegment segment;
+	EntitySocket socket;
+	EntityPublisher* publisher = nullptr;
+	if (kind == TRANSPORT_SEGMENT) {
+		snprintf(name, sizeof(name), "TransportBench.%u", GetCurrentProcessIdentifier());
+		if (!segment.Create(name, count) || !segment.ClaimRange(0, count))
+			return result;
+		publisher = &segment;
+	}
+	else {
+		snprintf(name, sizeof(name), "/tmp/TransportBench.%u.sock", GetCurrentProcessIdentifier());
+		if (!socket.Listen(name))
+			return result;
+		publisher = &socket;
+	}
+
+	int ready[2];
+	int results[2];
+	void* shared = mmap(nullptr, sizeof(uint64_t) * MAX_PUBLISHES, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (shared == MAP_FAILED || pipe(ready) != 0 || pipe(results) != 0)
+		return result;
+	volatile uint64_t* publishedUs = (volatile uint64_t*)shared;
+	uint32_t published = 0;
+
+	pid_t child = fork();
+	if (child == 0)
+		RunReader(kind, name, frames, publishedUs, ready[1], results[1]);
+	close(ready[1]);
+	close(results[1]);
+
+	std::vector<Entity> entities(count);
+	for (uint32_t i = 0; i < count; i++) {
+		entities[i].x = (float)(i % 1920);
+		entities[i].y = (float)(i % 1080);
+		entities[i].rotation = 0;
+		entities[i].speed = 10;
+		entities[i].size = 10;
+		entities[i].r = entities[i].g = entities[i].b = 255;
+	}
+
+	// ZORA: Keep publishing until the Display has connected and read a frame, so every timed frame has somebody to go to
+	char readyByte = 0;
+	uint64_t deadline = GetMonotonicMilliseconds() + READER_TIMEOUT_MS;
+	bool started = false;
+	while (!started && child > 0 && GetMonotonicMilliseconds() < deadline) {
+		publisher->MarkAllDirty();
+		PublishTimed(publisher, entities, publishedUs, published);
+		started = WaitReadable(ready[0], (int)intervalMs) && read(ready[0], &readyByte, 1) == 1;
+	}
+
+	if (started) {
+		double totalPublishUs = 0;
+		for (uint32_t frame = 0; frame < frames; frame++) {
+			for (Entity& entity : entities)
+				entity.x += 1;
+			publisher->MarkAllDirty();
+
+			uint64_t start = GetMonotonicMicroseconds();
+			PublishTimed(publisher, entities, publishedUs, published);
+			totalPublishUs += (double)(GetMonotonicMicroseconds() - start);
+			usleep(intervalMs * 1000);
+		}
+		result.publishUs = totalPublishUs / frames;
+
+		// ZORA: A frame only part sent down the socket is finished by later Publishes, so keep publishing frames with nothing changed until the Display reports back
+		ReaderResult reader;
+		deadline = GetMonotonicMilliseconds() + READER_TIMEOUT_MS * 2;
+		while (!WaitReadable(results[0], (int)intervalMs) && GetMonotonicMilliseconds() < deadline)
+			PublishTimed(publisher, entities, publishedUs, published);
+		if (read(results[0], &reader, sizeof(reader)) == sizeof(reader)) {
+			result.latencyUs = reader.framesRead > 0 ? reader.totalLatencyUs / reader.framesRead : 0;
+			result.delivered = (double)reader.framesRead / frames;
+			result.finished = true;
+		}
+	}
+
+	if (child > 0)
+		waitpid(child, nullptr, 0);
+	close(ready[0]);
+	close(results[0]);
+	munmap(shared, sizeof(uint64_t) * MAX_PUBLISHES);
+	return result;
+}
+
+int main(int argc, char** argv) {
+	uint32_t frames = argc > 1 ? (uint32_t)atoi(argv[1]) : 60;
+	uint32_t intervalMs = argc > 2 ? (uint32_t)atoi(argv[2]) : 16;
+	if (frames == 0 || intervalMs == 0) {
+		printf("Usage: TransportBench [frames per count] [milliseconds between frames]\n");
+		return 1;
+	}
+
+	printf("%u frames per count, %ums apart, every entity moved in every frame\n", frames, intervalMs);
+	printf("%8s | %12s %12s %9s | %12s %12s %9s\n", "", "segment", "", "", "socket", "", "");
+	printf("%8s | %12s %12s %9s | %12s %12s %9s\n", "entities", "publish", "latency", "delivered", "publish", "latency", "delivered");
+
+	bool failed = false;
+	for (uint32_t count : ENTITY_COUNTS) {
+		TransportResult segment = RunTransport(TRANSPORT_SEGMENT, count, frames, intervalMs);
+		TransportResult socket = RunTransport(TRANSPORT_SOCKET, count, frames, intervalMs);
+		printf("%8u | %10.1fus %10.1fus %8.0f%% | %10.1fus %10.1fus %8.0f%%\n", count,
+			segment.publishUs, segment.latencyUs, segment.delivered * 100,
+			socket.publishUs, socket.latencyUs, socket.delivered * 100);
+		failed |= !segment.finished || !socket.finished;
+	}
+
+	if (failed)
+		printf("A Display never got its first frame or never reported back\n");
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,329 @@
+// ZORA: Checks that a Display on UDP only ever shows whole frames, always the newest it has, over loopback.
+// First a scripted Editor sends pieces of frames in a chosen order, so each rule about stale and abandoned frames is checked on its own. Then a real Editor and Display both drop and reorder a share of what they send, in every format the Editor can send in, and every snapshot the Display reads must be one whole frame that is newer than the last.
+// Last, an Editor is restarted under a Display that has already seen hundreds of its frames, and the Display must pick up the new Editor's frames, numbered from 1 again, straight away.
+#include <arpa/inet.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+#include "EntityUdp.h"
+#include "Platform.h"
+
+static int g_failures = 0;
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+			g_failures++; \
+		} \
+	} while (0)
+
+// ZORA: Every entity of a frame is tagged with the frame's number in its colour, which survives packing and encoding exactly, and its index in x, which packing rounds to within a hundredth of a pixel
+static Entity MakeEntity(uint32_t tag, uint32_t index) {
+	Entity entity;
+	entity.x = (float)index;
+	entity.y = 0;
+	entity.rotation = 0;
+	entity.speed = 0;
+	entity.size = 10;
+	entity.r = (unsigned char)(tag & 0xFF);
+	entity.g = (unsigned char)(tag >> 8);
+	entity.b = 0;
+	return entity;
+}
+
+// ZORA: Frames have different sizes, so a snapshot stitched together from two of them shows up in its count as well as its tags
+static uint32_t GetFrameCount(uint32_t tag) {
+	return 3 * ENTITY_UDP_FRAGMENT_ENTITIES - 5 + (tag % 7) * 40;
+}
+
+// ZORA: Whether 'entities' is the whole of one frame. Fills in 'tag' with which.
+static bool IsWholeFrame(const std::vector<Entity>& entities, uint32_t& tag) {
+	if (entities.empty())
+		return false;
+
+	tag = (uint32_t)(entities[0].r | (entities[0].g << 8));
+	if (entities.size() != GetFrameCount(tag))
+		return false;
+	for (size_t i = 0; i < entities.size(); i++)
+		if ((uint32_t)(entities[i].r | (entities[i].g << 8)) != tag || (uint32_t)(entities[i].x + 0.5f) != i)
+			return false;
+	return true;
+}
+
+// ZORA: Stands in for the Editor, sending exactly the pieces it is told to
+class ScriptedEditor {
+public:
+	bool Open() {
+		m_fd = socket(AF_INET, SOCK_DGRAM, 0);
+		sockaddr_in address;
+		memset(&address, 0, sizeof(address));
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		socklen_t length = sizeof(address);
+		if (m_fd < 0 || bind(m_fd, (sockaddr*)&address, sizeof(address)) != 0 || getsockname(m_fd, (sockaddr*)&address, &length) != 0)
+			return false;
+		m_port = ntohs(address.sin_port);
+		return true;
+	}
+
+	// ZORA: Wait for the Display's hello, to learn where to send to
+	bool WaitForDisplay() {
+		char buffer[ENTITY_UDP_MTU];
+		socklen_t length = sizeof(m_display);
+		timeval timeout = { 2, 0 };
+		setsockopt(m_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+		return recvfrom(m_fd, buffer, sizeof(buffer), 0, (sockaddr*)&m_display, &length) >= (ssize_t)sizeof(EntityAckHeader);
+	}
+
+	void SendPiece(uint64_t generation, uint32_t tag, uint32_t fragment) {
+		uint32_t count = GetFrameCount(tag);
+		EntityFragmentHeader header;
+		memset(&header, 0, sizeof(header));
+		header.magic = ENTITY_DATAGRAM_MAGIC;
+		header.type = ENTITY_DATAGRAM_FRAGMENT;
+		header.generation = generation;
+		header.session = m_session;
+		header.count = count;
+		header.fragment = fragment;
+		header.fragmentCount = GetFragmentCount(tag);
+		uint32_t first = fragment * ENTITY_UDP_FRAGMENT_ENTITIES;
+		header.length = count - first < ENTITY_UDP_FRAGMENT_ENTITIES ? count - first : ENTITY_UDP_FRAGMENT_ENTITIES;
+
+		char datagram[ENTITY_UDP_MTU];
+		memcpy(datagram, &header, sizeof(header));
+		for (uint32_t i = 0; i < header.length; i++) {
+			Entity entity = MakeEntity(tag, first + i);
+			memcpy(datagram + sizeof(header) + sizeof(Entity) * i, &entity, sizeof(Entity));
+		}
+		sendto(m_fd, datagram, sizeof(header) + sizeof(Entity) * header.length, 0, (sockaddr*)&m_display, sizeof(m_display));
+	}
+
+	// ZORA: Every piece of a frame, last first, to show the order they arrive in doesn't matter
+	void SendFrame(uint64_t generation, uint32_t tag) {
+		for (uint32_t fragment = GetFragmentCount(tag); fragment-- > 0;)
+			SendPiece(generation, tag, fragment);
+	}
+
+	uint32_t GetFragmentCount(uint32_t tag) const {
+		return (GetFrameCount(tag) + ENTITY_UDP_FRAGMENT_ENTITIES - 1) / ENTITY_UDP_FRAGMENT_ENTITIES;
+	}
+
+	uint16_t GetPort() const {
+		return m_port;
+	}
+
+	// ZORA: As a restarted Editor would, send every piece from now on in a new session
+	void SetSession(uint64_t session) {
+		m_session = session;
+	}
+
+	~ScriptedEditor() {
+		if (m_fd >= 0)
+			close(m_fd);
+	}
+
+private:
+	int m_fd = -1;
+	uint16_t m_port = 0;
+	uint64_t m_session = 1;
+	sockaddr_in m_display;
+};
+
+// ZORA: Give the Display a moment to take in what was sent, then read its snapshot. Returns the generation of what it read, 0 if nothing.
+static uint64_t ReadAfterSending(EntityUdp& display, std::vector<Entity>& entities, uint32_t& tag) {
+	display.WaitForFrame(display.GetSnapshotGeneration(), 50);
+	if (!display.ReadSnapshot(entities))
+		return 0;
+	CHECK(IsWholeFrame(entities, tag));
+	return display.GetSnapshotGeneration();
+}
+
+static void TestScriptedFrames() {
+	ScriptedEditor editor;
+	EntityUdp display;
+	CHECK(editor.Open());
+	CHECK(display.Connect("127.0.0.1", editor.GetPort()));
+	CHECK(editor.WaitForDisplay());
+
+	std::vector<Entity> entities;
+	uint32_t tag = 0;
+
+	// ZORA: A whole frame, in any order, is put back together
+	editor.SendFrame(2, 2);
+	CHECK(ReadAfterSending(display, entities, tag) == 2 && tag == 2);
+
+	// ZORA: A whole frame older than the newest is stale
+	editor.SendFrame(1, 1);
+	CHECK(ReadAfterSending(display, entities, tag) == 2 && tag == 2);
+
+	// ZORA: A frame that isn't finished is never shown, and is abandoned for a newer one. Its pieces that turn up later are stale.
+	editor.SendPiece(4, 4, 0);
+	CHECK(ReadAfterSending(display, entities, tag) == 2 && tag == 2);
+	editor.SendFrame(5, 5);
+	CHECK(ReadAfterSending(display, entities, tag) == 5 && tag == 5);
+	for (uint32_t fragment = 1; fragment < editor.GetFragmentCount(4); fragment++)
+		editor.SendPiece(4, 4, fragment);
+	CHECK(ReadAfterSending(display, entities, tag) == 5 && tag == 5);
+
+	// ZORA: A frame older than the one being put together is stale, even though it is newer than the last finished one
+	editor.SendPiece(7, 7, 0);
+	editor.SendFrame(6, 6);
+	CHECK(ReadAfterSending(display, entities, tag) == 5 && tag == 5);
+	for (uint32_t fragment = 1; fragment < editor.GetFragmentCount(7); fragment++)
+		editor.SendPiece(7, 7, fragment);
+	CHECK(ReadAfterSending(display, entities, tag) == 7 && tag == 7);
+
+	// ZORA: A restarted Editor starts again from generation 1, which is taken even though it is older than the last frame of the old session
+	editor.SetSession(2);
+	editor.SendFrame(1, 8);
+	CHECK(ReadAfterSending(display, entities, tag) == 1 && tag == 8);
+
+	// ZORA: A piece of the old session held up on the way is stale, however new its generation
+	editor.SetSession(1);
+	editor.SendFrame(9, 9);
+	CHECK(ReadAfterSending(display, entities, tag) == 1 && tag == 8);
+	editor.SetSession(2);
+	editor.SendFrame(2, 10);
+	CHECK(ReadAfterSending(display, entities, tag) == 2 && tag == 10);
+}
+
+// ZORA: Listen on any free port, trying a few
+static uint16_t ListenOnFreePort(EntityUdp& editor) {
+	for (uint16_t candidate = (uint16_t)(40000 + GetCurrentProcessIdentifier() % 20000); candidate < 61000; candidate += 97)
+		if (editor.Listen(candidate))
+			return candidate;
+	return 0;
+}
+
+enum UdpFormat {
+	UDP_FORMAT_ENTITIES,
+	UDP_FORMAT_PACKED,
+	UDP_FORMAT_DELTA
+};
+
+static const char* FORMAT_NAMES[] = { "entities", "packed", "delta" };
+
+// ZORA: The number of frames the Editor publishes, one every couple of milliseconds. A lost piece is only asked for again once the Display has heard nothing for a while, so under loss most frames are overtaken before they are finished, and only some are ever read.
+static const uint32_t LOSSY_FRAMES = 500;
+
+static void TestLossyLoopback(UdpFormat format, int lossPercent, int reorderPercent) {
+	EntityUdp editor;
+	uint16_t port = ListenOnFreePort(editor);
+	CHECK(port != 0);
+	if (port == 0)
+		return;
+
+	editor.SetSimulatedLoss(lossPercent, reorderPercent);
+	editor.SetPacking(format == UDP_FORMAT_PACKED, EntityPackBounds{ 640, 480 });
+	editor.SetCompression(format == UDP_FORMAT_DELTA, false, 8);
+
+	EntityUdp display;
+	CHECK(display.Connect("127.0.0.1", port));
+	display.SetSimulatedLoss(lossPercent, reorderPercent);
+
+	std::vector<Entity> frame;
+	std::vector<Entity> entities;
+	uint64_t lastGeneration = 0;
+	uint32_t lastTag = 0;
+	uint32_t framesRead = 0;
+	bool wholeFrames = true;
+	bool newerEachTime = true;
+
+	// ZORA: Keep publishing the last frame once the rest are done, until it gets through or it is clear it never will
+	uint64_t deadline = GetMonotonicMilliseconds() + 10000;
+	for (uint32_t tag = 1; lastTag != LOSSY_FRAMES && GetMonotonicMilliseconds() < deadline; tag = tag < LOSSY_FRAMES ? tag + 1 : tag) {
+		frame.resize(GetFrameCount(tag));
+		for (uint32_t i = 0; i < frame.size(); i++)
+			frame[i] = MakeEntity(tag, i);
+		editor.Publish(frame.data(), (uint32_t)frame.size());
+
+		display.WaitForFrame(lastGeneration, 2);
+		if (!display.ReadSnapshot(entities) || display.GetSnapshotGeneration() == lastGeneration)
+			continue;
+
+		uint32_t snapshotTag = 0;
+		wholeFrames &= IsWholeFrame(entities, snapshotTag);
+		newerEachTime &= display.GetSnapshotGeneration() > lastGeneration && snapshotTag > lastTag;
+		lastGeneration = display.GetSnapshotGeneration();
+		lastTag = snapshotTag;
+		framesRead++;
+	}
+
+	printf("%-8s loss %2d%% reorder %2d%%: %u frames read, newest %u of %u\n", FORMAT_NAMES[format], lossPercent, reorderPercent, framesRead, lastTag, LOSSY_FRAMES);
+	CHECK(wholeFrames);
+	CHECK(newerEachTime);
+	CHECK(lastTag == LOSSY_FRAMES);
+	CHECK(framesRead > 1);
+}
+
+// ZORA: Publish frames tagged 'firstTag' onwards until the Display has read the one tagged 'lastTag', or 'timeoutMs' has passed. Returns how long it took, or UINT64_MAX if it never did.
+static uint64_t PublishUntilRead(EntityUdp& editor, EntityUdp& display, uint32_t firstTag, uint32_t lastTag, uint64_t timeoutMs, bool& wholeFrames) {
+	std::vector<Entity> frame;
+	std::vector<Entity> entities;
+	uint64_t start = GetMonotonicMilliseconds();
+	for (uint32_t tag = firstTag; GetMonotonicMilliseconds() - start < timeoutMs; tag = tag < lastTag ? tag + 1 : tag) {
+		frame.resize(GetFrameCount(tag));
+		for (uint32_t i = 0; i < frame.size(); i++)
+			frame[i] = MakeEntity(tag, i);
+		editor.Publish(frame.data(), (uint32_t)frame.size());
+
+		display.WaitForFrame(display.GetSnapshotGeneration(), 2);
+		uint32_t snapshotTag = 0;
+		if (!display.ReadSnapshot(entities))
+			continue;
+		wholeFrames &= IsWholeFrame(entities, snapshotTag);
+		if (snapshotTag == lastTag)
+			return GetMonotonicMilliseconds() - start;
+	}
+	return UINT64_MAX;
+}
+
+// ZORA: Before sessions, a restarted Editor's frames all looked stale to a Display that had seen more of the old one's, and the Editor ignored the Display's acknowledgements of frames it had never sent, so the Display froze for as long as the old Editor had been running
+static void TestEditorRestart() {
+	EntityUdp editor;
+	uint16_t port = ListenOnFreePort(editor);
+	CHECK(port != 0);
+	if (port == 0)
+		return;
+
+	EntityUdp display;
+	CHECK(display.Connect("127.0.0.1", port));
+
+	bool wholeFrames = true;
+	CHECK(PublishUntilRead(editor, display, 1, 300, 5000, wholeFrames) != UINT64_MAX);
+	uint64_t oldGeneration = display.GetSnapshotGeneration();
+
+	// ZORA: The new Editor has to pick the Display up from its acknowledgements alone, as it would after a crash
+	editor.Close();
+	EntityUdp restarted;
+	CHECK(restarted.Listen(port));
+	uint64_t restartMs = PublishUntilRead(restarted, display, 1001, 1100, 5000, wholeFrames);
+
+	printf("restart: %llu frames before, the new Editor's 100th frame read after %llu ms, at generation %llu\n", (unsigned long long)oldGeneration, (unsigned long long)restartMs, (unsigned long long)display.GetSnapshotGeneration());
+	CHECK(wholeFrames);
+	CHECK(oldGeneration >= 300);
+	CHECK(restartMs < 1000);
+	CHECK(display.GetSnapshotGeneration() < oldGeneration);
+}
+
+int main() {
+	TestScriptedFrames();
+	for (UdpFormat format : { UDP_FORMAT_ENTITIES, UDP_FORMAT_PACKED, UDP_FORMAT_DELTA }) {
+		TestLossyLoopback(format, 0, 0);
+		TestLossyLoopback(format, 10, 10);
+		TestLossyLoopback(format, 30, 30);
+	}
+	TestEditorRestart();
+
+	if (g_failures > 0) {
+		printf("%d checks failed\n", g_failures);
+		return 1;
+	}
+	printf("All checks passed\n");
+	return 0;
+}